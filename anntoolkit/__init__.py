@@ -48,7 +48,6 @@ KeyDown = SpecialKeys.KeyDown
 KeyUp = SpecialKeys.KeyUp
 
 
-from anntoolkit.generate_mipmaps import generate_mipmaps
 from anntoolkit.app import App
 
 # A hack to force sphinx to do the right thing
@@ -29,6 +29,18 @@ class App:
         width (int): width of the window. Default: 600.
         height (int): height of the window. Default: 600.
         title (str): title of the window. Default: "Hello".
+        on_demand (bool): if True, the window is redrawn only when there is input, the view changes or
+            :meth:`request_redraw` is called, otherwise it is redrawn every frame. Default: False.
+        low_latency (bool): if True, input is polled right before drawing and frames are not queued by the driver,
+            which reduces input lag at the cost of some throughput. See :attr:`low_latency`. Default: False.
+        offscreen (bool): if True, no window is created, and frames are rendered into a framebuffer of size
+            `width` x `height`, see :meth:`render` and :meth:`read_pixels`. Works on machines without a display,
+            including software rendering with Mesa llvmpipe. Linux only. Default: False.
+        share (App): another application to share textures with, e.g. an overview and a detail window of the same
+            slide. Images set in one of them can be set in the other without uploading them again, see :attr:`vram`.
+            Both have to be windowed, or both offscreen. Default: None.
+        queue_input (bool): if True, input events are buffered and handed to :meth:`on_input` once per frame,
+            instead of calling into python for each of them. See :attr:`queue_input`. Default: False.
 
 
     Example:
@@ -49,9 +61,12 @@ class App:
         >>> app.run()
     """
 
-    def __init__(self, width=600, height=600, title="Hello"):
+    def __init__(self, width=600, height=600, title="Hello", on_demand=False, low_latency=False, offscreen=False,
+                 share=None, queue_input=False):
         self._ctx = anntoolkit.Context()
-        self._ctx.init(width, height, title)
+        self._ctx.init(width, height, title, offscreen, share._ctx if share is not None else None)
+        self._ctx.on_demand = on_demand
+        self._ctx.low_latency = low_latency
 
         def mouse_button(down, x, y, lx, ly):
             self.on_mouse_button(down, x, y, lx, ly)
@@ -63,20 +78,21 @@ class App:
 
         self._ctx.set_mouse_position_callback(mouse_pos)
 
-        def keyboard(key, action, mods):
-            if key < 255:
-                key = chr(key)
-            if action == 1:
-                self.keys[key] = 1
-            elif action == 0:
-                if key in self.keys:
-                    del self.keys[key]
-            self.on_keyboard(key, action == 1, mods)
-
-        self._ctx.set_keyboard_callback(keyboard)
+        self._ctx.set_keyboard_callback(self._keyboard)
+        self._ctx.input_queue = queue_input
         self.keys = {}
         self.image = None
 
+    def _keyboard(self, key, action, mods):
+        if key < 255:
+            key = chr(key)
+        if action == 1:
+            self.keys[key] = 1
+        elif action == 0:
+            if key in self.keys:
+                del self.keys[key]
+        self.on_keyboard(key, action == 1, mods)
+
     def run(self):
         """Runs the application.
 
@@ -86,12 +102,19 @@ class App:
         Runs an event loop, where it process user input and updates window.
         Call callback method  :meth:`on_update`.
 
+        In on-demand mode (see :attr:`on_demand`) the loop sleeps until something has to be redrawn, and
+        :meth:`on_update` is not called for skipped frames.
+
         Example:
             >>> app = App()
             >>> app.run()
         """
         while not self._ctx.should_close():
+            if not self._ctx.wait_for_redraw():
+                continue
             with self._ctx:
+                if self._ctx.input_queue:
+                    self.on_input(self._ctx.drain_input())
                 for k, v in self.keys.items():
                     self.keys[k] += 1
                     if v > 50:
@@ -99,6 +122,222 @@ class App:
                         self.keys[k] = 45
 
                 self.on_update()
+            # Held keys repeat, which needs frames to be counted
+            if self.keys:
+                self._ctx.request_redraw()
+
+    def render(self):
+        """Draws one frame, calling :meth:`on_update`, and returns it as uint8 array of shape (height, width, 4).
+        Only for offscreen applications, see `offscreen` argument
+
+        Example:
+            >>> app = App(width=512, height=512, offscreen=True)
+            >>> app.set_image(im)
+            >>> preview = app.render()
+        """
+        with self._ctx:
+            self.on_update()
+        return self._ctx.read_pixels()
+
+    def read_pixels(self):
+        """Returns the last rendered frame of an offscreen application as uint8 array of shape (height, width, 4)
+        """
+        return self._ctx.read_pixels()
+
+    def resize(self, width, height):
+        """Changes size of the frames of an offscreen application
+        """
+        self._ctx.resize(width, height)
+
+    def render_batch(self, jobs, threads=0, quality=90):
+        """Renders images with annotations into files, e.g. previews of a whole dataset. Only for offscreen applications.
+
+        Decoding and encoding are done on `threads` worker threads (all hardware threads if 0), while images are uploaded,
+        rendered and read back on the calling thread, all of it pipelined. :meth:`on_update` is not called.
+
+        Arguments:
+            jobs (list): tuples (image, annotations, output_path). Image is a path or an array as for :meth:`set_image`.
+                Annotations is None or a dict with optional keys "points", "boxes" and "lines", values are tuples of
+                arguments of :meth:`points`, :meth:`boxes` and :meth:`lines`. Output is JPEG for .jpg and .jpeg, PNG otherwise.
+            threads (int): number of worker threads. Default: 0.
+            quality (int): JPEG quality, 1..100. Default: 90.
+
+        Returns:
+            dict with mean per-image times of stages in milliseconds: "decode", "upload", "render", "readback", "encode",
+            times the calling thread waited for the workers: "decode_stall", "encode_stall", "total" time,
+            "images_per_second" and the number of written and "failed" images. Failures are logged, and do not stop the batch.
+
+        Example:
+            >>> app = anntoolkit.App(512, 512, offscreen=True)
+            >>> jobs = [(path, {"points": (xy, (255, 0, 0, 255))}, path + '.preview.jpg') for path, xy in dataset]
+            >>> print(app.render_batch(jobs))
+        """
+        return self._ctx.render_batch(jobs, threads, quality)
+
+    @property
+    def vram(self):
+        """Dict with video memory taken by images of this application and of the ones it shares textures with:
+        number of "images", their total size in "image_bytes", and number of "contexts" in the group.
+        An image shown in several of them is counted once
+        """
+        return self._ctx.vram
+
+    @property
+    def offscreen(self):
+        """True if the application renders without a window
+        """
+        return self._ctx.offscreen
+
+    def request_redraw(self):
+        """Makes the window redraw on the next iteration of the event loop. Needed only in on-demand mode,
+        when what is drawn in :meth:`on_update` changes without user input, e.g. after a background job finished.
+        Input, :meth:`set_image`, :meth:`recenter` and :meth:`set_roi` request redraw on their own.
+        """
+        self._ctx.request_redraw()
+
+    @property
+    def on_demand(self):
+        """If True, the window is redrawn only when needed and the event loop sleeps while idle, otherwise every frame is drawn
+        """
+        return self._ctx.on_demand
+
+    @on_demand.setter
+    def on_demand(self, value):
+        self._ctx.on_demand = value
+        self._ctx.request_redraw()
+
+    @property
+    def low_latency(self):
+        """If True, input is polled right before drawing instead of after the previous frame was swapped, and the CPU
+        waits for the GPU to finish each frame, so that the driver does not queue frames ahead.
+        Use it together with :meth:`cursor_point` for dragging. Latency is reported by :attr:`input_latency`
+        """
+        return self._ctx.low_latency
+
+    @low_latency.setter
+    def low_latency(self, value):
+        self._ctx.low_latency = value
+
+    @property
+    def culling(self):
+        """If True, :meth:`point`, :meth:`box` and :meth:`text_loc` calls that fall outside of the visible part of the image
+        are skipped, so that the cost of a frame depends on what is visible. Default True
+        """
+        return self._ctx.culling
+
+    @culling.setter
+    def culling(self, value):
+        self._ctx.culling = value
+
+    @property
+    def culling_stats(self):
+        """Tuple (submitted, drawn): number of :meth:`point`, :meth:`box` and :meth:`text_loc` calls in the last rendered
+        frame, and how many of them were not culled
+        """
+        return self._ctx.culling_stats
+
+    @property
+    def sdf(self):
+        """If True, :meth:`point` and :meth:`box` are drawn analytically in a fragment shader, all of them with a single
+        instanced draw call, instead of building a vector path for each one. Looks the same, but is much faster for
+        many primitives. Setting it raises an error if the OpenGL context does not support instancing
+        """
+        return self._ctx.sdf
+
+    @sdf.setter
+    def sdf(self, value):
+        self._ctx.sdf = value
+
+    @property
+    def swap_interval(self):
+        """Number of vertical blanks to wait for on swap. 0 disables vsync, which lowers latency, but may cause tearing. Default 1
+        """
+        return self._ctx.swap_interval
+
+    @swap_interval.setter
+    def swap_interval(self, value):
+        self._ctx.swap_interval = value
+
+    @property
+    def input_latency(self):
+        """Tuple of the last and the mean input-to-present latency in milliseconds. It is measured from the first input event
+        after the previous frame until the frame is swapped, or until the GPU has finished it in low latency mode
+        """
+        return self._ctx.input_latency, self._ctx.mean_input_latency
+
+    @property
+    def active_frames(self):
+        """Number of frames drawn so far
+        """
+        return self._ctx.active_frames
+
+    @property
+    def idle_frames(self):
+        """Number of event loop iterations that were skipped because there was nothing to redraw
+        """
+        return self._ctx.idle_frames
+
+    def frame_stats(self):
+        """Where the time of the last frames went. Stages are `new_frame` (input, camera, pending uploads),
+        `update` (:meth:`on_update`), `tessellation` (CPU time of building vector paths of :meth:`point`, :meth:`box`,
+        image shadows and cursor points, wherever they are drawn, excluded from the other stages), `images` (images,
+        annotation layers and SDF shapes), `nanovg` (flush of the vector paths), `text` and `swap`.
+
+        Returns:
+            dict - `stages` is the list of stage names, `cpu` and `gpu` are arrays of shape (frames, stages) with times
+            in milliseconds, oldest frame first. GPU time is NaN where it is not measured or not known yet.
+            `total` is CPU time of the frames and `interval` is the time between their starts.
+
+        Example:
+            >>> stats = app.frame_stats()
+            >>> print(dict(zip(stats['stages'], stats['cpu'].mean(axis=0))))
+        """
+        return self._ctx.frame_stats()
+
+    def start_trace(self):
+        """Starts recording a trace of frame stages, texture uploads and work of the loader and worker threads,
+        e.g. to attach it to a bug report. See :meth:`stop_trace`
+        """
+        self._ctx.start_trace()
+
+    def stop_trace(self, path):
+        """Stops recording and writes the trace to `path` in Chrome trace-event JSON format, which can be opened
+        in chrome://tracing or https://ui.perfetto.dev
+
+        Returns:
+            int - number of recorded events
+        """
+        return self._ctx.stop_trace(path)
+
+    @property
+    def queue_input(self):
+        """If True, input events are buffered while the frame is drawn and passed to :meth:`on_input` in one call at the
+        start of the next frame, instead of calling :meth:`on_mouse_position`, :meth:`on_mouse_button` and
+        :meth:`on_keyboard` from the event handlers. Mouse moves between other events are merged into one, so a
+        high-rate mouse costs one python call per frame. Panning and zoom are handled the same way in both modes
+        """
+        return self._ctx.input_queue
+
+    @queue_input.setter
+    def queue_input(self, value):
+        self._ctx.input_queue = value
+
+    @property
+    def input_dropped(self):
+        """Number of queued input events that were dropped, because the queue was not drained for too long
+        """
+        return self._ctx.input_dropped
+
+    @property
+    def frame_stats_overlay(self):
+        """If True, a graph of CPU time of the frame stages and their mean CPU and GPU times are drawn in the bottom left
+        corner. Default False
+        """
+        return self._ctx.frame_stats_overlay
+
+    @frame_stats_overlay.setter
+    def frame_stats_overlay(self, value):
+        self._ctx.frame_stats_overlay = value
 
     def on_update(self):
         """Is called each frame from the event loop that is run in :meth:`run` method
@@ -115,6 +354,37 @@ class App:
         """
         pass
 
+    def on_input(self, events):
+        """Is called once per frame with the input events since the previous frame, if :attr:`queue_input` is True
+
+        By default, it calls :meth:`on_mouse_position`, :meth:`on_mouse_button` and :meth:`on_keyboard` for each event,
+        as they are called without the queue. Overwrite it to process the events with numpy instead, e.g. to take
+        all cursor positions of a stroke at once.
+
+        .. warning::
+            * Don't call it, this is callback
+
+        Arguments:
+            events (numpy.ndarray): structured array, oldest event first, with fields: `time` (seconds), `type`
+                (:class:`anntoolkit.InputEvent`), `button` (mouse button or key), `action` (1 press, 0 release,
+                2 repeat), `mods`, `count` (number of merged events), `x`, `y` (window coordinate system),
+                `lx`, `ly` (image coordinate system) and `value` (scroll offset).
+
+        Example:
+            >>> def on_input(self, events):
+            >>>     moves = events[events['type'] == anntoolkit.InputEvent.MouseMove]
+            >>>     ...
+        """
+        for e in events:
+            t = e['type']
+            if t == anntoolkit.InputEvent.MouseMove:
+                self.on_mouse_position(float(e['x']), float(e['y']), float(e['lx']), float(e['ly']))
+            elif t == anntoolkit.InputEvent.MouseButton:
+                if e['button'] == 0:
+                    self.on_mouse_button(e['action'] == 1, float(e['x']), float(e['y']), float(e['lx']), float(e['ly']))
+            elif t == anntoolkit.InputEvent.Key:
+                self._keyboard(int(e['button']), int(e['action']), int(e['mods']))
+
     def on_mouse_button(self, down, x, y, lx, ly):
         """Is called on left mouse button event from event loop that is run in :meth:`run` method
         If the user presses left button on the mouse, this method is called
@@ -190,25 +460,161 @@ class App:
         """
         pass
 
-    def set_image(self, image, recenter=True):
+    def set_image(self, image=None, recenter=True, async_upload=False, tiled=None, key=None, compress=False):
         """ Sets the image to annotate
 
         .. note::
-            Must be numpy ndarray of type numpy.uint8
+            Must be numpy ndarray of type numpy.uint8, numpy.uint16 or numpy.float32, or an already created
+            :class:`anntoolkit.Image`, e.g. one returned by :meth:`anntoolkit.ImageLoader.get_image`,
+            or :class:`anntoolkit.Texture` loaded from a GPU-compressed DDS or KTX file
 
         Should have 2 dims (grayscale) or 3 dims (colored) with the last dim of size 3 for RGB case or 4 for RGBA case.
 
+        If `async_upload` is True, the image is streamed to the GPU in background and the previous image
+        stays on the screen until the transfer is done. Time spent is reported by `upload_time` and `upload_latency`
+        attributes of :class:`anntoolkit.Image`.
+
+        If `compress` is True, uint8 images are block compressed on the CPU before upload (BC4, BC5, BC7 or BC1),
+        which reduces video memory taken by the image 4 to 8 times. See `encode_time` and `bytes_saved`
+        attributes of :class:`anntoolkit.Image`.
+
+        If `tiled` is True, the image is displayed as :class:`anntoolkit.TiledImage`, which uploads only visible tiles.
+        By default, it is used when the image exceeds maximum texture size.
+
+        An :class:`anntoolkit.Image` can be set in several applications if they share textures, see `share` argument.
+
+        If `key` is given, e.g. path of the image, the uploaded image is kept in the texture cache of the context,
+        see :attr:`texture_cache`. If the cache already has an image with such key, it is displayed right away
+        and `image` may be None.
+
         Example:
             >>> im = imageio.imread('test_image.jpg')
             >>> app.set_image(im)
+
+            >>> app.set_image(anntoolkit.Texture('test_image_bc7.dds'))
+
+            >>> if not app.set_image(key=path):
+            >>>     app.set_image(imageio.imread(path), key=path)
+
+        Returns:
+            bool - False if only `key` was given and it is not in the cache, True otherwise
         """
-        # m = anntoolkit.generate_mipmaps(image)
-        # self._ctx.set(anntoolkit.Image(m))
+        # Textures are created in the context that is current, which is the one that was drawn last
+        self._ctx.make_current()
+        if key is not None:
+            cached = self._ctx.set(key) if recenter else self._ctx.set_without_recenter(key)
+            if cached is not None:
+                self.image = cached if image is None else image
+                return True
+        if image is None:
+            return False
+
         self.image = image
+        if isinstance(image, (anntoolkit.Image, anntoolkit.TiledImage, anntoolkit.Texture)):
+            im = image
+        else:
+            if tiled is None:
+                tiled = max(image.shape[:2]) > self._ctx.max_texture_size()
+            if tiled:
+                im = anntoolkit.TiledImage(image)
+            else:
+                im = anntoolkit.Image([image], async_upload, True, compress)
+        if key is not None and isinstance(im, anntoolkit.Image):
+            self._ctx.cache.put(key, im)
         if recenter:
-            self._ctx.set(anntoolkit.Image([image]))
+            self._ctx.set(im)
         else:
-            self._ctx.set_without_recenter(anntoolkit.Image([image]))
+            self._ctx.set_without_recenter(im)
+        return True
+
+    def set_window_level(self, window, level):
+        """Sets contrast of the displayed image. Range [level - window / 2, level + window / 2] of image values
+        is mapped to the display range. It is done on GPU, so changing it does not upload the image again.
+
+        Arguments:
+            window (float): width of the range in units of image data, e.g. 0..65535 for uint16. Zero resets to the full range.
+            level (float): center of the range in units of image data.
+        """
+        self._ctx.set_window_level(window, level)
+
+    @property
+    def gamma(self):
+        """Display gamma, applied after window/level. Default 1.0
+        """
+        return self._ctx.gamma
+
+    @gamma.setter
+    def gamma(self, value):
+        self._ctx.gamma = value
+
+    @property
+    def exposure(self):
+        """Exposure in stops, image values are multiplied by 2^exposure before window/level. Default 0.0
+        """
+        return self._ctx.exposure
+
+    @exposure.setter
+    def exposure(self, value):
+        self._ctx.exposure = value
+
+    @property
+    def annotations(self):
+        """:class:`anntoolkit.AnnotationLayer` of the context. Unlike :meth:`point`, :meth:`box` and :meth:`text_loc`,
+        which have to be called every frame from :meth:`on_update`, annotations added to the layer are kept between
+        frames and drawn until removed. Methods `add_point`, `add_box` and `add_label` return ids that are used to
+        update (`set_position`, `set_box`, `set_color`, `set_radius`, `set_text`) or `remove` them. Only changed
+        annotations are processed again, so large unchanged sets cost nothing per frame. The layer is not cleared
+        by :meth:`set_image`.
+
+        Example:
+            >>> self.ids = [self.annotations.add_point(x, y, (255, 0, 0, 250)) for x, y in points]
+            >>> self.annotations.set_position(self.ids[i], lx, ly)
+
+        For dense point sets, e.g. thousands of head annotations, set `lod` to True. When zoomed out, points that
+        are closer than `lod_spacing` window pixels are then merged into clusters with count badges.
+        """
+        return self._ctx.annotations
+
+    @property
+    def texture_cache(self):
+        """:class:`anntoolkit.TextureCache` of the context, that keeps images passed to :meth:`set_image` with a `key`.
+        Its `budget` is in bytes, `hits`, `misses`, `evictions` and `bytes` attributes give usage statistics.
+        """
+        return self._ctx.cache
+
+    def set_views(self, count, columns=0):
+        """Splits the window into a grid of views, e.g. to compare an image with its ground truth and predictions
+        of several models. Each view has its own image and annotations, but zoom and pan are shared, so all views
+        show the same region of their images. All views are drawn in one frame.
+
+        Arguments:
+            count (int): number of views. 1 returns to the single view mode.
+            columns (int): number of columns of the grid. Default 0, which makes the grid about square.
+
+        Example:
+            >>> app.set_views(4)
+            >>> for i, image in enumerate(images):
+            >>>     app.view = i
+            >>>     app.set_image(image)
+        """
+        self._ctx.set_views(count, columns)
+
+    @property
+    def view(self):
+        """Index of the current view. :meth:`set_image`, drawing methods and :attr:`annotations` apply to it.
+        Window coordinates passed to callbacks are converted to image space by the view under the cursor.
+        """
+        return self._ctx.view
+
+    @view.setter
+    def view(self, value):
+        self._ctx.view = value
+
+    @property
+    def view_count(self):
+        """Number of views, see :meth:`set_views`
+        """
+        return self._ctx.view_count
 
     def recenter(self):
         """ Resets zoom and recenters the image to fit in the window
@@ -279,6 +685,16 @@ class App:
         """
         self._ctx.point(x, y, color, radius)
 
+    def cursor_point(self, color, radius=5.0):
+        """Draw point under the mouse cursor. The cursor position is sampled right before the frame is submitted,
+        rather than at the start of the frame, so the point does not trail the cursor. Use it for the point being dragged
+
+        Arguments:
+            color (tuple[int, int, int, int]): RGBA color of the point
+            radius (float): radius of the point. Default 5.0.
+        """
+        self._ctx.cursor_point(color, radius)
+
     def win_2_loc(self, x, y):
         """Convert window space to image space
 
@@ -330,6 +746,38 @@ class App:
         maxx, maxy = box[1]
         self._ctx.box(minx, miny, maxx, maxy, color_stroke, color_fill)
 
+    def points(self, xy, colors, radii=5.0):
+        """Draw many points at once in image space. Much faster than calling :meth:`point` in a loop,
+        since arrays are read directly and geometry is built in native code without holding the GIL.
+        Points drawn this way are below the ones drawn with :meth:`point`, :meth:`box` and :meth:`text_loc`.
+
+        Arguments:
+            xy (numpy.ndarray): float32 array of shape (N, 2)
+            colors (numpy.ndarray): uint8 array of shape (N, 4), or a single RGBA color for all points
+            radii (numpy.ndarray): float32 array of shape (N,), or a single radius for all points. Default 5.0.
+        """
+        self._ctx.points(xy, colors, radii)
+
+    def boxes(self, boxes, colors_stroke, colors_fill):
+        """Draw many boxes at once in image space, see :meth:`points`
+
+        Arguments:
+            boxes (numpy.ndarray): float32 array of shape (N, 4) with minx, miny, maxx, maxy of each box
+            colors_stroke (numpy.ndarray): uint8 array of shape (N, 4), or a single RGBA color for all boxes
+            colors_fill (numpy.ndarray): uint8 array of shape (N, 4), or a single RGBA color for all boxes
+        """
+        self._ctx.boxes(boxes, colors_stroke, colors_fill)
+
+    def lines(self, segments, colors, width=1.0):
+        """Draw many line segments at once in image space, see :meth:`points`
+
+        Arguments:
+            segments (numpy.ndarray): float32 array of shape (N, 4) with x0, y0, x1, y1 of each segment
+            colors (numpy.ndarray): uint8 array of shape (N, 4), or a single RGBA color for all segments
+            width (float): width of the lines in window pixels. Default 1.0.
+        """
+        self._ctx.lines(segments, colors, width)
+
     @property
     def width(self):
         """Width of the window
@@ -0,0 +1,52 @@
+# Compares drawing of many points and boxes with per-primitive calls and with vectorized ones.
+# Usage: python scripts/benchmark_draw.py [--count 10000] [--frames 100]
+import argparse
+import time
+import numpy as np
+import anntoolkit
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--count', type=int, default=10000)
+    parser.add_argument('--frames', type=int, default=100)
+    args = parser.parse_args()
+
+    app = anntoolkit.App(title='benchmark')
+    app.swap_interval = 0
+    size = 2048
+    app.set_image(np.zeros((size, size, 3), dtype=np.uint8))
+
+    rng = np.random.RandomState(0)
+    xy = (rng.rand(args.count, 2) * size).astype(np.float32)
+    colors = rng.randint(0, 256, (args.count, 4)).astype(np.uint8)
+    boxes = np.concatenate([xy, xy + 20.0], axis=1)
+    xy_list = xy.tolist()
+    colors_list = [tuple(c) for c in colors.tolist()]
+    boxes_list = [[(b[0], b[1]), (b[2], b[3])] for b in boxes.tolist()]
+
+    def loop():
+        for p, c in zip(xy_list, colors_list):
+            app.point(p[0], p[1], c, 5.0)
+        for b, c in zip(boxes_list, colors_list):
+            app.box(b, c, (0, 0, 0, 0))
+
+    def vectorized():
+        app.points(xy, colors, 5.0)
+        app.boxes(boxes, colors, (0, 0, 0, 0))
+
+    for name, draw in [('per-call loop', loop), ('vectorized', vectorized)]:
+        submit = 0.0
+        start = time.perf_counter()
+        for _ in range(args.frames):
+            with app._ctx:
+                t = time.perf_counter()
+                draw()
+                submit += time.perf_counter() - t
+        total = time.perf_counter() - start
+        print('%-14s %d points + %d boxes: %.2f ms to submit, %.2f ms per frame' %
+              (name, args.count, args.count, submit * 1000.0 / args.frames, total * 1000.0 / args.frames))
+
+
+if __name__ == '__main__':
+    main()
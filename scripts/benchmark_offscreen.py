@@ -0,0 +1,62 @@
+# Measures throughput of headless preview rendering: offscreen frame with an image and points, read back to numpy,
+# and the same frames rendered to JPEG files with the pipelined render_batch.
+# Usage: python scripts/benchmark_offscreen.py [--size 512] [--count 1000] [--frames 100] [--threads 0]
+# For software rendering on a machine without GPU: LIBGL_ALWAYS_SOFTWARE=1 python scripts/benchmark_offscreen.py
+import argparse
+import os
+import tempfile
+import time
+import numpy as np
+import anntoolkit
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--size', type=int, default=512)
+    parser.add_argument('--count', type=int, default=1000)
+    parser.add_argument('--frames', type=int, default=100)
+    parser.add_argument('--threads', type=int, default=0)
+    args = parser.parse_args()
+
+    app = anntoolkit.App(args.size, args.size, offscreen=True)
+    rng = np.random.RandomState(0)
+    image_size = 2048
+    image = rng.randint(0, 256, (image_size, image_size, 3)).astype(np.uint8)
+    app.set_image(image)
+
+    xy = (rng.rand(args.count, 2) * image_size).astype(np.float32)
+    colors = rng.randint(0, 256, (args.count, 4)).astype(np.uint8)
+    app.on_update = lambda: app.points(xy, colors, 5.0)
+
+    # Warm up, shaders and textures are created on first use
+    app.render()
+
+    render = 0.0
+    read = 0.0
+    for _ in range(args.frames):
+        t0 = time.perf_counter()
+        with app._ctx:
+            app.on_update()
+        t1 = time.perf_counter()
+        pixels = app.read_pixels()
+        t2 = time.perf_counter()
+        render += t1 - t0
+        read += t2 - t1
+    total = render + read
+    print('%dx%d, %d points: %.2f ms render, %.2f ms read_pixels, %.1f images/s' %
+          (pixels.shape[1], pixels.shape[0], args.count, render * 1000.0 / args.frames, read * 1000.0 / args.frames,
+           args.frames / total))
+
+    directory = tempfile.mkdtemp()
+    jobs = [(image, {'points': (xy, colors, 5.0)}, os.path.join(directory, '%d.jpg' % i)) for i in range(args.frames)]
+    stats = app.render_batch(jobs, threads=args.threads)
+    print('render_batch: %.2f ms decode, %.2f ms upload, %.2f ms render, %.2f ms readback, %.2f ms encode per image, '
+          '%.1f images/s' % (stats['decode'], stats['upload'], stats['render'], stats['readback'], stats['encode'],
+                             stats['images_per_second']))
+    for _, _, path in jobs:
+        os.remove(path)
+    os.rmdir(directory)
+
+
+if __name__ == '__main__':
+    main()
@@ -193,7 +193,7 @@ definitions = {
 
 libs = {
     'darwin': [],
-    'posix': ["rt", "m", "X11", "stdc++fs"],
+    'posix': ["rt", "m", "X11", "stdc++fs", "dl"],
     'win32': ["gdi32", "opengl32", "Shell32", "User32"],
 }
 
@@ -229,6 +229,7 @@ extension = Extension("_anntoolkit",
                                  "libs/glm",
                                  "libs/pybind11/include",
                                  "libs/imgui",
+                                 "libs/stb",
                                  "libs/gl3w/include"],
                              extra_compile_args=extra_compile_args[target_os],
                              extra_link_args=extra_link[target_os],
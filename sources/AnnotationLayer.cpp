@@ -0,0 +1,687 @@
+#include "AnnotationLayer.h"
+#include "ThreadPool.h"
+#include "runtime_error.h"
+#include <simpletext.h>
+#include <GL/gl3w.h>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <string>
+
+
+namespace
+{
+	glm::vec<4, uint8_t> ToVec(const AnnotationLayer::Color& c)
+	{
+		return glm::vec<4, uint8_t>(std::get<0>(c), std::get<1>(c), std::get<2>(c), std::get<3>(c));
+	}
+
+	// Unit circle, the first point is repeated at the end
+	struct Circle
+	{
+		Circle()
+		{
+			for (int i = 0; i <= AnnotationLayer::CircleSegments; ++i)
+			{
+				float angle = 2.0f * glm::pi<float>() * float(i % AnnotationLayer::CircleSegments) / AnnotationLayer::CircleSegments;
+				points[i] = glm::vec2(cosf(angle), sinf(angle));
+			}
+		}
+		glm::vec2 points[AnnotationLayer::CircleSegments + 1];
+	};
+
+	const glm::vec2* GetCircle()
+	{
+		static const Circle circle;
+		return circle.points;
+	}
+}
+
+
+AnnotationLayer::~AnnotationLayer()
+{
+	if (m_buffer != 0)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		glDeleteBuffers(1, &m_immediateBuffer);
+		glDeleteBuffers(1, &m_lodBuffer);
+	}
+}
+
+void AnnotationLayer::Init()
+{
+	const char* vertex_shader_src = R"(
+		uniform mat3 u_transform;
+		uniform vec2 u_viewport;
+
+		attribute vec2 a_position;
+		attribute vec2 a_offset;
+		attribute vec4 a_color;
+
+		varying vec4 v_color;
+
+		void main()
+		{
+			v_color = a_color;
+			vec2 p = (u_transform * vec3(a_position, 1.0)).xy + a_offset;
+			gl_Position = vec4(p / u_viewport * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+		}
+	)";
+
+	const char* fragment_shader_src = R"(
+		varying vec4 v_color;
+
+		void main()
+		{
+			// Same as nanovg: premultiplied alpha, colors are converted to linear space, since GL_FRAMEBUFFER_SRGB is enabled
+			gl_FragColor = vec4(pow(v_color.rgb * v_color.a, vec3(2.2)), v_color.a);
+		}
+	)";
+
+	m_program = Render::MakeProgram(vertex_shader_src, fragment_shader_src);
+	u_transform = m_program->GetUniform("u_transform");
+	u_viewport = m_program->GetUniform("u_viewport");
+
+	m_spec = Render::VertexSpecMaker()
+			.PushType<glm::vec2>("a_position")
+			.PushType<glm::vec2>("a_offset")
+			.PushType<glm::vec<4, uint8_t> >("a_color", true);
+	m_spec.CollectHandles(m_program);
+
+	glGenBuffers(1, &m_buffer);
+	glGenBuffers(1, &m_immediateBuffer);
+	glGenBuffers(1, &m_lodBuffer);
+}
+
+uint32_t AnnotationLayer::AddPoint(glm::vec2 pos, Color color, float radius)
+{
+	Primitive p;
+	p.kind = PointKind;
+	p.a = pos;
+	p.color = color;
+	p.radius = radius;
+	return Add(std::move(p));
+}
+
+uint32_t AnnotationLayer::AddBox(glm::vec2 min, glm::vec2 max, Color stroke, Color fill)
+{
+	Primitive p;
+	p.kind = BoxKind;
+	p.a = min;
+	p.b = max;
+	p.color = stroke;
+	p.color2 = fill;
+	return Add(std::move(p));
+}
+
+uint32_t AnnotationLayer::AddLabel(const std::string& text, glm::vec2 pos, int alignment)
+{
+	Primitive p;
+	p.kind = LabelKind;
+	p.a = pos;
+	p.text = text;
+	p.alignment = alignment;
+	return Add(std::move(p));
+}
+
+uint32_t AnnotationLayer::AddLabel(const std::string& text, glm::vec2 pos, Color color, Color background, int alignment)
+{
+	Primitive p;
+	p.kind = LabelKind;
+	p.a = pos;
+	p.text = text;
+	p.alignment = alignment;
+	p.color = color;
+	p.color2 = background;
+	p.custom_color = true;
+	return Add(std::move(p));
+}
+
+uint32_t AnnotationLayer::Add(Primitive&& p)
+{
+	uint32_t id = m_nextId++;
+	Primitive& added = m_primitives.emplace(id, std::move(p)).first->second;
+	Tessellate(added);
+	Track(added, 1);
+	m_labelCount += added.kind == LabelKind ? 1 : 0;
+	m_layoutChanged = m_layoutChanged || !added.vertices.empty();
+	m_changed = true;
+	return id;
+}
+
+AnnotationLayer::Primitive& AnnotationLayer::Get(uint32_t id)
+{
+	auto it = m_primitives.find(id);
+	if (it == m_primitives.end())
+	{
+		throw runtime_error("No annotation with id %d", (int)id);
+	}
+	return it->second;
+}
+
+void AnnotationLayer::Changed(uint32_t id, Primitive& p)
+{
+	m_changed = true;
+	if (p.kind == LabelKind)
+	{
+		return;
+	}
+	size_t count = p.vertices.size();
+	Tessellate(p);
+	if (count != p.vertices.size())
+	{
+		m_layoutChanged = true;
+	}
+	else if (!p.dirty)
+	{
+		// Ids are looked up on upload, so primitives that are removed in the meantime are skipped
+		p.dirty = true;
+		m_dirty.push_back(id);
+	}
+}
+
+void AnnotationLayer::SetPosition(uint32_t id, glm::vec2 pos)
+{
+	Primitive& p = Get(id);
+	if (p.kind == BoxKind)
+	{
+		throw runtime_error("Annotation %d is a box, use set_box to move it", (int)id);
+	}
+	Track(p, -1);
+	p.a = pos;
+	Track(p, 1);
+	Changed(id, p);
+}
+
+void AnnotationLayer::SetBox(uint32_t id, glm::vec2 min, glm::vec2 max)
+{
+	Primitive& p = Get(id);
+	if (p.kind != BoxKind)
+	{
+		throw runtime_error("Annotation %d is not a box", (int)id);
+	}
+	p.a = min;
+	p.b = max;
+	Changed(id, p);
+}
+
+void AnnotationLayer::SetColor(uint32_t id, Color color)
+{
+	Primitive& p = Get(id);
+	if (p.kind == LabelKind && !p.custom_color)
+	{
+		p.color2 = Color(0, 0, 0, 0);
+		p.custom_color = true;
+	}
+	Track(p, -1);
+	p.color = color;
+	Track(p, 1);
+	Changed(id, p);
+}
+
+void AnnotationLayer::SetRadius(uint32_t id, float radius)
+{
+	Primitive& p = Get(id);
+	if (p.kind != PointKind)
+	{
+		throw runtime_error("Annotation %d is not a point", (int)id);
+	}
+	Track(p, -1);
+	p.radius = radius;
+	Track(p, 1);
+	Changed(id, p);
+}
+
+void AnnotationLayer::SetText(uint32_t id, const std::string& text)
+{
+	Primitive& p = Get(id);
+	if (p.kind != LabelKind)
+	{
+		throw runtime_error("Annotation %d is not a label", (int)id);
+	}
+	p.text = text;
+	Changed(id, p);
+}
+
+bool AnnotationLayer::Remove(uint32_t id)
+{
+	auto it = m_primitives.find(id);
+	if (it == m_primitives.end())
+	{
+		return false;
+	}
+	m_layoutChanged = m_layoutChanged || !it->second.vertices.empty();
+	m_changed = true;
+	m_labelCount -= it->second.kind == LabelKind ? 1 : 0;
+	Track(it->second, -1);
+	m_primitives.erase(it);
+	return true;
+}
+
+void AnnotationLayer::Clear()
+{
+	m_layoutChanged = m_layoutChanged || !m_primitives.empty();
+	m_changed = m_changed || !m_primitives.empty();
+	m_primitives.clear();
+	m_labelCount = 0;
+	m_grid.Clear();
+}
+
+void AnnotationLayer::SetLOD(bool enable)
+{
+	if (enable == m_lod)
+	{
+		return;
+	}
+	m_lod = enable;
+	m_grid.Clear();
+	for (auto& it: m_primitives)
+	{
+		Track(it.second, 1);
+	}
+	m_lodLevel = -1;
+	m_lodVertices.clear();
+	m_badges.clear();
+	m_lodActive = false;
+	m_clusters = 0;
+	// Points are moved to the end of the buffer
+	m_layoutChanged = true;
+	m_changed = true;
+}
+
+void AnnotationLayer::SetLODSpacing(float spacing)
+{
+	if (spacing == m_lodSpacing)
+	{
+		return;
+	}
+	m_lodSpacing = spacing;
+	// Clusters are rebuilt on the next Draw
+	m_lodLevel = -1;
+	m_changed = true;
+}
+
+void AnnotationLayer::SetVisible(bool visible)
+{
+	if (visible == m_visible)
+	{
+		return;
+	}
+	m_visible = visible;
+	m_changed = true;
+}
+
+void AnnotationLayer::Track(const Primitive& p, int sign)
+{
+	if (!m_lod || p.kind != PointKind)
+	{
+		return;
+	}
+	auto c = ToVec(p.color);
+	if (sign > 0)
+	{
+		m_grid.Add(p.a, glm::vec4(c), p.radius);
+	}
+	else
+	{
+		m_grid.Remove(p.a, glm::vec4(c), p.radius);
+	}
+}
+
+void AnnotationLayer::UpdateLOD(const glm::mat3& canvas_to_world, int display_w, int display_h)
+{
+	// Camera only scales and translates
+	float scale = canvas_to_world[0][0];
+	int level = PointGrid::GetLevel(m_lodSpacing / scale);
+	float cell = ldexpf(1.0f, level);
+
+	glm::mat3 world_to_canvas = glm::inverse(canvas_to_world);
+	glm::vec2 a = world_to_canvas * glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec2 b = world_to_canvas * glm::vec3(display_w, display_h, 1.0f);
+	// One cell of margin, so that clusters at the border of the window do not pop
+	glm::aabb2 rect(glm::min(a, b) - cell, glm::max(a, b) + cell);
+	glm::ivec4 range = PointGrid::GetCellRange(level, rect);
+
+	if (level == m_lodLevel && range == m_lodRange && m_grid.GetVersion() == m_lodVersion)
+	{
+		return;
+	}
+	m_lodLevel = level;
+	m_lodRange = range;
+	m_lodVersion = m_grid.GetVersion();
+	m_lodVertices.clear();
+	m_badges.clear();
+
+	m_lodActive = false;
+	m_grid.ForEach(level, range, [&](const PointGrid::Cell& c)
+	{
+		m_lodActive = m_lodActive || c.count > 1;
+	});
+	if (m_lodActive)
+	{
+		m_grid.ForEach(level, range, [&](const PointGrid::Cell& c)
+		{
+			glm::vec2 pos = c.GetPos();
+			float radius = c.GetRadius();
+			if (c.count > 1)
+			{
+				// Grows with the number of points, but stays within the cell
+				radius = std::max(radius, std::min(radius * (1.0f + 0.5f * log2f(float(c.count))), 0.5f * cell * scale));
+				m_badges.emplace_back(pos, c.count);
+			}
+			size_t offset = m_lodVertices.size();
+			m_lodVertices.resize(offset + PointVertexCount);
+			EmitPoint(m_lodVertices.data() + offset, pos, glm::vec<4, uint8_t>(glm::round(c.GetColor())), radius);
+		});
+		glBindBuffer(GL_ARRAY_BUFFER, m_lodBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_lodVertices.size() * sizeof(Vertex), m_lodVertices.data(), GL_DYNAMIC_DRAW);
+	}
+	m_clusters = m_badges.size();
+}
+
+AnnotationLayer::Vertex* AnnotationLayer::EmitPoint(Vertex* out, glm::vec2 pos, glm::vec<4, uint8_t> color, float radius)
+{
+	const glm::vec2* circle = GetCircle();
+	// Soft shadow around the point. Approximates the one drawn by Context::Point with a short ring that fades from the
+	// alpha of the point, nanovg draws a wider box gradient from opaque black
+	auto shadow_inner = glm::vec<4, uint8_t>(0, 0, 0, color.a);
+	auto shadow_outer = glm::vec<4, uint8_t>(0, 0, 0, 0);
+	float outer = radius + std::max(1.0f, radius * 0.3f);
+	for (int i = 0; i < CircleSegments; ++i)
+	{
+		*out++ = { pos, glm::vec2(0.0f), color };
+		*out++ = { pos, circle[i] * radius, color };
+		*out++ = { pos, circle[i + 1] * radius, color };
+
+		*out++ = { pos, circle[i] * radius, shadow_inner };
+		*out++ = { pos, circle[i] * outer, shadow_outer };
+		*out++ = { pos, circle[i + 1] * outer, shadow_outer };
+		*out++ = { pos, circle[i] * radius, shadow_inner };
+		*out++ = { pos, circle[i + 1] * outer, shadow_outer };
+		*out++ = { pos, circle[i + 1] * radius, shadow_inner };
+	}
+	return out;
+}
+
+AnnotationLayer::Vertex* AnnotationLayer::EmitLine(Vertex* out, glm::vec2 p0, glm::vec2 p1, glm::vec<4, uint8_t> color, float width)
+{
+	// Camera does not rotate, so direction in image space is the same as on screen
+	glm::vec2 d = p1 - p0;
+	d = glm::dot(d, d) > 0.0f ? glm::normalize(d) * (width * 0.5f) : glm::vec2(width * 0.5f, 0.0f);
+	glm::vec2 n(-d.y, d.x);
+	// Ends are extended by half of the width, so that lines meeting at a corner close it
+	*out++ = { p0, -d - n, color };
+	*out++ = { p1, d - n, color };
+	*out++ = { p1, d + n, color };
+	*out++ = { p0, -d - n, color };
+	*out++ = { p1, d + n, color };
+	*out++ = { p0, -d + n, color };
+	return out;
+}
+
+AnnotationLayer::Vertex* AnnotationLayer::EmitBox(Vertex* out, glm::vec2 min, glm::vec2 max, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill)
+{
+	glm::vec2 corners[4] = { min, glm::vec2(max.x, min.y), max, glm::vec2(min.x, max.y) };
+	*out++ = { corners[0], glm::vec2(0.0f), fill };
+	*out++ = { corners[1], glm::vec2(0.0f), fill };
+	*out++ = { corners[2], glm::vec2(0.0f), fill };
+	*out++ = { corners[0], glm::vec2(0.0f), fill };
+	*out++ = { corners[2], glm::vec2(0.0f), fill };
+	*out++ = { corners[3], glm::vec2(0.0f), fill };
+	for (int i = 0; i < 4; ++i)
+	{
+		out = EmitLine(out, corners[i], corners[(i + 1) % 4], stroke, 1.0f);
+	}
+	return out;
+}
+
+void AnnotationLayer::Tessellate(Primitive& p)
+{
+	m_tessellations += 1;
+	switch (p.kind)
+	{
+		case PointKind:
+			p.vertices.resize(PointVertexCount);
+			EmitPoint(p.vertices.data(), p.a, ToVec(p.color), p.radius);
+			break;
+		case BoxKind:
+			p.vertices.resize(BoxVertexCount);
+			EmitBox(p.vertices.data(), p.a, p.b, ToVec(p.color), ToVec(p.color2));
+			break;
+		case LabelKind:
+			break;
+	}
+}
+
+AnnotationLayer::Vertex* AnnotationLayer::AllocateImmediate(size_t count)
+{
+	size_t offset = m_immediate.size();
+	m_immediate.resize(offset + count);
+	return m_immediate.data() + offset;
+}
+
+void AnnotationLayer::Points(const float* xy, size_t count, const uint8_t* colors, size_t color_stride, const float* radii, size_t radius_stride)
+{
+	Vertex* out = AllocateImmediate(count * PointVertexCount);
+	ThreadPool::GetDefault().ParallelFor(0, (int)count, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const uint8_t* c = colors + i * color_stride;
+			EmitPoint(out + size_t(i) * PointVertexCount, glm::vec2(xy[2 * i], xy[2 * i + 1]),
+					glm::vec<4, uint8_t>(c[0], c[1], c[2], c[3]), radii[i * radius_stride]);
+		}
+	}, ImmediateGrain);
+}
+
+void AnnotationLayer::Boxes(const float* boxes, size_t count, const uint8_t* stroke, size_t stroke_stride, const uint8_t* fill, size_t fill_stride)
+{
+	Vertex* out = AllocateImmediate(count * BoxVertexCount);
+	ThreadPool::GetDefault().ParallelFor(0, (int)count, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const float* b = boxes + 4 * i;
+			const uint8_t* s = stroke + i * stroke_stride;
+			const uint8_t* f = fill + i * fill_stride;
+			EmitBox(out + size_t(i) * BoxVertexCount, glm::vec2(b[0], b[1]), glm::vec2(b[2], b[3]),
+					glm::vec<4, uint8_t>(s[0], s[1], s[2], s[3]), glm::vec<4, uint8_t>(f[0], f[1], f[2], f[3]));
+		}
+	}, ImmediateGrain);
+}
+
+void AnnotationLayer::Lines(const float* segments, size_t count, const uint8_t* colors, size_t color_stride, float width)
+{
+	Vertex* out = AllocateImmediate(count * LineVertexCount);
+	ThreadPool::GetDefault().ParallelFor(0, (int)count, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const float* l = segments + 4 * i;
+			const uint8_t* c = colors + i * color_stride;
+			EmitLine(out + size_t(i) * LineVertexCount, glm::vec2(l[0], l[1]), glm::vec2(l[2], l[3]),
+					glm::vec<4, uint8_t>(c[0], c[1], c[2], c[3]), width);
+		}
+	}, ImmediateGrain);
+}
+
+void AnnotationLayer::Draw(const glm::mat3& canvas_to_world, int display_w, int display_h, SimpleText& text)
+{
+	// A hidden layer has nothing to redraw, its updates wait until SetVisible marks it changed again
+	m_changed = false;
+
+	if (m_visible && m_layoutChanged)
+	{
+		m_vertices.clear();
+		// With LOD, the first pass takes everything but points, the second one takes points
+		for (int pass = 0; pass < (m_lod ? 2 : 1); ++pass)
+		{
+			if (pass == 1)
+			{
+				m_pointOffset = m_vertices.size();
+			}
+			for (auto& it: m_primitives)
+			{
+				Primitive& p = it.second;
+				if (m_lod && (p.kind == PointKind) != (pass == 1))
+				{
+					continue;
+				}
+				p.offset = m_vertices.size();
+				p.dirty = false;
+				m_vertices.insert(m_vertices.end(), p.vertices.begin(), p.vertices.end());
+			}
+		}
+		if (!m_lod)
+		{
+			m_pointOffset = m_vertices.size();
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(), GL_DYNAMIC_DRAW);
+		m_fullUploads += 1;
+		m_layoutChanged = false;
+		m_dirty.clear();
+	}
+	else if (m_visible && !m_dirty.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		for (uint32_t id: m_dirty)
+		{
+			auto it = m_primitives.find(id);
+			if (it == m_primitives.end() || !it->second.dirty)
+			{
+				continue;
+			}
+			Primitive& p = it->second;
+			memcpy(m_vertices.data() + p.offset, p.vertices.data(), p.vertices.size() * sizeof(Vertex));
+			glBufferSubData(GL_ARRAY_BUFFER, p.offset * sizeof(Vertex), p.vertices.size() * sizeof(Vertex), p.vertices.data());
+			p.dirty = false;
+			m_partialUploads += 1;
+		}
+		m_dirty.clear();
+	}
+
+	bool clustered = false;
+	if (m_visible && m_lod && m_grid.GetCount() != 0)
+	{
+		UpdateLOD(canvas_to_world, display_w, display_h);
+		clustered = m_lodActive;
+	}
+	else
+	{
+		m_clusters = 0;
+	}
+
+	// When points are clustered, they are drawn from the LOD buffer instead of the main one
+	size_t retained_count = clustered ? m_pointOffset : m_vertices.size();
+	bool retained = m_visible && retained_count != 0;
+	if (retained || clustered || !m_immediate.empty())
+	{
+		GLboolean blend = glIsEnabled(GL_BLEND);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+		m_program->Use();
+		u_transform.ApplyValue(canvas_to_world);
+		u_viewport.ApplyValue(glm::vec2(display_w, display_h));
+
+		if (retained)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			m_spec.Enable();
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)retained_count);
+			m_spec.Disable();
+		}
+		if (clustered)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_lodBuffer);
+			m_spec.Enable();
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_lodVertices.size());
+			m_spec.Disable();
+		}
+		if (!m_immediate.empty())
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, m_immediateBuffer);
+			glBufferData(GL_ARRAY_BUFFER, m_immediate.size() * sizeof(Vertex), m_immediate.data(), GL_STREAM_DRAW);
+			m_spec.Enable();
+			glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_immediate.size());
+			m_spec.Disable();
+			m_immediate.clear();
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (!blend)
+		{
+			glDisable(GL_BLEND);
+		}
+	}
+
+	for (auto it = m_primitives.begin(); m_visible && m_labelCount != 0 && it != m_primitives.end(); ++it)
+	{
+		const Primitive& p = it->second;
+		if (p.kind != LabelKind)
+		{
+			continue;
+		}
+		glm::vec2 pos = canvas_to_world * glm::vec3(p.a, 1.0f);
+		if (p.custom_color)
+		{
+			auto c = p.color;
+			auto bg = p.color2;
+			text.SetColorf(SimpleText::TEXT_COLOR, std::get<0>(c) / 255.f, std::get<1>(c) / 255.f, std::get<2>(c) / 255.f, std::get<3>(c) / 255.f);
+			text.SetColorf(SimpleText::BACKGROUND_COLOR, std::get<0>(bg) / 255.f, std::get<1>(bg) / 255.f, std::get<2>(bg) / 255.f, std::get<3>(bg) / 255.f);
+			text.EnableBlending(true);
+		}
+		text.Label(p.text.c_str(), pos.x, pos.y, (SimpleText::Alignment)p.alignment);
+		if (p.custom_color)
+		{
+			text.ResetFont();
+		}
+	}
+
+	for (size_t i = 0; clustered && i < m_badges.size(); ++i)
+	{
+		glm::vec2 pos = canvas_to_world * glm::vec3(m_badges[i].first, 1.0f);
+		text.Label(std::to_string(m_badges[i].second).c_str(), pos.x, pos.y, SimpleText::CENTER);
+	}
+}
+
+
+#include <doctest.h>
+
+TEST_CASE("[AnnotationLayer] Ids and change tracking")
+{
+	AnnotationLayer layer;
+	auto red = AnnotationLayer::Color(255, 0, 0, 255);
+	auto a = layer.AddPoint(glm::vec2(10.0f, 20.0f), red, 5.0f);
+	auto b = layer.AddBox(glm::vec2(0.0f), glm::vec2(8.0f), red, AnnotationLayer::Color(0, 0, 0, 0));
+	auto c = layer.AddLabel("label", glm::vec2(1.0f), 0);
+	CHECK_NE(a, b);
+	CHECK_NE(b, c);
+	CHECK_EQ(layer.GetCount(), 3);
+	CHECK(layer.HasChanges());
+	CHECK_EQ(layer.m_tessellations, 3);
+
+	// Only the changed primitive is tessellated again
+	layer.SetPosition(a, glm::vec2(11.0f, 21.0f));
+	layer.SetColor(a, AnnotationLayer::Color(0, 255, 0, 255));
+	CHECK_EQ(layer.m_tessellations, 5);
+	layer.SetText(c, "other");
+	CHECK_EQ(layer.m_tessellations, 5);
+
+	REQUIRE_THROWS(layer.SetPosition(b, glm::vec2(0.0f)));
+	REQUIRE_THROWS(layer.SetRadius(c, 1.0f));
+
+	CHECK(layer.Remove(b));
+	CHECK_FALSE(layer.Remove(b));
+	CHECK_FALSE(layer.Contains(b));
+	REQUIRE_THROWS(layer.SetBox(b, glm::vec2(0.0f), glm::vec2(1.0f)));
+
+	// Ids are not reused
+	auto d = layer.AddPoint(glm::vec2(0.0f), red, 5.0f);
+	CHECK_GT(d, c);
+	layer.Clear();
+	CHECK_EQ(layer.GetCount(), 0);
+	CHECK_FALSE(layer.Contains(a));
+}
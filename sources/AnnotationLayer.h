@@ -0,0 +1,212 @@
+#pragma once
+#include "PointGrid.h"
+#include "Shader.h"
+#include "VertexSpec.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class SimpleText;
+
+
+// Annotations that are kept between frames, so that they do not have to be issued again each frame.
+// Primitives are identified by ids, which stay valid until the primitive is removed. A primitive is tessellated when it
+// is added or changed, and vertices of all primitives are kept in a single vertex buffer. Only changed ranges of
+// the buffer are uploaded, unless primitives were added or removed. Drawing an unchanged layer is a single draw call.
+// Points have radius in window pixels and keep it when zooming, boxes and positions are in image space.
+// Besides that, there are immediate-mode batches of points, boxes and lines, which are drawn in the current frame only.
+// With level of detail enabled, points that are closer on screen than the LOD spacing are drawn as clusters with count
+// badges. Clusters come from a multi-resolution grid that is updated along with the points, so their cost depends on
+// the window size and not on the number of points.
+class AnnotationLayer
+{
+public:
+	typedef std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> Color;
+
+	enum
+	{
+		CircleSegments = 16,
+		PointVertexCount = CircleSegments * 9,
+		LineVertexCount = 6,
+		BoxVertexCount = 6 + 4 * LineVertexCount,
+		// Number of primitives per task when building immediate batches
+		ImmediateGrain = 2048
+	};
+
+	struct Vertex
+	{
+		// Image space
+		glm::vec2 pos;
+		// Framebuffer pixels, added after the camera transform
+		glm::vec2 offset;
+		glm::vec<4, uint8_t> color;
+	};
+
+	AnnotationLayer& operator=(const AnnotationLayer&) = delete;
+	AnnotationLayer(const AnnotationLayer&) = delete;
+	AnnotationLayer() = default;
+
+	~AnnotationLayer();
+
+	void Init();
+
+	uint32_t AddPoint(glm::vec2 pos, Color color, float radius);
+	uint32_t AddBox(glm::vec2 min, glm::vec2 max, Color stroke, Color fill);
+	// Label with the default colors of the text renderer
+	uint32_t AddLabel(const std::string& text, glm::vec2 pos, int alignment);
+	uint32_t AddLabel(const std::string& text, glm::vec2 pos, Color color, Color background, int alignment);
+
+	// Setters throw if there is no primitive with such id, or if it has no such property.
+	// Moves point or label. Boxes are moved with SetBox
+	void SetPosition(uint32_t id, glm::vec2 pos);
+	void SetBox(uint32_t id, glm::vec2 min, glm::vec2 max);
+	// Color of a point, stroke color of a box or text color of a label
+	void SetColor(uint32_t id, Color color);
+	void SetRadius(uint32_t id, float radius);
+	void SetText(uint32_t id, const std::string& text);
+
+	// Returns false if there is no primitive with such id
+	bool Remove(uint32_t id);
+	void Clear();
+
+	bool Contains(uint32_t id) const
+	{
+		return m_primitives.find(id) != m_primitives.end();
+	}
+
+	size_t GetCount() const
+	{
+		return m_primitives.size();
+	}
+
+	// Immediate batches. Positions are image space float pairs: xy for points, (minx, miny, maxx, maxy) for boxes and
+	// (x0, y0, x1, y1) for lines. Colors are RGBA, radii are in window pixels. Consecutive colors and radii are `*_stride`
+	// elements apart, stride of zero uses the same value for all primitives. Geometry is built on the default thread pool
+	// and no Python objects are touched, so it can be called with the GIL released.
+	void Points(const float* xy, size_t count, const uint8_t* colors, size_t color_stride, const float* radii, size_t radius_stride);
+	void Boxes(const float* boxes, size_t count, const uint8_t* stroke, size_t stroke_stride, const uint8_t* fill, size_t fill_stride);
+	void Lines(const float* segments, size_t count, const uint8_t* colors, size_t color_stride, float width);
+
+	// Enables clustering of points. While enabled, points are drawn after boxes, regardless of their ids
+	void SetLOD(bool enable);
+
+	bool GetLOD() const
+	{
+		return m_lod;
+	}
+
+	// Points closer than this many window pixels are clustered, when LOD is enabled
+	void SetLODSpacing(float spacing);
+
+	float GetLODSpacing() const
+	{
+		return m_lodSpacing;
+	}
+
+	// Changes made while the layer is hidden are uploaded when it is shown again
+	void SetVisible(bool visible);
+
+	bool GetVisible() const
+	{
+		return m_visible;
+	}
+
+	// True if anything has changed since the last Draw
+	bool HasChanges() const
+	{
+		return m_changed;
+	}
+
+	// `canvas_to_world` maps image space to framebuffer pixels. Labels are queued to `text`, which is rendered later
+	void Draw(const glm::mat3& canvas_to_world, int display_w, int display_h, SimpleText& text);
+
+	// Statistics
+	size_t m_tessellations = 0;
+	size_t m_fullUploads = 0;
+	size_t m_partialUploads = 0;
+	// Clusters of two or more points drawn in the last frame, zero if no point was clustered
+	size_t m_clusters = 0;
+
+private:
+	enum Kind
+	{
+		PointKind,
+		BoxKind,
+		LabelKind
+	};
+
+	struct Primitive
+	{
+		Kind kind;
+		glm::vec2 a;
+		glm::vec2 b;
+		Color color;
+		Color color2;
+		float radius = 0.0f;
+		std::string text;
+		int alignment = 0;
+		bool custom_color = false;
+
+		std::vector<Vertex> vertices;
+		// Offset of the vertices in the buffer
+		size_t offset = 0;
+		bool dirty = false;
+	};
+
+	// Write fixed number of vertices, see *VertexCount, and return pointer past the last one
+	static Vertex* EmitPoint(Vertex* out, glm::vec2 pos, glm::vec<4, uint8_t> color, float radius);
+	static Vertex* EmitLine(Vertex* out, glm::vec2 p0, glm::vec2 p1, glm::vec<4, uint8_t> color, float width);
+	static Vertex* EmitBox(Vertex* out, glm::vec2 min, glm::vec2 max, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill);
+
+	Vertex* AllocateImmediate(size_t count);
+
+	uint32_t Add(Primitive&& p);
+	Primitive& Get(uint32_t id);
+	void Changed(uint32_t id, Primitive& p);
+	void Tessellate(Primitive& p);
+	// Adds (sign = 1) or removes (sign = -1) point from the grid, if LOD is enabled
+	void Track(const Primitive& p, int sign);
+	// Rebuilds clusters if the camera moved to other cells, or points have changed
+	void UpdateLOD(const glm::mat3& canvas_to_world, int display_w, int display_h);
+
+	// Ordered by id, so primitives are drawn in the order they were added
+	std::map<uint32_t, Primitive> m_primitives;
+	uint32_t m_nextId = 1;
+	size_t m_labelCount = 0;
+
+	bool m_changed = false;
+	bool m_visible = true;
+	float m_lodSpacing = 32.0f;
+	// Primitives were added, removed or changed the number of vertices, the whole buffer has to be rebuilt
+	bool m_layoutChanged = false;
+	std::vector<uint32_t> m_dirty;
+
+	std::vector<Vertex> m_vertices;
+	uint32_t m_buffer = 0;
+
+	bool m_lod = false;
+	PointGrid m_grid;
+	// With LOD, vertices of points are placed after all other vertices, starting from this offset
+	size_t m_pointOffset = 0;
+	// Clusters are rebuilt only when any of these change
+	int m_lodLevel = -1;
+	glm::ivec4 m_lodRange;
+	uint64_t m_lodVersion = 0;
+	// False if no point is clustered at the current scale, then points are drawn from the main buffer
+	bool m_lodActive = false;
+	std::vector<Vertex> m_lodVertices;
+	// Image-space positions and sizes of clusters, for the count badges
+	std::vector<std::pair<glm::vec2, uint32_t> > m_badges;
+	uint32_t m_lodBuffer = 0;
+
+	std::vector<Vertex> m_immediate;
+	uint32_t m_immediateBuffer = 0;
+
+	Render::ProgramPtr m_program;
+	Render::VertexSpec m_spec;
+	Render::Uniform u_transform;
+	Render::Uniform u_viewport;
+};
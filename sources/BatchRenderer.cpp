@@ -0,0 +1,291 @@
+#include "BatchRenderer.h"
+#include "Framebuffer.h"
+#include "Tracer.h"
+#include "runtime_error.h"
+#include <stb_image_write.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ctype.h>
+#include <string.h>
+
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double GetMilliseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool IsJPEG(const std::string& path)
+	{
+		auto dot = path.find_last_of('.');
+		if (dot == std::string::npos)
+		{
+			return false;
+		}
+		std::string extension = path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+		return extension == "jpg" || extension == "jpeg";
+	}
+}
+
+
+BatchRenderer::BatchRenderer(int threads, int quality): m_quality(quality), m_pool(threads)
+{
+}
+
+void BatchRenderer::Encode(const std::string& path, const uint8_t* pixels, int width, int height, int quality)
+{
+	TRACE_SCOPE("BatchRenderer::Encode", "batch");
+	// Flip and drop alpha in one pass, stb_image_write's flip flag is global and not thread safe
+	std::vector<uint8_t> rgb(size_t(width) * height * 3);
+	for (int y = 0; y < height; ++y)
+	{
+		const uint8_t* src = pixels + size_t(height - 1 - y) * width * 4;
+		uint8_t* dst = rgb.data() + size_t(y) * width * 3;
+		for (int x = 0; x < width; ++x, src += 4, dst += 3)
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+
+	int result;
+	if (IsJPEG(path))
+	{
+		result = stbi_write_jpg(path.c_str(), width, height, 3, rgb.data(), quality);
+	}
+	else
+	{
+		result = stbi_write_png(path.c_str(), width, height, 3, rgb.data(), width * 3);
+	}
+	if (result == 0)
+	{
+		throw runtime_error("Could not write %s", path.c_str());
+	}
+}
+
+BatchRenderer::Stats BatchRenderer::Run(const std::vector<Job>& jobs, const Render::Framebuffer& framebuffer,
+		const UploadFunction& upload, const RenderFunction& render)
+{
+	struct Slot
+	{
+		bool decoded = false;
+		DecodedImagePtr image;
+		std::string error;
+	};
+
+	// Shared with the tasks by reference, Run does not return before all of them are done.
+	// Tasks notify while holding the lock, so that the condition is not destroyed under them
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<Slot> slots(jobs.size());
+	size_t tasks = 0;
+	size_t encoding = 0;
+
+	Stats stats;
+	auto start = Clock::now();
+	int width = framebuffer.GetWidth();
+	int height = framebuffer.GetHeight();
+	// Bounds the number of decoded images and of frames waiting for encoding
+	size_t lookahead = size_t(m_pool.GetThreadCount()) * 2;
+	size_t next_decode = 0;
+	// Job index and pack buffer of frames being read back
+	std::deque<std::pair<size_t, int> > readbacks;
+
+	auto schedule = [&](size_t current)
+	{
+		for (; next_decode < jobs.size() && next_decode <= current + lookahead; ++next_decode)
+		{
+			size_t index = next_decode;
+			std::lock_guard<std::mutex> lock(mutex);
+			if (jobs[index].input.empty())
+			{
+				slots[index].decoded = true;
+				continue;
+			}
+			++tasks;
+			m_pool.Enqueue([&, index]()
+			{
+				DecodedImagePtr image;
+				std::string error;
+				try
+				{
+					image = ImageLoader::Decode(jobs[index].input);
+				}
+				catch (const std::exception& e)
+				{
+					error = e.what();
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				slots[index].decoded = true;
+				slots[index].image = std::move(image);
+				slots[index].error = std::move(error);
+				stats.decode += slots[index].image ? slots[index].image->decode_time : 0.0;
+				--tasks;
+				condition.notify_all();
+			});
+		}
+	};
+
+	auto retire = [&]()
+	{
+		size_t index = readbacks.front().first;
+		int buffer = readbacks.front().second;
+		readbacks.pop_front();
+
+		{
+			auto t = Clock::now();
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&]() { return encoding < lookahead; });
+			stats.encode_stall += GetMilliseconds(t);
+		}
+
+		auto t = Clock::now();
+		TRACE_SCOPE("BatchRenderer::Readback", "batch");
+		auto frame = std::make_shared<std::vector<uint8_t> >(size_t(width) * height * 4);
+		const uint8_t* pixels = m_readback.Map(buffer);
+		bool ok = pixels != nullptr;
+		if (ok)
+		{
+			memcpy(frame->data(), pixels, frame->size());
+			ok = m_readback.UnMap(buffer);
+		}
+		stats.readback += GetMilliseconds(t);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!ok)
+		{
+			spdlog::error("Could not read back frame for {}", jobs[index].output);
+			++stats.failed;
+			return;
+		}
+		++encoding;
+		++tasks;
+		m_pool.Enqueue([&, index, frame]()
+		{
+			auto t = Clock::now();
+			std::string error;
+			try
+			{
+				Encode(jobs[index].output, frame->data(), width, height, m_quality);
+			}
+			catch (const std::exception& e)
+			{
+				error = e.what();
+			}
+			double time = GetMilliseconds(t);
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.encode += time;
+			if (error.empty())
+			{
+				++stats.images;
+			}
+			else
+			{
+				spdlog::error("{}", error);
+				++stats.failed;
+			}
+			--encoding;
+			--tasks;
+			condition.notify_all();
+		});
+	};
+
+	try
+	{
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			schedule(i);
+
+			DecodedImagePtr image;
+			std::string error;
+			{
+				auto t = Clock::now();
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&]() { return slots[i].decoded; });
+				stats.decode_stall += GetMilliseconds(t);
+				image = std::move(slots[i].image);
+				error = std::move(slots[i].error);
+			}
+			if (!error.empty())
+			{
+				spdlog::error("{}", error);
+				std::lock_guard<std::mutex> lock(mutex);
+				++stats.failed;
+				continue;
+			}
+
+			auto t = Clock::now();
+			upload(i, image);
+			image.reset();
+			stats.upload += GetMilliseconds(t);
+
+			// CPU time of submission, GPU time ends up in readback, when the buffer is mapped
+			t = Clock::now();
+			render(i);
+			readbacks.emplace_back(i, framebuffer.ReadPixels(m_readback));
+			stats.render += GetMilliseconds(t);
+
+			// Frame is mapped when its buffer is about to be reused, so the GPU has RingSize - 1 frames to finish it
+			if (readbacks.size() == Render::PixelPackBuffer::RingSize)
+			{
+				retire();
+			}
+		}
+		while (!readbacks.empty())
+		{
+			retire();
+		}
+	}
+	catch (...)
+	{
+		// Lookahead is bounded, so the remaining tasks are few
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [&]() { return tasks == 0; });
+		throw;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [&]() { return tasks == 0; });
+	stats.total = GetMilliseconds(start);
+	return stats;
+}
+
+
+#include <doctest.h>
+#include <stb_image.h>
+#include <stdio.h>
+
+TEST_CASE("[BatchRenderer] Encode")
+{
+	// 3x2 RGBA, bottom row first, as read from GL
+	const uint8_t pixels[] = {
+		10, 20, 30, 255,   40, 50, 60, 255,   70, 80, 90, 255,
+		1, 2, 3, 0,        4, 5, 6, 0,        7, 8, 9, 0
+	};
+	std::string path = "batch_renderer_test.png";
+	BatchRenderer::Encode(path, pixels, 3, 2, 90);
+
+	int width = 0, height = 0, channels = 0;
+	uint8_t* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	REQUIRE(data != nullptr);
+	CHECK_EQ(width, 3);
+	CHECK_EQ(height, 2);
+	CHECK_EQ(channels, 3);
+	// Top row of the file is the last row of GL
+	const uint8_t expected[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 30, 40, 50, 60, 70, 80, 90 };
+	CHECK(memcmp(data, expected, sizeof(expected)) == 0);
+	stbi_image_free(data);
+	remove(path.c_str());
+
+	CHECK_THROWS(BatchRenderer::Encode("no_such_directory/test.jpg", pixels, 3, 2, 90));
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "ImageLoader.h"
+#include "PixelPackBuffer.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Render
+{
+	class Framebuffer;
+}
+
+
+// Renders a list of jobs into image files, e.g. an image with its annotations for every item of a dataset.
+// Stages are pipelined, so that none of them waits for another: images are decoded on the workers ahead of time,
+// the GL thread uploads and renders them, and reads frames back through a ring of pixel pack buffers a few frames later,
+// after that the workers flip and encode the frames to PNG or JPEG. The number of decoded images and frames waiting for
+// encoding is bounded, so memory use does not depend on the number of jobs.
+class BatchRenderer
+{
+	BatchRenderer(const BatchRenderer&) = delete; // non construction-copyable
+	BatchRenderer& operator=(const BatchRenderer&) = delete; // non copyable
+public:
+	struct Job
+	{
+		// Path of the image to decode on a worker. If empty, the upload callback gets null and provides the image itself
+		std::string input;
+		// Format is chosen by extension: .jpg or .jpeg for JPEG, PNG otherwise
+		std::string output;
+	};
+
+	// Times are in milliseconds, summed over all jobs. Stalls are the times the GL thread waited for the workers
+	struct Stats
+	{
+		size_t images = 0;
+		size_t failed = 0;
+		double decode = 0.0;
+		double upload = 0.0;
+		double render = 0.0;
+		double readback = 0.0;
+		double encode = 0.0;
+		double decode_stall = 0.0;
+		double encode_stall = 0.0;
+		double total = 0.0;
+
+		double GetImagesPerSecond() const
+		{
+			return total > 0.0 ? images * 1000.0 / total : 0.0;
+		}
+	};
+
+	// Called on the GL thread. Upload gets the decoded image of job `index`, or null if the job has no input path,
+	// render draws the frame into the framebuffer. Exceptions thrown by them stop the batch and are rethrown by Run
+	typedef std::function<void(size_t index, const DecodedImagePtr& image)> UploadFunction;
+	typedef std::function<void(size_t index)> RenderFunction;
+
+	// If `threads` is zero, number of hardware threads is used. `quality` is for JPEG, 1..100
+	explicit BatchRenderer(int threads = 0, int quality = 90);
+
+	// Must be called from the thread that owns GL context. Jobs that fail to decode or encode are logged and counted
+	// in Stats::failed, the rest of the batch goes on
+	Stats Run(const std::vector<Job>& jobs, const Render::Framebuffer& framebuffer, const UploadFunction& upload,
+			const RenderFunction& render);
+
+	// Writes RGBA pixels with rows going from bottom to top, as they are read from GL. Alpha is dropped. Throws on failure
+	static void Encode(const std::string& path, const uint8_t* pixels, int width, int height, int quality);
+
+private:
+	int m_quality;
+	ThreadPool m_pool;
+	Render::PixelPackBuffer m_readback;
+};
@@ -0,0 +1,721 @@
+#include "BlockCompressor.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+	// Pixels of a 4x4 block. Channels are stored separately, so that four pixels are processed at once.
+	struct Block
+	{
+		alignas(16) float c[4][16];
+	};
+
+	void LoadBlock(const uint8_t* source, int width, int height, int channels, ptrdiff_t pixel_stride, ptrdiff_t row_stride,
+			int bx, int by, Block& block)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			int x = std::min(bx * 4 + (i & 3), width - 1);
+			int y = std::min(by * 4 + (i >> 2), height - 1);
+			const uint8_t* p = source + y * row_stride + x * pixel_stride;
+			block.c[0][i] = p[0];
+			block.c[1][i] = channels == 1 ? p[0] : p[1];
+			block.c[2][i] = channels == 1 ? p[0] : (channels == 2 ? 0.0f : p[2]);
+			block.c[3][i] = channels == 4 ? p[3] : 255.0f;
+		}
+	}
+
+	// Sum of a[i] * b[i] over the 16 pixels
+	float Dot16(const float* a, const float* b)
+	{
+#ifdef BLOCK_USE_SSE
+		__m128 acc = _mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a + 4), _mm_load_ps(b + 4)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a + 8), _mm_load_ps(b + 8)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(a + 12), _mm_load_ps(b + 12)));
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+		return _mm_cvtss_f32(acc);
+#else
+		float sum = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			sum += a[i] * b[i];
+		}
+		return sum;
+#endif
+	}
+
+	// Projections of pixels onto `axis` that goes through `origin`, first `n` channels are used
+	void Project(const Block& b, int n, const float* origin, const float* axis, float* out)
+	{
+#ifdef BLOCK_USE_SSE
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 acc = _mm_setzero_ps();
+			for (int c = 0; c < n; ++c)
+			{
+				__m128 d = _mm_sub_ps(_mm_load_ps(b.c[c] + i), _mm_set1_ps(origin[c]));
+				acc = _mm_add_ps(acc, _mm_mul_ps(d, _mm_set1_ps(axis[c])));
+			}
+			_mm_store_ps(out + i, acc);
+		}
+#else
+		for (int i = 0; i < 16; ++i)
+		{
+			out[i] = 0.0f;
+			for (int c = 0; c < n; ++c)
+			{
+				out[i] += (b.c[c][i] - origin[c]) * axis[c];
+			}
+		}
+#endif
+	}
+
+	// Direction of the largest variance of pixel colors, found with power iteration on the covariance matrix
+	void PrincipalAxis(const Block& b, int n, float* mean, float* axis)
+	{
+		alignas(16) float d[4][16];
+		for (int c = 0; c < n; ++c)
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				sum += b.c[c][i];
+			}
+			mean[c] = sum / 16.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				d[c][i] = b.c[c][i] - mean[c];
+			}
+		}
+
+		float cov[4][4];
+		for (int j = 0; j < n; ++j)
+		{
+			for (int k = 0; k <= j; ++k)
+			{
+				cov[j][k] = cov[k][j] = Dot16(d[j], d[k]);
+			}
+		}
+
+		int largest = 0;
+		for (int c = 1; c < n; ++c)
+		{
+			largest = cov[c][c] > cov[largest][largest] ? c : largest;
+		}
+		for (int c = 0; c < n; ++c)
+		{
+			axis[c] = cov[largest][c];
+		}
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float scale = 0.0f;
+			for (int j = 0; j < n; ++j)
+			{
+				for (int k = 0; k < n; ++k)
+				{
+					next[j] += cov[j][k] * axis[k];
+				}
+				scale = std::max(scale, fabsf(next[j]));
+			}
+			if (scale < 1e-6f)
+			{
+				break;
+			}
+			for (int j = 0; j < n; ++j)
+			{
+				axis[j] = next[j] / scale;
+			}
+		}
+	}
+
+	// Endpoints on the principal axis, pulled towards each other by `inset` of their distance
+	void InitialEndpoints(const Block& b, int n, float inset, float* e0, float* e1)
+	{
+		float mean[4];
+		float axis[4];
+		alignas(16) float projection[16];
+		PrincipalAxis(b, n, mean, axis);
+		Project(b, n, mean, axis, projection);
+		int lo = int(std::min_element(projection, projection + 16) - projection);
+		int hi = int(std::max_element(projection, projection + 16) - projection);
+		for (int c = 0; c < n; ++c)
+		{
+			float d = (b.c[c][hi] - b.c[c][lo]) * inset;
+			e0[c] = b.c[c][hi] - d;
+			e1[c] = b.c[c][lo] + d;
+		}
+	}
+
+	// Picks the nearest of `count` palette colors for every pixel, returns the total squared error
+	float FitIndices(const Block& b, int n, const float (*palette)[4], int count, int* indices)
+	{
+		float error = 0.0f;
+#ifdef BLOCK_USE_SSE
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 best = _mm_set1_ps(1e30f);
+			__m128 best_index = _mm_setzero_ps();
+			for (int p = 0; p < count; ++p)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < n; ++c)
+				{
+					__m128 d = _mm_sub_ps(_mm_load_ps(b.c[c] + i), _mm_set1_ps(palette[p][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+				}
+				__m128 closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(distance, best);
+				best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(float(p))), _mm_andnot_ps(closer, best_index));
+			}
+			alignas(16) float e[4];
+			alignas(16) float index[4];
+			_mm_store_ps(e, best);
+			_mm_store_ps(index, best_index);
+			for (int k = 0; k < 4; ++k)
+			{
+				indices[i + k] = int(index[k]);
+				error += e[k];
+			}
+		}
+#else
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = 1e30f;
+			for (int p = 0; p < count; ++p)
+			{
+				float distance = 0.0f;
+				for (int c = 0; c < n; ++c)
+				{
+					float d = b.c[c][i] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = p;
+				}
+			}
+			error += best;
+		}
+#endif
+		return error;
+	}
+
+	// Endpoints that minimize the squared error, given interpolation weight `t` of the second endpoint for each pixel
+	bool LeastSquares(const Block& b, int n, const float* t, float* e0, float* e1)
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float x0[4] = {};
+		float x1[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float s = 1.0f - t[i];
+			aa += s * s;
+			ab += s * t[i];
+			bb += t[i] * t[i];
+			for (int c = 0; c < n; ++c)
+			{
+				x0[c] += s * b.c[c][i];
+				x1[c] += t[i] * b.c[c][i];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f)
+		{
+			return false;
+		}
+		for (int c = 0; c < n; ++c)
+		{
+			e0[c] = std::min(std::max((bb * x0[c] - ab * x1[c]) / det, 0.0f), 255.0f);
+			e1[c] = std::min(std::max((aa * x1[c] - ab * x0[c]) / det, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	void EncodeBC4(const float* v, uint8_t* out)
+	{
+		float lo = v[0];
+		float hi = v[0];
+		for (int i = 1; i < 16; ++i)
+		{
+			lo = std::min(lo, v[i]);
+			hi = std::max(hi, v[i]);
+		}
+		int e0 = int(hi);
+		int e1 = int(lo);
+		out[0] = uint8_t(e0);
+		out[1] = uint8_t(e1);
+
+		// With e0 > e1 there are 8 levels: index 0 is e0, 1 is e1 and 2..7 are evenly spaced from e0 to e1
+		uint64_t bits = 0;
+		if (e0 > e1)
+		{
+			float scale = 7.0f / float(e0 - e1);
+			for (int i = 0; i < 16; ++i)
+			{
+				int step = int((float(e0) - v[i]) * scale + 0.5f);
+				uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+				bits |= index << (3u * i);
+			}
+		}
+		for (int k = 0; k < 6; ++k)
+		{
+			out[2 + k] = uint8_t(bits >> (8u * k));
+		}
+	}
+
+	uint16_t To565(const float* c)
+	{
+		int r = int(std::min(std::max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		int g = int(std::min(std::max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+		int b = int(std::min(std::max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void From565(uint16_t v, float* c)
+	{
+		int r = (v >> 11) & 31;
+		int g = (v >> 5) & 63;
+		int b = v & 31;
+		c[0] = float((r << 3) | (r >> 2));
+		c[1] = float((g << 2) | (g >> 4));
+		c[2] = float((b << 3) | (b >> 2));
+	}
+
+	struct BC1Block
+	{
+		uint16_t c0;
+		uint16_t c1;
+		int indices[16];
+		float error;
+	};
+
+	void SolveBC1(const Block& b, const float* e0, const float* e1, BC1Block& r)
+	{
+		r.c0 = To565(e0);
+		r.c1 = To565(e1);
+		// c0 > c1 selects the four color mode
+		if (r.c0 < r.c1)
+		{
+			std::swap(r.c0, r.c1);
+		}
+		float palette[4][4] = {};
+		From565(r.c0, palette[0]);
+		From565(r.c1, palette[1]);
+		if (r.c0 == r.c1)
+		{
+			r.error = FitIndices(b, 3, palette, 1, r.indices);
+			return;
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		r.error = FitIndices(b, 3, palette, 4, r.indices);
+	}
+
+	void EncodeBC1(const Block& b, uint8_t* out)
+	{
+		float e0[4];
+		float e1[4];
+		InitialEndpoints(b, 3, 1.0f / 16.0f, e0, e1);
+		BC1Block best;
+		SolveBC1(b, e0, e1, best);
+
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		for (int iteration = 0; iteration < 2 && best.error > 0.0f; ++iteration)
+		{
+			float t[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				t[i] = weights[best.indices[i]];
+			}
+			if (!LeastSquares(b, 3, t, e0, e1))
+			{
+				break;
+			}
+			BC1Block refined;
+			SolveBC1(b, e0, e1, refined);
+			if (refined.error >= best.error)
+			{
+				break;
+			}
+			best = refined;
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= uint32_t(best.indices[i]) << (2u * i);
+		}
+		out[0] = uint8_t(best.c0);
+		out[1] = uint8_t(best.c0 >> 8u);
+		out[2] = uint8_t(best.c1);
+		out[3] = uint8_t(best.c1 >> 8u);
+		for (int k = 0; k < 4; ++k)
+		{
+			out[4 + k] = uint8_t(bits >> (8u * k));
+		}
+	}
+
+	const int bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BC7Block
+	{
+		int q[2][4];
+		int p[2];
+		int indices[16];
+		float error;
+	};
+
+	// Mode 6 endpoints are 7 bits per channel plus a p-bit shared by all channels of the endpoint
+	void QuantizeBC7(const float* e, int* q, int& p)
+	{
+		float best = 1e30f;
+		for (int pbit = 0; pbit < 2; ++pbit)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				float v = std::min(std::max(e[c], 0.0f), 255.0f);
+				candidate[c] = std::min(std::max(int(floorf((v - pbit) / 2.0f + 0.5f)), 0), 127);
+				float d = float(candidate[c] * 2 + pbit) - v;
+				error += d * d;
+			}
+			if (error < best)
+			{
+				best = error;
+				p = pbit;
+				memcpy(q, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	// Interpolated colors lie on a line, so the nearest one is found by projecting pixels onto it instead of trying all 16
+	float FitIndicesBC7(const Block& b, const float (*palette)[4], int* indices)
+	{
+		static struct NearestWeight
+		{
+			int index[65];
+
+			NearestWeight()
+			{
+				for (int v = 0; v <= 64; ++v)
+				{
+					index[v] = 0;
+					for (int k = 1; k < 16; ++k)
+					{
+						index[v] = abs(bc7_weights[k] - v) < abs(bc7_weights[index[v]] - v) ? k : index[v];
+					}
+				}
+			}
+		} nearest;
+
+		float axis[4];
+		float length2 = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			axis[c] = palette[15][c] - palette[0][c];
+			length2 += axis[c] * axis[c];
+		}
+		if (length2 < 1e-6f)
+		{
+			return FitIndices(b, 4, palette, 1, indices);
+		}
+		for (int c = 0; c < 4; ++c)
+		{
+			axis[c] *= 64.0f / length2;
+		}
+		alignas(16) float t[16];
+		Project(b, 4, palette[0], axis, t);
+
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = nearest.index[std::min(std::max(int(t[i] + 0.5f), 0), 64)];
+			indices[i] = index;
+			for (int c = 0; c < 4; ++c)
+			{
+				float d = b.c[c][i] - palette[index][c];
+				error += d * d;
+			}
+		}
+		return error;
+	}
+
+	void SolveBC7(const Block& b, const float* e0, const float* e1, BC7Block& r)
+	{
+		QuantizeBC7(e0, r.q[0], r.p[0]);
+		QuantizeBC7(e1, r.q[1], r.p[1]);
+		float palette[16][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			int v0 = r.q[0][c] * 2 + r.p[0];
+			int v1 = r.q[1][c] * 2 + r.p[1];
+			for (int k = 0; k < 16; ++k)
+			{
+				palette[k][c] = float(((64 - bc7_weights[k]) * v0 + bc7_weights[k] * v1 + 32) >> 6);
+			}
+		}
+		r.error = FitIndicesBC7(b, palette, r.indices);
+	}
+
+	struct BitWriter
+	{
+		uint8_t* out;
+		int pos;
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; ++i, ++pos)
+			{
+				out[pos >> 3] |= uint8_t(((value >> i) & 1u) << (pos & 7));
+			}
+		}
+	};
+
+	void EncodeBC7(const Block& b, uint8_t* out)
+	{
+		float e0[4];
+		float e1[4];
+		InitialEndpoints(b, 4, 1.0f / 32.0f, e0, e1);
+		BC7Block best;
+		SolveBC7(b, e0, e1, best);
+
+		for (int iteration = 0; iteration < 2 && best.error > 0.0f; ++iteration)
+		{
+			float t[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				t[i] = bc7_weights[best.indices[i]] / 64.0f;
+			}
+			if (!LeastSquares(b, 4, t, e0, e1))
+			{
+				break;
+			}
+			BC7Block refined;
+			SolveBC7(b, e0, e1, refined);
+			if (refined.error >= best.error)
+			{
+				break;
+			}
+			best = refined;
+		}
+
+		// The most significant bit of the first index is implicitly zero, weights are symmetric, so swapping endpoints flips indices
+		if (best.indices[0] & 8)
+		{
+			std::swap(best.q[0], best.q[1]);
+			std::swap(best.p[0], best.p[1]);
+			for (int i = 0; i < 16; ++i)
+			{
+				best.indices[i] = 15 - best.indices[i];
+			}
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.Write(1u << 6u, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(best.q[0][c], 7);
+			writer.Write(best.q[1][c], 7);
+		}
+		writer.Write(best.p[0], 1);
+		writer.Write(best.p[1], 1);
+		writer.Write(best.indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			writer.Write(best.indices[i], 4);
+		}
+	}
+
+	size_t GetBlockBytes(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+	}
+}
+
+
+size_t GetCompressedSize(BlockFormat format, int width, int height)
+{
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+void CompressBlocks(const uint8_t* source, int width, int height, int channels, ptrdiff_t pixel_stride, ptrdiff_t row_stride,
+		BlockFormat format, uint8_t* destination, ThreadPool* pool)
+{
+	TRACE_SCOPE("CompressBlocks", "loader");
+	if (pool == nullptr)
+	{
+		pool = &ThreadPool::GetDefault();
+	}
+	int blocks_x = (width + 3) / 4;
+	int blocks_y = (height + 3) / 4;
+	size_t block_bytes = GetBlockBytes(format);
+
+	pool->ParallelFor(0, blocks_y, [&](int y0, int y1)
+	{
+		Block block;
+		for (int by = y0; by < y1; ++by)
+		{
+			for (int bx = 0; bx < blocks_x; ++bx)
+			{
+				LoadBlock(source, width, height, channels, pixel_stride, row_stride, bx, by, block);
+				uint8_t* out = destination + (size_t(by) * blocks_x + bx) * block_bytes;
+				switch (format)
+				{
+					case BlockFormat::BC1:
+						EncodeBC1(block, out);
+						break;
+					case BlockFormat::BC4:
+						EncodeBC4(block.c[0], out);
+						break;
+					case BlockFormat::BC5:
+						EncodeBC4(block.c[0], out);
+						EncodeBC4(block.c[1], out + 8);
+						break;
+					case BlockFormat::BC7:
+						EncodeBC7(block, out);
+						break;
+				}
+			}
+		}
+	}, std::max(1, 256 / blocks_x));
+}
+
+
+#include <doctest.h>
+
+namespace
+{
+	void DecodeBC1(const uint8_t* in, uint8_t* rgb)
+	{
+		float palette[4][4] = {};
+		uint16_t c0 = uint16_t(in[0] | (in[1] << 8u));
+		uint16_t c1 = uint16_t(in[2] | (in[3] << 8u));
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = c0 > c1 ? (2.0f * palette[0][c] + palette[1][c]) / 3.0f : (palette[0][c] + palette[1][c]) / 2.0f;
+			palette[3][c] = c0 > c1 ? (palette[0][c] + 2.0f * palette[1][c]) / 3.0f : 0.0f;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = (in[4 + i / 4] >> (2 * (i % 4))) & 3;
+			for (int c = 0; c < 3; ++c)
+			{
+				rgb[i * 3 + c] = uint8_t(palette[index][c] + 0.5f);
+			}
+		}
+	}
+
+	void DecodeBC7Mode6(const uint8_t* in, uint8_t* rgba)
+	{
+		int pos = 0;
+		auto read = [&](int bits)
+		{
+			int value = 0;
+			for (int i = 0; i < bits; ++i, ++pos)
+			{
+				value |= ((in[pos >> 3] >> (pos & 7)) & 1) << i;
+			}
+			return value;
+		};
+		REQUIRE_EQ(read(7), 64);
+		int e[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			e[0][c] = read(7) << 1;
+			e[1][c] = read(7) << 1;
+		}
+		int p0 = read(1);
+		int p1 = read(1);
+		for (int c = 0; c < 4; ++c)
+		{
+			e[0][c] |= p0;
+			e[1][c] |= p1;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int w = bc7_weights[read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				rgba[i * 4 + c] = uint8_t(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+			}
+		}
+	}
+}
+
+TEST_CASE("[BlockCompressor] Round trip")
+{
+	// Blocks of a diagonal gradient, colors of each block lie on a line, so the error comes only from quantization
+	uint8_t image[8 * 8 * 4];
+	for (int i = 0; i < 64; ++i)
+	{
+		int t = 20 + 10 * (i % 8 + i / 8);
+		image[i * 4 + 0] = uint8_t(t);
+		image[i * 4 + 1] = uint8_t(t * 2 / 3);
+		image[i * 4 + 2] = uint8_t(255 - t);
+		image[i * 4 + 3] = uint8_t(255 - t / 4);
+	}
+
+	SUBCASE("BC4")
+	{
+		uint8_t blocks[4 * 8];
+		CompressBlocks(image, 8, 8, 4, 4, 32, BlockFormat::BC4, blocks);
+		// The first block ranges from 20 to 80, so that endpoints are exact
+		CHECK_EQ(blocks[0], 80);
+		CHECK_EQ(blocks[1], 20);
+	}
+
+	SUBCASE("BC1")
+	{
+		uint8_t blocks[4 * 8];
+		uint8_t decoded[16 * 3];
+		CompressBlocks(image, 8, 8, 4, 4, 32, BlockFormat::BC1, blocks);
+		DecodeBC1(blocks + 8, decoded);
+		for (int i = 0; i < 16; ++i)
+		{
+			const uint8_t* src = image + ((i / 4) * 8 + 4 + i % 4) * 4;
+			for (int c = 0; c < 3; ++c)
+			{
+				CHECK_LE(abs(src[c] - decoded[i * 3 + c]), 12);
+			}
+		}
+	}
+
+	SUBCASE("BC7")
+	{
+		uint8_t blocks[4 * 16];
+		uint8_t decoded[16 * 4];
+		CompressBlocks(image, 8, 8, 4, 4, 32, BlockFormat::BC7, blocks);
+		DecodeBC7Mode6(blocks, decoded);
+		for (int i = 0; i < 16; ++i)
+		{
+			const uint8_t* src = image + ((i / 4) * 8 + i % 4) * 4;
+			for (int c = 0; c < 4; ++c)
+			{
+				CHECK_LE(abs(src[c] - decoded[i * 4 + c]), 3);
+			}
+		}
+	}
+}
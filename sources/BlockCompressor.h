@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+class ThreadPool;
+
+enum class BlockFormat
+{
+	BC1,
+	BC4,
+	BC5,
+	BC7
+};
+
+// Size in bytes of `width` x `height` image encoded with 4x4 blocks of `format`
+size_t GetCompressedSize(BlockFormat format, int width, int height);
+
+// Encodes 8-bit image that has `channels` interleaved channels, pixels `pixel_stride` bytes apart and rows `row_stride` bytes apart.
+// BC4 takes the first channel, BC5 the first two. BC1 and BC7 take RGB, or RGBA if there are 4 channels; grayscale is replicated
+// into RGB and missing alpha is opaque. BC1 does not store alpha. Blocks crossing the right or bottom edge repeat the edge pixels.
+// BC7 uses mode 6 only (single subset with RGBA endpoints), which is fast and handles smooth photographic content well.
+// Rows of blocks are spread over `pool`, the default pool is used if it is null.
+void CompressBlocks(const uint8_t* source, int width, int height, int channels, ptrdiff_t pixel_stride, ptrdiff_t row_stride,
+		BlockFormat format, uint8_t* destination, ThreadPool* pool = nullptr);
@@ -0,0 +1,376 @@
+#include "DDSReader.h"
+#include "runtime_error.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace Render;
+
+
+namespace
+{
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8u) | (uint32_t(uint8_t(c)) << 16u) | (uint32_t(uint8_t(d)) << 24u);
+	}
+
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "Wrong DDS header size");
+	static_assert(sizeof(DDSHeaderDX10) == 20, "Wrong DDS DX10 header size");
+
+	enum : uint32_t
+	{
+		DDS_MAGIC = MakeFourCC('D', 'D', 'S', ' '),
+
+		DDSD_DEPTH = 0x800000,
+
+		DDPF_ALPHAPIXELS = 0x1,
+		DDPF_FOURCC = 0x4,
+		DDPF_RGB = 0x40,
+		DDPF_LUMINANCE = 0x20000,
+
+		DDSCAPS2_CUBEMAP = 0x200,
+		DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00,
+		DDSCAPS2_VOLUME = 0x200000,
+
+		DDS_RESOURCE_MISC_TEXTURECUBE = 0x4,
+		DDS_DIMENSION_TEXTURE2D = 3,
+	};
+
+	enum DXGIFormat: uint32_t
+	{
+		DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+		DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+		DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+		DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+		DXGI_FORMAT_R32_FLOAT = 41,
+		DXGI_FORMAT_R8G8_UNORM = 49,
+		DXGI_FORMAT_R16_UNORM = 56,
+		DXGI_FORMAT_R8_UNORM = 61,
+		DXGI_FORMAT_BC1_UNORM = 71,
+		DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+		DXGI_FORMAT_BC2_UNORM = 74,
+		DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+		DXGI_FORMAT_BC3_UNORM = 77,
+		DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+		DXGI_FORMAT_BC4_UNORM = 80,
+		DXGI_FORMAT_BC4_SNORM = 81,
+		DXGI_FORMAT_BC5_UNORM = 83,
+		DXGI_FORMAT_BC5_SNORM = 84,
+		DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+		DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+		DXGI_FORMAT_BC6H_UF16 = 95,
+		DXGI_FORMAT_BC6H_SF16 = 96,
+		DXGI_FORMAT_BC7_UNORM = 98,
+		DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+	};
+
+	const TextureFormat::DataType SignedFloat = TextureFormat::DataType(TextureFormat::Float | TextureFormat::Signed);
+
+	bool MapDXGIFormat(uint32_t dxgi, TextureFormat& f)
+	{
+		switch (dxgi)
+		{
+			case DXGI_FORMAT_BC1_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC1, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC1_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::BC1, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC2_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC2, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC2_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::BC2, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC3_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC3, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC3_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::BC3, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC4_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC4, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC4_SNORM: f = { TextureFormat::lRGB, TextureFormat::BC4, TextureFormat::SignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC5_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC5, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC5_SNORM: f = { TextureFormat::lRGB, TextureFormat::BC5, TextureFormat::SignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC6H_UF16: f = { TextureFormat::lRGB, TextureFormat::BC6, TextureFormat::Float }; return true;
+			case DXGI_FORMAT_BC6H_SF16: f = { TextureFormat::lRGB, TextureFormat::BC6, SignedFloat }; return true;
+			case DXGI_FORMAT_BC7_UNORM: f = { TextureFormat::lRGB, TextureFormat::BC7, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_BC7_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::BC7, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_R8G8B8A8_UNORM: f = { TextureFormat::lRGB, TextureFormat::RGBA8888, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::RGBA8888, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_B8G8R8A8_UNORM: f = { TextureFormat::lRGB, TextureFormat::BGRA8888, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: f = { TextureFormat::sRGB, TextureFormat::BGRA8888, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_R8G8_UNORM: f = { TextureFormat::lRGB, TextureFormat::RG88, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_R8_UNORM: f = { TextureFormat::lRGB, TextureFormat::R8, TextureFormat::UnsignedByteNormalized }; return true;
+			case DXGI_FORMAT_R16_UNORM: f = { TextureFormat::lRGB, TextureFormat::R16, TextureFormat::UnsignedShortNormalized }; return true;
+			case DXGI_FORMAT_R16G16B16A16_UNORM: f = { TextureFormat::lRGB, TextureFormat::RGBA16161616, TextureFormat::UnsignedShortNormalized }; return true;
+			case DXGI_FORMAT_R32_FLOAT: f = { TextureFormat::lRGB, TextureFormat::R32, SignedFloat }; return true;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT: f = { TextureFormat::lRGB, TextureFormat::RGBA32323232, SignedFloat }; return true;
+		}
+		return false;
+	}
+
+	bool MapLegacyFormat(const DDSPixelFormat& pf, TextureFormat& f)
+	{
+		if (pf.flags & DDPF_FOURCC)
+		{
+			switch (pf.fourCC)
+			{
+				case MakeFourCC('D', 'X', 'T', '1'): f = { TextureFormat::sRGB, TextureFormat::DXT1, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('D', 'X', 'T', '2'): f = { TextureFormat::sRGB, TextureFormat::DXT2, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('D', 'X', 'T', '3'): f = { TextureFormat::sRGB, TextureFormat::DXT3, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('D', 'X', 'T', '4'): f = { TextureFormat::sRGB, TextureFormat::DXT4, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('D', 'X', 'T', '5'): f = { TextureFormat::sRGB, TextureFormat::DXT5, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('A', 'T', 'I', '1'):
+				case MakeFourCC('B', 'C', '4', 'U'): f = { TextureFormat::lRGB, TextureFormat::BC4, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('B', 'C', '4', 'S'): f = { TextureFormat::lRGB, TextureFormat::BC4, TextureFormat::SignedByteNormalized }; return true;
+				case MakeFourCC('A', 'T', 'I', '2'):
+				case MakeFourCC('B', 'C', '5', 'U'): f = { TextureFormat::lRGB, TextureFormat::BC5, TextureFormat::UnsignedByteNormalized }; return true;
+				case MakeFourCC('B', 'C', '5', 'S'): f = { TextureFormat::lRGB, TextureFormat::BC5, TextureFormat::SignedByteNormalized }; return true;
+			}
+			return false;
+		}
+
+		if ((pf.flags & DDPF_RGB) && pf.rgbBitCount == 32)
+		{
+			uint32_t a = (pf.flags & DDPF_ALPHAPIXELS) ? pf.aBitMask : 0;
+			if (pf.rBitMask == 0xff && pf.gBitMask == 0xff00 && pf.bBitMask == 0xff0000 && a == 0xff000000)
+			{
+				f = { TextureFormat::sRGB, TextureFormat::RGBA8888, TextureFormat::UnsignedByteNormalized };
+				return true;
+			}
+			if (pf.rBitMask == 0xff0000 && pf.gBitMask == 0xff00 && pf.bBitMask == 0xff && a == 0xff000000)
+			{
+				f = { TextureFormat::sRGB, TextureFormat::BGRA8888, TextureFormat::UnsignedByteNormalized };
+				return true;
+			}
+			return false;
+		}
+
+		if ((pf.flags & DDPF_LUMINANCE) && pf.rgbBitCount == 8)
+		{
+			f = { TextureFormat::lRGB, TextureFormat::R8, TextureFormat::UnsignedByteNormalized };
+			return true;
+		}
+		return false;
+	}
+}
+
+
+DDSReader::DDSReader(Blob file): m_file(std::move(file))
+{
+	if (!CheckMagic(m_file))
+	{
+		throw runtime_error("Not a DDS file");
+	}
+	if (m_file.size < 4 + sizeof(DDSHeader))
+	{
+		throw runtime_error("DDS file is truncated");
+	}
+
+	DDSHeader header;
+	memcpy(&header, m_file.data.get() + 4, sizeof(DDSHeader));
+	size_t offset = 4 + sizeof(DDSHeader);
+
+	if (header.size != sizeof(DDSHeader) || header.ddspf.size != sizeof(DDSPixelFormat))
+	{
+		throw runtime_error("Malformed DDS header");
+	}
+	if ((header.flags & DDSD_DEPTH) || (header.caps2 & DDSCAPS2_VOLUME))
+	{
+		throw runtime_error("Volume DDS textures are not supported");
+	}
+
+	if ((header.ddspf.flags & DDPF_FOURCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (m_file.size < offset + sizeof(DDSHeaderDX10))
+		{
+			throw runtime_error("DDS file is truncated");
+		}
+		DDSHeaderDX10 dx10;
+		memcpy(&dx10, m_file.data.get() + offset, sizeof(DDSHeaderDX10));
+		offset += sizeof(DDSHeaderDX10);
+
+		if (dx10.resourceDimension != DDS_DIMENSION_TEXTURE2D)
+		{
+			throw runtime_error("Only 2D DDS textures are supported, got resource dimension %d", dx10.resourceDimension);
+		}
+		if (dx10.arraySize > 1)
+		{
+			throw runtime_error("DDS texture arrays are not supported");
+		}
+		if (!MapDXGIFormat(dx10.dxgiFormat, m_format))
+		{
+			throw runtime_error("Unsupported DXGI format: %d", dx10.dxgiFormat);
+		}
+		m_faceCount = (dx10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) ? 6 : 1;
+	}
+	else
+	{
+		if (!MapLegacyFormat(header.ddspf, m_format))
+		{
+			throw runtime_error("Unsupported DDS pixel format, flags: 0x%x, fourCC: 0x%x, bit count: %d",
+					header.ddspf.flags, header.ddspf.fourCC, header.ddspf.rgbBitCount);
+		}
+		if (header.caps2 & DDSCAPS2_CUBEMAP)
+		{
+			if ((header.caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES)
+			{
+				throw runtime_error("Partial DDS cubemaps are not supported");
+			}
+			m_faceCount = 6;
+		}
+	}
+
+	m_size = glm::ivec2(header.width, std::max(header.height, 1u));
+	m_mipmapCount = std::max(int(header.mipMapCount), 1);
+	int max_mipmaps = 1;
+	while ((std::max(m_size.x, m_size.y) >> max_mipmaps) > 0)
+	{
+		++max_mipmaps;
+	}
+	if (m_size.x < 1 || m_mipmapCount > max_mipmaps)
+	{
+		throw runtime_error("Wrong DDS texture size %dx%d with %d mipmaps", m_size.x, m_size.y, m_mipmapCount);
+	}
+
+	for (int face = 0; face < m_faceCount; ++face)
+	{
+		for (int mipmap = 0; mipmap < m_mipmapCount; ++mipmap)
+		{
+			m_offsets.push_back(offset);
+			offset += GetLevelSize(mipmap);
+		}
+	}
+	if (offset > m_file.size)
+	{
+		throw runtime_error("DDS file is truncated, expected %d bytes, but got %d", (int)offset, (int)m_file.size);
+	}
+}
+
+bool DDSReader::CheckMagic(const Blob& file)
+{
+	uint32_t magic = 0;
+	if (file.size >= 4)
+	{
+		memcpy(&magic, file.data.get(), 4);
+	}
+	return magic == DDS_MAGIC;
+}
+
+IReader::Blob DDSReader::Read(int mipmap, int face)
+{
+	size_t offset = m_offsets[face * m_mipmapCount + mipmap];
+	return m_file.Slice(offset, GetLevelSize(mipmap));
+}
+
+glm::ivec3 DDSReader::GetSize(int mipmap) const
+{
+	return glm::ivec3(glm::max(m_size >> mipmap, glm::ivec2(1)), 1);
+}
+
+
+#include <doctest.h>
+#include "Texture.h"
+#include <GL/gl3w.h>
+
+namespace
+{
+	IReader::Blob MakeDDS(const DDSHeader& header, const std::vector<uint8_t>& payload)
+	{
+		size_t size = 4 + sizeof(DDSHeader) + payload.size();
+		std::shared_ptr<uint8_t> data(new uint8_t[size], std::default_delete<uint8_t[]>());
+		uint32_t magic = DDS_MAGIC;
+		memcpy(data.get(), &magic, 4);
+		memcpy(data.get() + 4, &header, sizeof(DDSHeader));
+		memcpy(data.get() + 4 + sizeof(DDSHeader), payload.data(), payload.size());
+		return { data, size };
+	}
+
+	DDSHeader MakeHeader(int width, int height, int mipmaps, uint32_t fourCC)
+	{
+		DDSHeader header = {};
+		header.size = sizeof(DDSHeader);
+		header.width = width;
+		header.height = height;
+		header.mipMapCount = mipmaps;
+		header.ddspf.size = sizeof(DDSPixelFormat);
+		header.ddspf.flags = DDPF_FOURCC;
+		header.ddspf.fourCC = fourCC;
+		return header;
+	}
+
+	// Top row is blue, the rest is red: color0 = red, color1 = blue, index 1 for the first row
+	const uint8_t bc1_block[] = { 0x00, 0xF8, 0x1F, 0x00, 0x55, 0x00, 0x00, 0x00 };
+}
+
+TEST_CASE("[Render] DDSReader")
+{
+	SUBCASE("Layout")
+	{
+		std::vector<uint8_t> payload;
+		for (int i = 0; i < 4 + 1 + 1; ++i)
+		{
+			payload.insert(payload.end(), bc1_block, bc1_block + 8);
+		}
+		DDSReader reader(MakeDDS(MakeHeader(8, 8, 3, MakeFourCC('D', 'X', 'T', '1')), payload));
+
+		CHECK_EQ(reader.GetFormat().pixel_format, TextureFormat::BC1);
+		CHECK_EQ(reader.GetMipmapCount(), 3);
+		CHECK_EQ(reader.GetFaceCount(), 1);
+		CHECK_EQ(reader.GetSize(2), glm::ivec3(2, 2, 1));
+		CHECK_EQ(reader.GetLevelSize(0), 32);
+		CHECK_EQ(reader.GetLevelSize(1), 8);
+		CHECK_EQ(reader.GetLevelSize(2), 8);
+		REQUIRE_THROWS(DDSReader(MakeDDS(MakeHeader(8, 8, 5, MakeFourCC('D', 'X', 'T', '1')), payload)));
+		REQUIRE_THROWS(DDSReader(MakeDDS(MakeHeader(8, 8, 1, MakeFourCC('A', 'B', 'C', 'D')), payload)));
+	}
+
+	SUBCASE("Readback")
+	{
+		std::vector<uint8_t> payload(bc1_block, bc1_block + 8);
+		auto header = MakeHeader(4, 4, 1, MakeFourCC('D', 'X', '1', '0'));
+		DDSHeaderDX10 dx10 = { DXGI_FORMAT_BC1_UNORM, DDS_DIMENSION_TEXTURE2D, 0, 1, 0 };
+		payload.insert(payload.begin(), (uint8_t*)&dx10, (uint8_t*)&dx10 + sizeof(dx10));
+
+		auto texture = Texture::LoadTexture(TextureReader(std::make_shared<DDSReader>(MakeDDS(header, payload))));
+		CHECK(texture->IsCompressed());
+
+		uint8_t pixels[4 * 4 * 4];
+		texture->Bind(0);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		texture->UnBind();
+
+		CHECK_EQ(pixels[0], 0);
+		CHECK_EQ(pixels[2], 255);
+		CHECK_EQ(pixels[4 * 4 * 3 + 0], 255);
+		CHECK_EQ(pixels[4 * 4 * 3 + 2], 0);
+		CHECK_EQ(pixels[4 * 4 * 3 + 3], 255);
+	}
+}
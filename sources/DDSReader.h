@@ -0,0 +1,47 @@
+#pragma once
+#include "IReader.h"
+#include <vector>
+
+
+namespace Render
+{
+	// Reads DirectDraw Surface files: BC1 - BC7, including files with DX10 header, and uncompressed 8-bit formats.
+	// Blobs returned by `Read` point into the file data, so mipmaps are not copied.
+	// Legacy headers do not specify colour space, color formats are assumed to be sRGB, same as uint8 images.
+	class DDSReader: public IReader
+	{
+	public:
+		// `file` is the whole content of the file. Throws if the file is malformed or the format is not supported.
+		explicit DDSReader(Blob file);
+
+		static bool CheckMagic(const Blob& file);
+
+		Blob Read(int mipmap, int face) override;
+
+		glm::ivec3 GetSize(int mipmap) const override;
+
+		int GetFaceCount() const override
+		{
+			return m_faceCount;
+		}
+
+		int GetMipmapCount() const override
+		{
+			return m_mipmapCount;
+		}
+
+		TextureFormat GetFormat() const override
+		{
+			return m_format;
+		}
+
+	private:
+		Blob m_file;
+		TextureFormat m_format;
+		glm::ivec2 m_size;
+		int m_faceCount = 1;
+		int m_mipmapCount = 1;
+		// Offset of each mipmap of each face, faces are stored one after another with all of their mipmaps
+		std::vector<size_t> m_offsets;
+	};
+}
@@ -0,0 +1,271 @@
+#include "FrameTimer.h"
+#include "GLDebugMessage.h"
+#include "Tracer.h"
+#include <GL/gl3w.h>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <string.h>
+
+using namespace Render;
+
+
+FrameTimer::FrameTimer()
+{
+	memset(m_queries, 0, sizeof(m_queries));
+	memset(m_issued, 0, sizeof(m_issued));
+	memset(m_queryFrame, 0, sizeof(m_queryFrame));
+	memset(m_stageStart, 0, sizeof(m_stageStart));
+	for (int i = 0; i < StageCount; ++i)
+	{
+		m_traceStart[i] = -1;
+	}
+	memset(&m_current, 0, sizeof(m_current));
+	m_history.reserve(HistorySize);
+}
+
+FrameTimer::~FrameTimer()
+{
+	if (HasGpuTiming())
+	{
+		glDeleteQueries(QueryLatency * StageCount, &m_queries[0][0]);
+	}
+}
+
+bool FrameTimer::Init()
+{
+	bool supported = gl3wIsSupported(3, 3) || CheckExtension("GL_ARB_timer_query");
+	if (!supported || glGetQueryObjectui64v == nullptr)
+	{
+		spdlog::warn("Timer queries are not supported, GPU time of frames is not measured");
+		return false;
+	}
+	if (!HasGpuTiming())
+	{
+		glGenQueries(QueryLatency * StageCount, &m_queries[0][0]);
+	}
+	return true;
+}
+
+const char* FrameTimer::GetStageName(int stage)
+{
+	static const char* names[StageCount] = { "new_frame", "update", "tessellation", "images", "nanovg", "text", "swap" };
+	return stage >= 0 && stage < StageCount ? names[stage] : "";
+}
+
+bool FrameTimer::IsGpuStage(int stage)
+{
+	// Python code may make another context current, and swap is not GPU work of the frame
+	return stage == NewFrame || stage == Images || stage == Nanovg || stage == Text;
+}
+
+double FrameTimer::Now()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameTimer::BeginFrame()
+{
+	if (m_activeStage >= 0)
+	{
+		// Previous frame was not finished
+		End(Stage(m_activeStage));
+	}
+	m_inFrame = true;
+	m_traceFrameStart = Tracer::IsEnabled() ? Tracer::Now() : -1;
+	m_previousFrameStart = m_frameStart;
+	m_frameStart = Now();
+	for (int i = 0; i < StageCount; ++i)
+	{
+		m_current.cpu[i] = 0.0;
+		m_current.gpu[i] = -1.0;
+	}
+	m_current.total = 0.0;
+	m_current.interval = m_previousFrameStart >= 0.0 ? m_frameStart - m_previousFrameStart : 0.0;
+
+	if (HasGpuTiming())
+	{
+		int slot = int(m_frameCount % QueryLatency);
+		Collect(slot);
+		m_queryFrame[slot] = m_frameCount;
+	}
+}
+
+void FrameTimer::Begin(Stage stage)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	m_stageStart[stage] = Now();
+	m_traceStart[stage] = Tracer::IsEnabled() ? Tracer::Now() : -1;
+	m_openStage = stage;
+	if (HasGpuTiming() && IsGpuStage(stage) && m_activeStage < 0)
+	{
+		int slot = int(m_frameCount % QueryLatency);
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[slot][stage]);
+		m_issued[slot][stage] = true;
+		m_activeStage = stage;
+	}
+}
+
+void FrameTimer::End(Stage stage)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	m_current.cpu[stage] += Now() - m_stageStart[stage];
+	if (m_openStage == stage)
+	{
+		m_openStage = -1;
+	}
+	if (m_traceStart[stage] >= 0)
+	{
+		Tracer::Record(GetStageName(stage), "frame", m_traceStart[stage], Tracer::Now());
+		m_traceStart[stage] = -1;
+	}
+	if (m_activeStage == stage)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_activeStage = -1;
+	}
+}
+
+void FrameTimer::EndFrame()
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	m_inFrame = false;
+	m_openStage = -1;
+	m_current.total = Now() - m_frameStart;
+	if (m_traceFrameStart >= 0)
+	{
+		Tracer::Record("frame", "frame", m_traceFrameStart, Tracer::Now());
+	}
+	if (m_history.size() < HistorySize)
+	{
+		m_history.push_back(m_current);
+	}
+	else
+	{
+		m_history[m_frameCount % HistorySize] = m_current;
+	}
+	++m_frameCount;
+}
+
+void FrameTimer::BeginInner(Stage stage)
+{
+	if (m_inFrame)
+	{
+		m_stageStart[stage] = Now();
+	}
+}
+
+void FrameTimer::EndInner(Stage stage)
+{
+	if (!m_inFrame)
+	{
+		return;
+	}
+	double elapsed = Now() - m_stageStart[stage];
+	m_current.cpu[stage] += elapsed;
+	if (m_openStage >= 0)
+	{
+		m_current.cpu[m_openStage] -= elapsed;
+	}
+}
+
+void FrameTimer::Collect(int slot)
+{
+	uint64_t frame = m_queryFrame[slot];
+	// Entry of the frame is still in the history, unless the frame was never finished
+	bool valid = frame < m_frameCount && m_frameCount - frame <= HistorySize;
+	for (int i = 0; i < StageCount; ++i)
+	{
+		if (!m_issued[slot][i])
+		{
+			continue;
+		}
+		m_issued[slot][i] = false;
+		// Does not wait for the GPU, a result that is not ready after QueryLatency frames is dropped
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[slot][i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available && valid)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(m_queries[slot][i], GL_QUERY_RESULT, &elapsed);
+			m_history[frame % HistorySize].gpu[i] = double(elapsed) / 1.0e6;
+		}
+	}
+}
+
+std::vector<FrameTimer::Frame> FrameTimer::GetHistory() const
+{
+	if (m_history.size() < HistorySize)
+	{
+		return m_history;
+	}
+	std::vector<Frame> result;
+	result.reserve(HistorySize);
+	size_t first = m_frameCount % HistorySize;
+	result.insert(result.end(), m_history.begin() + first, m_history.end());
+	result.insert(result.end(), m_history.begin(), m_history.begin() + first);
+	return result;
+}
+
+
+#include <doctest.h>
+#include <string>
+#include <thread>
+
+TEST_CASE("[FrameTimer] CPU history")
+{
+	// Without Init, no GL calls are made and only CPU times are measured
+	FrameTimer timer;
+	CHECK(!timer.HasGpuTiming());
+	CHECK(timer.GetHistory().empty());
+
+	// Stages outside of a frame are ignored
+	timer.Begin(FrameTimer::Images);
+	timer.End(FrameTimer::Images);
+	timer.EndFrame();
+	CHECK(timer.GetHistory().empty());
+
+	for (int i = 0; i < FrameTimer::HistorySize + 10; ++i)
+	{
+		timer.BeginFrame();
+		timer.Begin(FrameTimer::Images);
+		timer.End(FrameTimer::Images);
+		timer.EndFrame();
+	}
+	auto history = timer.GetHistory();
+	CHECK_EQ(history.size(), (size_t)FrameTimer::HistorySize);
+	for (auto& frame: history)
+	{
+		CHECK(frame.cpu[FrameTimer::Images] >= 0.0);
+		CHECK(frame.cpu[FrameTimer::Images] <= frame.total);
+		CHECK_EQ(frame.cpu[FrameTimer::Swap], 0.0);
+		CHECK(frame.gpu[FrameTimer::Images] < 0.0);
+	}
+	CHECK_EQ(std::string(FrameTimer::GetStageName(FrameTimer::Nanovg)), "nanovg");
+
+	// Inner stage is moved out of the enclosing one
+	timer.BeginFrame();
+	timer.Begin(FrameTimer::Update);
+	for (int i = 0; i < 3; ++i)
+	{
+		timer.BeginInner(FrameTimer::Tessellation);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		timer.EndInner(FrameTimer::Tessellation);
+	}
+	timer.End(FrameTimer::Update);
+	timer.EndFrame();
+	history = timer.GetHistory();
+	const auto& frame = history.back();
+	CHECK(frame.cpu[FrameTimer::Tessellation] >= 6.0);
+	CHECK(frame.cpu[FrameTimer::Update] >= 0.0);
+	CHECK(frame.cpu[FrameTimer::Update] < 1.0);
+	CHECK(frame.gpu[FrameTimer::Tessellation] < 0.0);
+}
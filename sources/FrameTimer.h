@@ -0,0 +1,112 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+
+namespace Render
+{
+	// Measures CPU and GPU time of the stages of a frame and keeps a rolling history of the last frames.
+	// CPU time is measured with steady clock, GPU time with GL_TIME_ELAPSED queries around the stages that submit GL work.
+	// Query results are collected a few frames later, without waiting for the GPU, so GPU times of the last frames are
+	// not known yet. Queries can not be nested, so stages should not overlap.
+	// GPU timing needs GL 3.3 or GL_ARB_timer_query, otherwise only CPU times are measured.
+	// Stages and frames are also recorded as Tracer events, when tracing is enabled.
+	class FrameTimer
+	{
+		FrameTimer(const FrameTimer&) = delete; // non construction-copyable
+		FrameTimer& operator=(const FrameTimer&) = delete; // non copyable
+	public:
+		enum Stage
+		{
+			// Start of the frame: input polling, camera, pending uploads, clear
+			NewFrame,
+			// Python code between NewFrame and Render: on_update, without tessellation of the nanovg paths it draws
+			Update,
+			// Tessellation of nanovg paths of points, boxes, image shadows and cursor points. It happens in short pieces
+			// during Update and Images, it is timed as an inner stage and subtracted from them. CPU only
+			Tessellation,
+			// Images, annotation layers and SDF shapes
+			Images,
+			// Flush of all nanovg paths (nvgEndFrame) and the frame stats overlay
+			Nanovg,
+			// SimpleText::Render
+			Text,
+			// glfwSwapBuffers, which may block on vsync or when the GPU is behind
+			Swap,
+			StageCount
+		};
+
+		enum
+		{
+			HistorySize = 240,
+			// Number of frames in flight before query results are read
+			QueryLatency = 4
+		};
+
+		// Times in milliseconds. GPU time is negative if it is not measured for the stage or not known yet.
+		// `interval` is the time from the start of the previous frame, it includes time the application was idle
+		struct Frame
+		{
+			double cpu[StageCount];
+			double gpu[StageCount];
+			double total;
+			double interval;
+		};
+
+		FrameTimer();
+		~FrameTimer();
+
+		// Creates queries. Needs current GL context, returns false if timer queries are not supported
+		bool Init();
+
+		static const char* GetStageName(int stage);
+
+		// True for stages that are timed on the GPU too
+		static bool IsGpuStage(int stage);
+
+		void BeginFrame();
+		void Begin(Stage stage);
+		void End(Stage stage);
+		void EndFrame();
+
+		// Times a stage that runs inside the stage that is currently open, its CPU time is moved from the open stage to
+		// `stage`. Inner stages accumulate over the frame, they are not recorded as Tracer events and have no GPU time
+		void BeginInner(Stage stage);
+		void EndInner(Stage stage);
+
+		// Frames from the oldest to the newest
+		std::vector<Frame> GetHistory() const;
+
+		bool HasGpuTiming() const
+		{
+			return m_queries[0][0] != 0;
+		}
+
+	private:
+		static double Now();
+
+		void Collect(int slot);
+
+		std::vector<Frame> m_history;
+		// Number of frames that were finished, the next one goes to m_history[m_frameCount % HistorySize]
+		uint64_t m_frameCount = 0;
+		bool m_inFrame = false;
+		// Stage between Begin and End, inner stages are subtracted from it
+		int m_openStage = -1;
+		// Stage with a query in progress, it is ended if the frame is abandoned, e.g. by an exception
+		int m_activeStage = -1;
+		double m_frameStart = -1.0;
+		double m_previousFrameStart = -1.0;
+		double m_stageStart[StageCount];
+		// Start of the stages and of the frame in Tracer time, or -1 if tracing was disabled when they began
+		int64_t m_traceStart[StageCount];
+		int64_t m_traceFrameStart = -1;
+		Frame m_current;
+
+		// Queries of the frames in flight, in slot m_frameCount % QueryLatency. The frame that issued them is kept,
+		// so that results go to the right history entry, or are dropped if it was overwritten
+		uint32_t m_queries[QueryLatency][StageCount];
+		bool m_issued[QueryLatency][StageCount];
+		uint64_t m_queryFrame[QueryLatency];
+	};
+}
@@ -0,0 +1,88 @@
+#include "Framebuffer.h"
+#include "PixelPackBuffer.h"
+#include "runtime_error.h"
+#include <GL/gl3w.h>
+#include <algorithm>
+#include <string.h>
+
+using namespace Render;
+
+
+Framebuffer::~Framebuffer()
+{
+	if (m_fbo != 0)
+	{
+		glDeleteFramebuffers(1, &m_fbo);
+		glDeleteTextures(1, &m_color);
+		glDeleteRenderbuffers(1, &m_depthStencil);
+	}
+}
+
+void Framebuffer::Resize(int width, int height)
+{
+	if (m_fbo != 0 && width == m_width && height == m_height)
+	{
+		return;
+	}
+	if (m_fbo == 0)
+	{
+		glGenFramebuffers(1, &m_fbo);
+		glGenTextures(1, &m_color);
+		glGenRenderbuffers(1, &m_depthStencil);
+	}
+	m_width = width;
+	m_height = height;
+
+	glBindTexture(GL_TEXTURE_2D, m_color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		throw runtime_error("Framebuffer %dx%d is not complete, status 0x%x", width, height, status);
+	}
+}
+
+void Framebuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+}
+
+void Framebuffer::UnBind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(uint8_t* destination) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, destination);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// GL has the origin at the bottom
+	size_t row = size_t(m_width) * 4;
+	for (int y = 0; y < m_height / 2; ++y)
+	{
+		std::swap_ranges(destination + y * row, destination + (y + 1) * row, destination + (m_height - 1 - y) * row);
+	}
+}
+
+int Framebuffer::ReadPixels(PixelPackBuffer& buffer) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+	int index = buffer.Read(m_width, m_height);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	return index;
+}
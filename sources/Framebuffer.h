@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Render
+{
+	class PixelPackBuffer;
+
+	// Framebuffer object with an sRGB color texture, so that GL_FRAMEBUFFER_SRGB works as with the window,
+	// and a depth-stencil renderbuffer, which nanovg needs for fills.
+	class Framebuffer
+	{
+		Framebuffer(const Framebuffer&) = delete; // non construction-copyable
+		Framebuffer& operator=(const Framebuffer&) = delete; // non copyable
+	public:
+		Framebuffer() = default;
+		~Framebuffer();
+
+		// Creates or reallocates attachments. Throws if the framebuffer is not complete
+		void Resize(int width, int height);
+
+		void Bind() const;
+
+		static void UnBind();
+
+		int GetWidth() const
+		{
+			return m_width;
+		}
+
+		int GetHeight() const
+		{
+			return m_height;
+		}
+
+		uint32_t GetColorTexture() const
+		{
+			return m_color;
+		}
+
+		size_t GetSize() const
+		{
+			return size_t(m_width) * m_height * 4;
+		}
+
+		// Reads RGBA pixels, rows go from top to bottom. `destination` should have GetSize bytes
+		void ReadPixels(uint8_t* destination) const;
+
+		// Starts asynchronous read into the next buffer of the ring, returns its index, see PixelPackBuffer::Read
+		int ReadPixels(PixelPackBuffer& buffer) const;
+
+	private:
+		uint32_t m_fbo = 0;
+		uint32_t m_color = 0;
+		uint32_t m_depthStencil = 0;
+		int m_width = 0;
+		int m_height = 0;
+	};
+}
@@ -2,6 +2,7 @@
 #include "TextureFormat.h"
 #include <glm/glm.hpp>
 #include <memory>
+#include <assert.h>
 
 
 namespace Render
@@ -16,10 +17,27 @@ namespace Render
 		{
 			std::shared_ptr<uint8_t> data;
 			size_t size;
+			// Data points into a read-only file mapping, see MapFile
+			bool mapped = false;
+
+			// Blob for `size` bytes at `offset`, which shares ownership of the memory with this one
+			Blob Slice(size_t offset, size_t size) const
+			{
+				assert(offset + size <= this->size);
+				return { std::shared_ptr<uint8_t>(data, data.get() + offset), size, mapped };
+			}
 		};
 
+		// Returns one face of the mipmap. Readers return views into the file data whenever possible,
+		// so for mapped files nothing is read until the returned memory is accessed.
 		virtual Blob Read(int mipmap, int face) = 0;
 
+		// Returns `size` bytes at `offset` within one face of the mipmap, e.g. to upload a large level in stripes
+		virtual Blob ReadRange(int mipmap, int face, size_t offset, size_t size)
+		{
+			return Read(mipmap, face).Slice(offset, size);
+		}
+
 		virtual glm::ivec3 GetSize(int mipmap) const = 0;
 
 		virtual glm::ivec2 GetSize2D(int mipmap) const
@@ -48,6 +66,14 @@ namespace Render
 			return TextureFormat::GetMinBlockSize(GetFormat().pixel_format);
 		}
 
+		// Size in bytes of one face of the mipmap, with rows tightly packed
+		virtual size_t GetLevelSize(int mipmap) const
+		{
+			glm::ivec2 block = GetBlockSize2D();
+			glm::ivec2 blocks = (GetSize2D(mipmap) + block - 1) / block;
+			return size_t(blocks.x) * blocks.y * block.x * block.y * GetBitsPerPixel() / 8;
+		}
+
 		virtual ~IReader() = default;
 	};
 
@@ -61,6 +87,8 @@ namespace Render
 
 		IReader::Blob Read(int mipmap, int face) final { return m_reader->Read(mipmap, face); }
 
+		IReader::Blob ReadRange(int mipmap, int face, size_t offset, size_t size) final { return m_reader->ReadRange(mipmap, face, offset, size); }
+
 		glm::ivec3 GetSize(int mipmap) const final  { return m_reader->GetSize(mipmap); }
 
 		int GetFaceCount() const final   { return m_reader->GetFaceCount(); }
@@ -73,6 +101,8 @@ namespace Render
 
 		glm::ivec3 GetBlockSize() const final  { return m_reader->GetBlockSize(); }
 
+		size_t GetLevelSize(int mipmap) const final  { return m_reader->GetLevelSize(mipmap); }
+
 	private:
 		IReaderPtr m_reader;
 	};
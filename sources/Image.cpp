@@ -0,0 +1,682 @@
+#include "Image.h"
+#include "PixelUnpackBuffer.h"
+#include "MipmapGenerator.h"
+#include "BlockCompressor.h"
+#include "GLCompressionTypes.h"
+#include "GLDebugMessage.h"
+#include "Tracer.h"
+#include "runtime_error.h"
+#include <GL/gl3w.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string.h>
+
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+namespace
+{
+	// Pixel transfer format for the number of components in memory
+	const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+	// Memory layout of a mipmap level as seen by glTexImage2D
+	struct Level
+	{
+		const uint8_t* data;
+		int width;
+		int height;
+		// Components per pixel in memory, can be more than the number of channels for channel views
+		int components;
+		GLint row_length;
+		GLint alignment;
+		ptrdiff_t row_stride;
+		// Bytes from the first to the last byte read by GL
+		size_t size;
+	};
+
+	// Picks block format for 8-bit data with `channels` channels. Returns GL internal format, or zero if the driver has none.
+	GLenum ChooseCompressedFormat(int channels, BlockFormat& format)
+	{
+		// RGTC is core since OpenGL 3.0
+		switch (channels)
+		{
+			case 1:
+				format = BlockFormat::BC4;
+				return COMPRESSED_RED_RGTC1;
+			case 2:
+				format = BlockFormat::BC5;
+				return COMPRESSED_RG_RGTC2;
+		}
+		// Color data is sRGB, same as for uncompressed uint8 images
+		if (Render::has_bptc())
+		{
+			format = BlockFormat::BC7;
+			return COMPRESSED_SRGB_ALPHA_BPTC_UNORM_EXT;
+		}
+		if (channels == 3 && Render::has_s3tc())
+		{
+			format = BlockFormat::BC1;
+			bool srgb = Render::has_s3tc_srgb() || Render::CheckExtension("GL_EXT_texture_sRGB");
+			return srgb ? COMPRESSED_SRGB_S3TC_DXT1_EXT : COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+		return 0;
+	}
+
+	// Returns the array that owns the memory `a` is a view of
+	py::array GetRootArray(py::array a)
+	{
+		while (py::isinstance<py::array>(a.base()))
+		{
+			a = py::reinterpret_borrow<py::array>(a.base());
+		}
+		return a;
+	}
+
+	// Tries to express layout of `a` with GL_UNPACK_ROW_LENGTH and GL_UNPACK_ALIGNMENT. Returns false if that is not possible,
+	// e.g. for transposed arrays, negative strides or channel views that do not start at the first channel of a pixel.
+	bool GetUnpackLayout(const py::array& a, int channels, Level& level)
+	{
+		ssize_t item_size = a.itemsize();
+		ssize_t width = a.shape(1);
+		ssize_t height = a.shape(0);
+		ssize_t pixel_size = a.strides(1);
+		ssize_t row_stride = a.strides(0);
+
+		if (a.ndim() == 3 && a.shape(2) > 1 && a.strides(2) != item_size)
+		{
+			return false;
+		}
+		if (width > 1 && (pixel_size <= 0 || pixel_size % item_size != 0))
+		{
+			return false;
+		}
+		ssize_t components = width > 1 ? pixel_size / item_size : channels;
+		if (components < channels || components > 4)
+		{
+			return false;
+		}
+		pixel_size = components * item_size;
+
+		ssize_t row_length = width;
+		ssize_t alignment = 1;
+		if (height > 1)
+		{
+			if (row_stride <= 0)
+			{
+				return false;
+			}
+			if (row_stride % pixel_size == 0)
+			{
+				row_length = row_stride / pixel_size;
+			}
+			else
+			{
+				// Row stride is `alignment * ceil(row_length * pixel_size / alignment)`.
+				// Alignment has no effect if it does not exceed the component size.
+				alignment = 0;
+				for (ssize_t candidate: { 8, 4, 2 })
+				{
+					ssize_t length = row_stride / pixel_size;
+					if (candidate > item_size && row_stride % candidate == 0 && length * pixel_size + candidate > row_stride)
+					{
+						alignment = candidate;
+						row_length = length;
+						break;
+					}
+				}
+				if (alignment == 0)
+				{
+					return false;
+				}
+			}
+			if (row_length < width)
+			{
+				return false;
+			}
+		}
+
+		level.data = (const uint8_t*)a.data();
+		level.width = (int)width;
+		level.height = (int)height;
+		level.components = (int)components;
+		level.row_length = (GLint)row_length;
+		level.alignment = (GLint)alignment;
+		level.row_stride = height > 1 ? row_stride : width * pixel_size;
+		level.size = size_t((height - 1) * row_stride + width * pixel_size);
+
+		if (components > channels)
+		{
+			// Trailing components of the last pixel are outside of the view, they still have to be within the same allocation
+			py::array root = GetRootArray(a);
+			auto begin = (const uint8_t*)root.data();
+			auto end = begin + root.nbytes();
+			if (!root.owndata() || level.data < begin || level.data + level.size > end)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+
+Image::Image(): m_shareGroup(ShareGroup::GetCurrent())
+{
+	glGenTextures(1, &m_textureHandle);
+	m_width = -1;
+	m_height = -1;
+	if (m_shareGroup)
+	{
+		m_shareGroup->Register(this);
+	}
+}
+
+Image::Image(std::vector<py::array> ims, bool async_upload, bool generate_mipmaps, bool compress): Image()
+{
+	SetImage(ims, async_upload, generate_mipmaps, compress);
+}
+
+Image::~Image()
+{
+	if (m_shareGroup)
+	{
+		m_shareGroup->Unregister(this);
+	}
+	if (m_fence != nullptr)
+	{
+		glDeleteSync((GLsync)m_fence);
+	}
+	if (m_pendingHandle != 0)
+	{
+		glDeleteTextures(1, &m_pendingHandle);
+	}
+	glDeleteTextures(1, &m_textureHandle);
+}
+
+void Image::GrayScaleToAlpha()
+{
+	GLint swizzleMask[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+	glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+	if (m_pendingHandle != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_pendingHandle);
+		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Image::SetImage(std::vector<py::array> ims, bool async_upload, bool generate_mipmaps, bool compress)
+{
+	TRACE_SCOPE("Image::SetImage", "upload");
+	// Render::debug_guard<> m_guard;
+	auto start = std::chrono::steady_clock::now();
+
+	static GLint swizzleMask_R[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+	static GLint swizzleMask_RG[] = { GL_RED, GL_GREEN, GL_ZERO, GL_ONE };
+	static GLint swizzleMask_RGB[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ONE };
+	static GLint swizzleMask_RGBA[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+	static GLint* swizzleMasks[] = { swizzleMask_R, swizzleMask_RG, swizzleMask_RGB, swizzleMask_RGBA };
+	// RGB is stored with alpha, because three-component formats are not required to be renderable, and UpdateMipmaps
+	// renders into the texture. Drivers usually pad them to four components anyway. Alpha is ignored by the swizzle
+	static GLint internal_formats_u8[] = { GL_R8, GL_RG8, GL_SRGB8_ALPHA8, GL_SRGB8_ALPHA8 };
+	static GLint internal_formats_u16[] = { GL_R16, GL_RG16, GL_RGBA16, GL_RGBA16 };
+	// Half floats are enough for display and take half of the memory
+	static GLint internal_formats_f16[] = { GL_R16F, GL_RG16F, GL_RGBA16F, GL_RGBA16F };
+
+	if (ims.empty())
+	{
+		throw runtime_error("At least one mipmap level is expected");
+	}
+
+	int ndim = (int)ims[0].ndim();
+	int channels = 1;
+	if (ndim == 3)
+	{
+		channels = (int)ims[0].shape(2);
+	}
+	else if (ndim != 2)
+	{
+		throw runtime_error("Wrong number of dimensions. Should be either 2 or 3, but got %d", ndim);
+	}
+	if (channels < 1 || channels > 4)
+	{
+		throw runtime_error("Wrong number of channels. Should be either 1, 2, 3, or 4, but got %d", channels);
+	}
+
+	GLenum type;
+	GLint* internal_formats;
+	py::dtype dtype = ims[0].dtype();
+	if (py::isinstance<py::array_t<uint8_t> >(ims[0]))
+	{
+		type = GL_UNSIGNED_BYTE;
+		internal_formats = internal_formats_u8;
+	}
+	else if (py::isinstance<py::array_t<uint16_t> >(ims[0]))
+	{
+		type = GL_UNSIGNED_SHORT;
+		internal_formats = internal_formats_u16;
+	}
+	else if (py::isinstance<py::array_t<float> >(ims[0]) || py::isinstance<py::array_t<double> >(ims[0]))
+	{
+		type = GL_FLOAT;
+		internal_formats = internal_formats_f16;
+		dtype = py::dtype::of<float>();
+	}
+	else
+	{
+		throw runtime_error("Unsupported dtype %s. Should be either uint8, uint16, or float32",
+				std::string(py::str(ims[0].dtype())).c_str());
+	}
+
+	// Arrays that are actually uploaded, either given ones or their compact copies
+	std::vector<py::array> arrays;
+	std::vector<Level> levels;
+	for (auto& im: ims)
+	{
+		if (im.ndim() != ndim || (ndim == 3 && im.shape(2) != channels))
+		{
+			throw runtime_error("All mipmap levels should have the same number of channels");
+		}
+		Level level;
+		py::array array = im;
+		if (!array.dtype().is(dtype) || !GetUnpackLayout(array, channels, level))
+		{
+			spdlog::debug("Array layout can not be passed to GL as is, making a compact copy");
+			array = py::module::import("numpy").attr("ascontiguousarray")(im, dtype).cast<py::array>();
+			if (!GetUnpackLayout(array, channels, level))
+			{
+				throw runtime_error("Unexpected layout of a contiguous array");
+			}
+		}
+		arrays.push_back(array);
+		levels.push_back(level);
+	}
+
+	std::vector<std::vector<uint8_t> > generated;
+	bool generate_on_gpu = false;
+	if (generate_mipmaps && levels.size() == 1)
+	{
+		if (type == GL_UNSIGNED_BYTE)
+		{
+			Level source = levels[0];
+			std::vector<uint8_t*> pointers;
+			for (auto size: GetMipmapChainSizes(source.width, source.height))
+			{
+				generated.emplace_back(size_t(size.x) * size.y * channels);
+				pointers.push_back(generated.back().data());
+				levels.push_back({generated.back().data(), size.x, size.y, channels, size.x, 1, size.x * channels, generated.back().size()});
+			}
+			py::gil_scoped_release release;
+			GenerateMipmaps(source.data, source.width, source.height, channels, source.components, source.row_stride,
+					pointers, MipmapKernel::BSpline);
+		}
+		else
+		{
+			// Deep color data is linear, so plain box filter of the driver is good enough
+			generate_on_gpu = true;
+		}
+	}
+	int level_count = (int)levels.size();
+	size_t pixel_size = size_t(channels == 3 ? 4 : channels) * (type == GL_FLOAT ? 2 : arrays[0].itemsize());
+	Format format;
+	for (auto& level: levels)
+	{
+		format.bytes += size_t(level.width) * level.height * pixel_size;
+	}
+	if (generate_on_gpu)
+	{
+		for (auto size: GetMipmapChainSizes(levels[0].width, levels[0].height))
+		{
+			format.bytes += size_t(size.x) * size.y * pixel_size;
+			level_count += 1;
+		}
+	}
+	format.uncompressedBytes = format.bytes;
+
+	GLenum compressed_format = 0;
+	BlockFormat block_format = BlockFormat::BC7;
+	if (compress && type == GL_UNSIGNED_BYTE)
+	{
+		compressed_format = ChooseCompressedFormat(channels, block_format);
+		if (compressed_format == 0)
+		{
+			spdlog::warn("Driver supports no block compression format for {} channels, uploading uncompressed", channels);
+		}
+	}
+
+	// Encoded blocks replace data of the levels
+	std::vector<std::vector<uint8_t> > blocks;
+	m_encodeTime = 0.0;
+	m_encodeThroughput = 0.0;
+	if (compressed_format != 0)
+	{
+		auto encode_start = std::chrono::steady_clock::now();
+		size_t pixels = 0;
+		for (auto& level: levels)
+		{
+			blocks.emplace_back(GetCompressedSize(block_format, level.width, level.height));
+			pixels += size_t(level.width) * level.height;
+		}
+		{
+			py::gil_scoped_release release;
+			for (size_t i = 0; i < levels.size(); ++i)
+			{
+				CompressBlocks(levels[i].data, levels[i].width, levels[i].height, channels, levels[i].components,
+						levels[i].row_stride, block_format, blocks[i].data());
+			}
+		}
+		format.bytes = 0;
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			levels[i].data = blocks[i].data();
+			levels[i].size = blocks[i].size();
+			format.bytes += blocks[i].size();
+		}
+		m_encodeTime = MillisecondsSince(encode_start);
+		m_encodeThroughput = double(pixels) / (m_encodeTime * 1000.0);
+	}
+
+	// Pending upload, if any, is superseded by this one
+	if (m_fence != nullptr)
+	{
+		glDeleteSync((GLsync)m_fence);
+		m_fence = nullptr;
+	}
+
+	// Without sync objects there is no way to know when the transfer is done. Staging buffers belong to the share group
+	if (async_upload && (glFenceSync == nullptr || !m_shareGroup))
+	{
+		async_upload = false;
+	}
+
+	uint8_t* staging = nullptr;
+	std::vector<size_t> offsets;
+	if (async_upload)
+	{
+		size_t total_size = 0;
+		for (auto& level: levels)
+		{
+			offsets.push_back(total_size);
+			// Offsets into the buffer have to be aligned to the component size
+			total_size += (level.size + 7) & ~size_t(7);
+		}
+		staging = m_shareGroup->GetUnpackBuffer().Map(total_size);
+		if (staging == nullptr)
+		{
+			spdlog::warn("Could not map pixel unpack buffer, falling back to synchronous upload");
+			async_upload = false;
+		}
+		else
+		{
+			for (size_t i = 0; i < levels.size(); ++i)
+			{
+				memcpy(staging + offsets[i], levels[i].data, levels[i].size);
+			}
+			if (!m_shareGroup->GetUnpackBuffer().UnMap())
+			{
+				Render::PixelUnpackBuffer::UnBind();
+				spdlog::warn("Content of pixel unpack buffer was lost, falling back to synchronous upload");
+				async_upload = false;
+			}
+		}
+	}
+
+	GLuint target = m_textureHandle;
+	if (async_upload)
+	{
+		if (m_pendingHandle == 0)
+		{
+			glGenTextures(1, &m_pendingHandle);
+		}
+		target = m_pendingHandle;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, target);
+
+	GLint backup_alignment, backup_row_length;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &backup_alignment);
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &backup_row_length);
+
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMasks[channels - 1]);
+
+	int mipmap = 0;
+	for (auto& level: levels)
+	{
+		const void* data = async_upload ? (const void*)(uintptr_t)offsets[mipmap] : level.data;
+		if (compressed_format != 0)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, mipmap, compressed_format, level.width, level.height, 0, (GLsizei)level.size, data);
+		}
+		else
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, level.alignment);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, level.row_length);
+			// If a pixel has more components in memory than channels, e.g. for a channel view, extra ones are dropped by GL
+			glTexImage2D(GL_TEXTURE_2D, mipmap, internal_formats[channels - 1], level.width, level.height, 0,
+					formats[level.components - 1], type, data);
+		}
+		mipmap += 1;
+	}
+	if (generate_on_gpu)
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	if (level_count > 1)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	else
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+	format.levelCount = level_count;
+	format.valueRange = type == GL_UNSIGNED_BYTE ? 255.0f : type == GL_UNSIGNED_SHORT ? 65535.0f : 1.0f;
+	format.channels = channels;
+	format.type = type;
+	format.compressedFormat = compressed_format;
+	GLint internal_format = compressed_format != 0 ? (GLint)compressed_format : internal_formats[channels - 1];
+	format.srgb = internal_format == GL_SRGB8_ALPHA8 || internal_format == COMPRESSED_SRGB_ALPHA_BPTC_UNORM_EXT
+			|| internal_format == COMPRESSED_SRGB_S3TC_DXT1_EXT;
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, backup_row_length);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, backup_alignment);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_submitTime = start;
+	if (async_upload)
+	{
+		Render::PixelUnpackBuffer::UnBind();
+		m_pendingWidth = levels[0].width;
+		m_pendingHeight = levels[0].height;
+		m_pendingFormat = format;
+		m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		m_uploadTime = MillisecondsSince(start);
+	}
+	else
+	{
+		m_width = levels[0].width;
+		m_height = levels[0].height;
+		m_format = format;
+		m_uploadTime = MillisecondsSince(start);
+		m_uploadLatency = m_uploadTime;
+	}
+}
+
+bool Image::Poll()
+{
+	if (m_fence == nullptr)
+	{
+		return true;
+	}
+	GLenum result = glClientWaitSync((GLsync)m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+	glDeleteSync((GLsync)m_fence);
+	m_fence = nullptr;
+
+	std::swap(m_textureHandle, m_pendingHandle);
+	m_width = m_pendingWidth;
+	m_height = m_pendingHeight;
+	m_format = m_pendingFormat;
+	m_uploadLatency = MillisecondsSince(m_submitTime);
+	return true;
+}
+
+void Image::Finish()
+{
+	while (m_fence != nullptr)
+	{
+		GLenum result = glClientWaitSync((GLsync)m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+		if (result != GL_TIMEOUT_EXPIRED)
+		{
+			Poll();
+		}
+	}
+}
+
+void Image::UpdateRegion(int x, int y, py::array region)
+{
+	TRACE_SCOPE("Image::UpdateRegion", "upload");
+	// Edits apply to the content that is going to be displayed
+	Finish();
+
+	if (m_format.compressedFormat != 0)
+	{
+		throw runtime_error("Compressed images can not be updated, create the image with compress=False to edit it");
+	}
+
+	int channels = 1;
+	if (region.ndim() == 3)
+	{
+		channels = (int)region.shape(2);
+	}
+	else if (region.ndim() != 2)
+	{
+		throw runtime_error("Wrong number of dimensions. Should be either 2 or 3, but got %d", (int)region.ndim());
+	}
+	if (channels != m_format.channels)
+	{
+		throw runtime_error("Region has %d channels, but image has %d", channels, m_format.channels);
+	}
+
+	py::dtype dtype;
+	switch (m_format.type)
+	{
+		case GL_UNSIGNED_BYTE: dtype = py::dtype::of<uint8_t>(); break;
+		case GL_UNSIGNED_SHORT: dtype = py::dtype::of<uint16_t>(); break;
+		default: dtype = py::dtype::of<float>(); break;
+	}
+	bool same_type = region.dtype().is(dtype);
+	if (!same_type && !(m_format.type == GL_FLOAT && py::isinstance<py::array_t<double> >(region)))
+	{
+		throw runtime_error("Region dtype %s does not match dtype of the image %s",
+				std::string(py::str(region.dtype())).c_str(), std::string(py::str(dtype)).c_str());
+	}
+
+	Level level;
+	if (!same_type || !GetUnpackLayout(region, channels, level))
+	{
+		region = py::module::import("numpy").attr("ascontiguousarray")(region, dtype).cast<py::array>();
+		if (!GetUnpackLayout(region, channels, level))
+		{
+			throw runtime_error("Unexpected layout of a contiguous array");
+		}
+	}
+
+	if (x < 0 || y < 0 || x + level.width > m_width || y + level.height > m_height)
+	{
+		throw runtime_error("Region %dx%d at (%d, %d) is out of bounds of %dx%d image",
+				level.width, level.height, x, y, (int)m_width, (int)m_height);
+	}
+	if (level.width == 0 || level.height == 0)
+	{
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+
+	GLint backup_alignment, backup_row_length;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &backup_alignment);
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &backup_row_length);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, level.alignment);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, level.row_length);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, level.width, level.height, formats[level.components - 1], m_format.type, level.data);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, backup_row_length);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, backup_alignment);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (m_format.levelCount > 1)
+	{
+		UpdateMipmaps(x, y, x + level.width, y + level.height);
+	}
+}
+
+void Image::UpdateMipmaps(int x0, int y0, int x1, int y1)
+{
+	GLint backup_read, backup_draw;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &backup_read);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &backup_draw);
+	GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+	glDisable(GL_SCISSOR_TEST);
+
+	GLuint fbo[2];
+	glGenFramebuffers(2, fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo[1]);
+
+	// Each level is downsampled from the previous one, only within the footprint of the edited region.
+	// Blit with linear filter and 2x minification averages 2x2 texels, which is a box filter.
+	bool complete = true;
+	int width = (int)m_width;
+	int height = (int)m_height;
+	for (int level = 1; level < m_format.levelCount; ++level)
+	{
+		int src_width = width;
+		int src_height = height;
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		x0 = x0 / 2;
+		y0 = y0 / 2;
+		x1 = std::min(width, (x1 + 1) / 2);
+		y1 = std::min(height, (y1 + 1) / 2);
+
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureHandle, level - 1);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textureHandle, level);
+		// All formats used by SetImage are required to be renderable, this is a safety net for drivers that disagree
+		if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+				glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			complete = false;
+			break;
+		}
+		glBlitFramebuffer(x0 * 2, y0 * 2, std::min(src_width, x1 * 2), std::min(src_height, y1 * 2), x0, y0, x1, y1,
+				GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, backup_read);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, backup_draw);
+	glDeleteFramebuffers(2, fbo);
+	if (scissor)
+	{
+		glEnable(GL_SCISSOR_TEST);
+	}
+
+	if (!complete)
+	{
+		spdlog::debug("Texture format is not renderable, regenerating the whole mipmap chain");
+		glBindTexture(GL_TEXTURE_2D, m_textureHandle);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "ShareGroup.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace py = pybind11;
+
+typedef py::array_t<uint8_t, py::array::c_style> ndarray_uint8;
+
+
+class Image
+{
+public:
+	Image& operator=(const Image&) = delete;
+	Image(const Image&) = delete;
+
+	Image();
+
+	explicit Image(std::vector<py::array> ims, bool async_upload = false, bool generate_mipmaps = true, bool compress = false);
+
+	~Image();
+
+	uint32_t GetHandle() const
+	{
+		return m_textureHandle;
+	}
+
+	void GrayScaleToAlpha();
+
+	glm::vec2 GetSize() const
+	{
+		return glm::vec2(m_width, m_height);
+	}
+
+	// Uploads image, where `ims` is a list of mipmap levels.
+	// Supported dtypes are uint8, uint16 and float32. Strided arrays, such as crops and channel views, are uploaded
+	// directly from their buffer when the layout can be expressed with GL unpack parameters, otherwise a compact copy is made.
+	// If only one level is given and `generate_mipmaps` is true, the rest of the chain is generated.
+	// If `async_upload` is true, data is copied to a pixel unpack buffer and transferred by the driver in background.
+	// The previous content of the image stays visible until the transfer is completed, see `Poll`.
+	// If `compress` is true, uint8 data is encoded on CPU into blocks before upload: grayscale to BC4, two channels to BC5,
+	// color to BC7 if the driver supports BPTC, otherwise RGB to BC1 if it supports S3TC. Other data is uploaded as is.
+	void SetImage(std::vector<py::array> ims, bool async_upload = false, bool generate_mipmaps = true, bool compress = false);
+
+	// Replaces the rectangle of level 0 at (`x`, `y`) with `region`, which should have the same number of channels and dtype.
+	// Only the footprint of the rectangle is downsampled on the coarser levels, so the cost scales with the edited area.
+	// Mipmaps of the region are box filtered on GPU, which might slightly differ from the filter used to build the chain.
+	void UpdateRegion(int x, int y, py::array region);
+
+	// Checks if pending asynchronous upload has completed, and if so, makes the new content visible.
+	// Returns true if there is no pending upload.
+	bool Poll();
+
+	// Blocks until pending asynchronous upload is completed.
+	void Finish();
+
+	bool IsReady() const
+	{
+		return m_fence == nullptr;
+	}
+
+	// Value that corresponds to 1.0 when sampled: 255 for uint8, 65535 for uint16 and 1 for float data
+	float GetValueRange() const
+	{
+		return m_format.valueRange;
+	}
+
+	// True if the texture is sRGB encoded, then sampling decodes values, which are stored in units of the image data
+	bool IsSRGB() const
+	{
+		return m_format.srgb;
+	}
+
+	// Approximate amount of video memory taken by the texture, including mipmaps and the texture of a pending upload
+	size_t GetBytes() const
+	{
+		return m_format.bytes + (m_fence != nullptr ? m_pendingFormat.bytes : 0);
+	}
+
+	// Group of contexts the texture belongs to, it can be drawn only in them
+	const ShareGroupPtr& GetShareGroup() const
+	{
+		return m_shareGroup;
+	}
+
+	bool IsCompressed() const
+	{
+		return m_format.compressedFormat != 0;
+	}
+
+	// Video memory saved by block compression, zero if the image is not compressed
+	size_t GetBytesSaved() const
+	{
+		return m_format.uncompressedBytes - m_format.bytes;
+	}
+
+	ssize_t m_width;
+	ssize_t m_height;
+
+	// CPU time in milliseconds spent in the last call to SetImage.
+	double m_uploadTime = 0.0;
+	// Time in milliseconds from the last call to SetImage until the texture was ready for sampling.
+	double m_uploadLatency = 0.0;
+	// Time in milliseconds spent on block compression in the last call to SetImage, and its throughput in megapixels per second
+	double m_encodeTime = 0.0;
+	double m_encodeThroughput = 0.0;
+
+private:
+	void UpdateMipmaps(int x0, int y0, int x1, int y1);
+
+	// Properties of the texture content. They describe the displayed texture, while an asynchronous upload is pending
+	// the ones of the new content are kept aside and swapped in by Poll, together with the texture
+	struct Format
+	{
+		int levelCount = 0;
+		int channels = 0;
+		uint32_t type = 0;
+		float valueRange = 255.0f;
+		uint32_t compressedFormat = 0;
+		bool srgb = false;
+		size_t bytes = 0;
+		size_t uncompressedBytes = 0;
+	};
+
+	uint32_t m_textureHandle;
+	Format m_format;
+
+	uint32_t m_pendingHandle = 0;
+	ssize_t m_pendingWidth = -1;
+	ssize_t m_pendingHeight = -1;
+	Format m_pendingFormat;
+	void* m_fence = nullptr;
+	std::chrono::steady_clock::time_point m_submitTime;
+	ShareGroupPtr m_shareGroup;
+};
+
+typedef std::shared_ptr<Image> ImagePtr;
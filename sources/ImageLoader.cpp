@@ -0,0 +1,342 @@
+#include "ImageLoader.h"
+#include "MipmapGenerator.h"
+#include "Tracer.h"
+#include "runtime_error.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+
+ImageLoader::ImageLoader(std::vector<std::string> paths, int radius, int threads):
+	m_radius(radius), m_paths(std::move(paths)), m_pool(threads)
+{
+}
+
+ImageLoader::~ImageLoader()
+{
+	// Queued tasks still run when the pool stops, cancelled ones return right away
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& entry: m_entries)
+	{
+		entry.second->cancelled = true;
+	}
+}
+
+int ImageLoader::Wrap(int index) const
+{
+	int count = (int)m_paths.size();
+	return ((index % count) + count) % count;
+}
+
+std::vector<int> ImageLoader::GetWindow() const
+{
+	std::vector<int> window = { m_current };
+	int radius = std::min(m_radius, ((int)m_paths.size() - 1) / 2);
+	for (int i = 1; i <= radius; ++i)
+	{
+		window.push_back(Wrap(m_current + i));
+		window.push_back(Wrap(m_current - i));
+	}
+	return window;
+}
+
+void ImageLoader::Prefetch(int index)
+{
+	if (m_paths.empty())
+	{
+		return;
+	}
+
+	// Textures must be released on this thread, and outside of the lock
+	std::vector<ImagePtr> released;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_current = Wrap(index);
+	auto window = GetWindow();
+
+	for (auto it = m_entries.begin(); it != m_entries.end();)
+	{
+		if (std::find(window.begin(), window.end(), it->first) == window.end())
+		{
+			it->second->cancelled = true;
+			released.push_back(std::move(it->second->texture));
+			it = m_entries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// Tasks are taken in order, so the nearest images are decoded first
+	for (int i: window)
+	{
+		if (m_entries.find(i) == m_entries.end())
+		{
+			auto entry = std::make_shared<Entry>();
+			m_entries[i] = entry;
+			m_pool.Enqueue([this, i, entry]()
+			{
+				Run(i, entry);
+			});
+		}
+	}
+}
+
+void ImageLoader::Run(int index, const EntryPtr& entry)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (entry->cancelled || entry->state != Entry::Queued)
+		{
+			return;
+		}
+		entry->state = Entry::Decoding;
+	}
+
+	DecodedImagePtr image;
+	std::string error;
+	try
+	{
+		image = Decode(m_paths[index]);
+	}
+	catch (const std::exception& e)
+	{
+		error = e.what();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		entry->image = image;
+		entry->error = error;
+		entry->state = Entry::Ready;
+	}
+	m_condition.notify_all();
+}
+
+DecodedImagePtr ImageLoader::Get(int index)
+{
+	if (m_paths.empty())
+	{
+		throw runtime_error("Image list is empty");
+	}
+	index = Wrap(index);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	EntryPtr& slot = m_entries[index];
+	if (!slot)
+	{
+		slot = std::make_shared<Entry>();
+	}
+	EntryPtr entry = slot;
+
+	if (entry->state == Entry::Ready)
+	{
+		++m_hits;
+	}
+	else
+	{
+		++m_misses;
+		if (entry->state == Entry::Queued)
+		{
+			// Worker has not picked it up yet, so it is faster to decode right here
+			entry->state = Entry::Decoding;
+			lock.unlock();
+			DecodedImagePtr image;
+			std::string error;
+			try
+			{
+				image = Decode(m_paths[index]);
+			}
+			catch (const std::exception& e)
+			{
+				error = e.what();
+			}
+			lock.lock();
+			entry->image = image;
+			entry->error = error;
+			entry->state = Entry::Ready;
+			m_condition.notify_all();
+		}
+		else
+		{
+			m_condition.wait(lock, [&entry]() { return entry->state == Entry::Ready; });
+		}
+	}
+
+	if (!entry->error.empty())
+	{
+		throw runtime_error("%s", entry->error.c_str());
+	}
+	return entry->image;
+}
+
+ImagePtr ImageLoader::GetImage(int index)
+{
+	DecodedImagePtr image;
+	{
+		py::gil_scoped_release release;
+		image = Get(index);
+	}
+
+	index = Wrap(index);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(index);
+		if (it != m_entries.end() && it->second->texture)
+		{
+			return it->second->texture;
+		}
+	}
+
+	std::vector<py::array> levels;
+	for (int i = 0; i < (int)image->levels.size(); ++i)
+	{
+		levels.push_back(ToArray(image, i));
+	}
+	auto texture = std::make_shared<Image>(levels);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(index);
+	if (it != m_entries.end())
+	{
+		it->second->texture = texture;
+	}
+	return texture;
+}
+
+int ImageLoader::Upload(int max_uploads)
+{
+	TRACE_SCOPE("ImageLoader::Upload", "upload");
+	int uploads = 0;
+	while (uploads < max_uploads)
+	{
+		int index = -1;
+		DecodedImagePtr image;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (int i: GetWindow())
+			{
+				auto it = m_entries.find(i);
+				if (it != m_entries.end() && it->second->state == Entry::Ready && it->second->image && !it->second->texture)
+				{
+					index = i;
+					image = it->second->image;
+					break;
+				}
+			}
+		}
+		if (index < 0)
+		{
+			break;
+		}
+
+		std::vector<py::array> levels;
+		for (int i = 0; i < (int)image->levels.size(); ++i)
+		{
+			levels.push_back(ToArray(image, i));
+		}
+		auto texture = std::make_shared<Image>(levels, true);
+		++uploads;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(index);
+		if (it != m_entries.end())
+		{
+			it->second->texture = texture;
+		}
+	}
+	return uploads;
+}
+
+bool ImageLoader::IsReady(int index)
+{
+	if (m_paths.empty())
+	{
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(Wrap(index));
+	return it != m_entries.end() && it->second->state == Entry::Ready;
+}
+
+DecodedImagePtr ImageLoader::Decode(const std::string& path)
+{
+	TRACE_SCOPE("ImageLoader::Decode", "loader");
+	auto start = std::chrono::steady_clock::now();
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int component_size;
+	void* data;
+	if (stbi_is_hdr(path.c_str()))
+	{
+		component_size = 4;
+		data = stbi_loadf(path.c_str(), &width, &height, &channels, 0);
+	}
+	else if (stbi_is_16_bit(path.c_str()))
+	{
+		component_size = 2;
+		data = stbi_load_16(path.c_str(), &width, &height, &channels, 0);
+	}
+	else
+	{
+		component_size = 1;
+		data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	}
+	if (data == nullptr)
+	{
+		throw runtime_error("Could not decode %s: %s", path.c_str(), stbi_failure_reason());
+	}
+
+	auto image = std::make_shared<DecodedImage>();
+	image->channels = channels;
+	image->component_size = component_size;
+	image->levels.push_back({ std::shared_ptr<void>(data, stbi_image_free), width, height });
+
+	// Deep color images get their mipmaps on GPU, see Image::SetImage
+	if (component_size == 1)
+	{
+		std::vector<uint8_t*> pointers;
+		for (auto size: GetMipmapChainSizes(width, height))
+		{
+			auto* level = (uint8_t*)malloc(size_t(size.x) * size.y * channels);
+			pointers.push_back(level);
+			image->levels.push_back({ std::shared_ptr<void>(level, free), size.x, size.y });
+		}
+		GenerateMipmaps((const uint8_t*)data, width, height, channels, channels, ptrdiff_t(width) * channels, pointers,
+				MipmapKernel::BSpline);
+	}
+
+	image->decode_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return image;
+}
+
+py::array ImageLoader::ToArray(const DecodedImagePtr& image, int level)
+{
+	const DecodedImage::Level& l = image->levels[level];
+	std::vector<ssize_t> shape = { l.height, l.width };
+	if (image->channels > 1)
+	{
+		shape.push_back(image->channels);
+	}
+
+	py::dtype dtype = py::dtype::of<uint8_t>();
+	if (image->component_size == 2)
+	{
+		dtype = py::dtype::of<uint16_t>();
+	}
+	else if (image->component_size == 4)
+	{
+		dtype = py::dtype::of<float>();
+	}
+
+	// Array keeps the decoded buffer alive
+	py::capsule owner(new std::shared_ptr<void>(l.data), [](void* p)
+		{
+			delete (std::shared_ptr<void>*)p;
+		});
+	return py::array(dtype, shape, {}, l.data.get(), owner);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "Image.h"
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+struct DecodedImage
+{
+	struct Level
+	{
+		std::shared_ptr<void> data;
+		int width;
+		int height;
+	};
+
+	// Level 0 is the decoded image. For 8-bit images the rest of the mipmap chain is generated right after decoding.
+	std::vector<Level> levels;
+	int channels = 0;
+	// 1 for uint8, 2 for uint16, 4 for float32
+	int component_size = 1;
+	// Time in milliseconds spent on decoding and mipmap generation
+	double decode_time = 0.0;
+};
+
+typedef std::shared_ptr<DecodedImage> DecodedImagePtr;
+
+
+// Decodes images from a list of paths on a pool of worker threads.
+// Images around the current one are decoded ahead of time, so that navigating to them does not wait for decoding.
+class ImageLoader
+{
+	ImageLoader(const ImageLoader&) = delete; // non construction-copyable
+	ImageLoader& operator=(const ImageLoader&) = delete; // non copyable
+public:
+	ImageLoader(std::vector<std::string> paths, int radius = 2, int threads = 2);
+
+	~ImageLoader();
+
+	// Makes `index` current and schedules decoding of it and of `radius` images before and after it.
+	// Everything outside of that window is cancelled and freed. Indices wrap around.
+	void Prefetch(int index);
+
+	// Returns decoded image, blocks if it is being decoded. If decoding has not started yet, it is done on the calling thread.
+	DecodedImagePtr Get(int index);
+
+	// Returns texture for the image. Must be called from the thread that owns GL context.
+	ImagePtr GetImage(int index);
+
+	// Creates textures for up to `max_uploads` decoded images in the prefetch window, nearest to the current one first.
+	// Returns the number of created textures. Must be called from the thread that owns GL context, e.g. once per frame.
+	int Upload(int max_uploads = 1);
+
+	bool IsReady(int index);
+
+	int GetCount() const
+	{
+		return (int)m_paths.size();
+	}
+
+	// Decodes image with stb_image. Throws on failure.
+	static DecodedImagePtr Decode(const std::string& path);
+
+	// Wraps level of decoded image into numpy array without a copy
+	static py::array ToArray(const DecodedImagePtr& image, int level = 0);
+
+	int m_radius;
+	// Number of requests that found the image already decoded, and that had to wait for it
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+
+private:
+	struct Entry
+	{
+		enum State
+		{
+			Queued,
+			Decoding,
+			Ready
+		};
+		State state = Queued;
+		bool cancelled = false;
+		DecodedImagePtr image;
+		std::string error;
+		ImagePtr texture;
+	};
+	typedef std::shared_ptr<Entry> EntryPtr;
+
+	int Wrap(int index) const;
+
+	// Indices of the prefetch window, ordered by distance to the current one
+	std::vector<int> GetWindow() const;
+
+	void Run(int index, const EntryPtr& entry);
+
+	std::vector<std::string> m_paths;
+	std::map<int, EntryPtr> m_entries;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	int m_current = 0;
+	ThreadPool m_pool;
+};
+
+typedef std::shared_ptr<ImageLoader> ImageLoaderPtr;
@@ -0,0 +1,133 @@
+#include "InputQueue.h"
+
+
+void InputQueue::Push(const Event& event)
+{
+	if (m_events.size() >= Capacity)
+	{
+		++m_dropped;
+		return;
+	}
+	m_events.push_back(event);
+}
+
+void InputQueue::PushMove(double time, float x, float y, float lx, float ly)
+{
+	if (!m_events.empty() && m_events.back().type == MouseMove)
+	{
+		Event& last = m_events.back();
+		last.time = time;
+		last.x = x;
+		last.y = y;
+		last.lx = lx;
+		last.ly = ly;
+		last.count += 1;
+		return;
+	}
+	Push({ time, MouseMove, 0, 0, 0, 1, x, y, lx, ly, 0.0f });
+}
+
+void InputQueue::PushButton(double time, int button, int action, int mods, float x, float y, float lx, float ly)
+{
+	Push({ time, MouseButton, button, action, mods, 1, x, y, lx, ly, 0.0f });
+}
+
+void InputQueue::PushKey(double time, int key, int action, int mods)
+{
+	// Repeats of a held key are merged, as moves are
+	if (action == 2 && !m_events.empty() && m_events.back().type == Key && m_events.back().button == key && m_events.back().action == 2)
+	{
+		m_events.back().time = time;
+		m_events.back().count += 1;
+		return;
+	}
+	Push({ time, Key, key, action, mods, 1, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f });
+}
+
+void InputQueue::PushScroll(double time, float offset, float x, float y, float lx, float ly)
+{
+	if (!m_events.empty() && m_events.back().type == Scroll)
+	{
+		Event& last = m_events.back();
+		last.time = time;
+		last.x = x;
+		last.y = y;
+		last.lx = lx;
+		last.ly = ly;
+		last.value += offset;
+		last.count += 1;
+		return;
+	}
+	Push({ time, Scroll, 0, 0, 0, 1, x, y, lx, ly, offset });
+}
+
+std::vector<InputQueue::Event> InputQueue::Drain()
+{
+	std::vector<Event> events;
+	events.swap(m_events);
+	// Keeps the capacity, so that the queue does not allocate every frame
+	m_events.reserve(events.capacity());
+	return events;
+}
+
+
+#include <doctest.h>
+
+TEST_CASE("[InputQueue] Coalescing")
+{
+	InputQueue queue;
+	for (int i = 0; i < 100; ++i)
+	{
+		queue.PushMove(i * 0.001, float(i), float(2 * i), float(i) / 2.0f, float(i));
+	}
+	queue.PushButton(0.2, 0, 1, 0, 99.0f, 198.0f, 49.5f, 99.0f);
+	queue.PushMove(0.3, 5.0f, 6.0f, 2.5f, 3.0f);
+	queue.PushMove(0.4, 7.0f, 8.0f, 3.5f, 4.0f);
+	queue.PushScroll(0.5, 1.0f, 7.0f, 8.0f, 3.5f, 4.0f);
+	queue.PushScroll(0.6, -3.0f, 7.0f, 8.0f, 3.5f, 4.0f);
+	queue.PushKey(0.7, 'A', 1, 0);
+	queue.PushKey(0.8, 'A', 2, 0);
+	queue.PushKey(0.9, 'A', 2, 0);
+	queue.PushKey(1.0, 'A', 0, 0);
+
+	auto events = queue.Drain();
+	CHECK_EQ(queue.GetSize(), 0u);
+	REQUIRE_EQ(events.size(), 7u);
+
+	CHECK_EQ(events[0].type, InputQueue::MouseMove);
+	CHECK_EQ(events[0].count, 100);
+	CHECK_EQ(events[0].x, 99.0f);
+	CHECK_EQ(events[0].y, 198.0f);
+	CHECK_EQ(events[0].lx, 49.5f);
+	CHECK_EQ(events[0].time, 99 * 0.001);
+
+	CHECK_EQ(events[1].type, InputQueue::MouseButton);
+	CHECK_EQ(events[1].action, 1);
+
+	CHECK_EQ(events[2].type, InputQueue::MouseMove);
+	CHECK_EQ(events[2].count, 2);
+	CHECK_EQ(events[2].x, 7.0f);
+
+	CHECK_EQ(events[3].type, InputQueue::Scroll);
+	CHECK_EQ(events[3].value, -2.0f);
+
+	CHECK_EQ(events[4].action, 1);
+	CHECK_EQ(events[5].action, 2);
+	CHECK_EQ(events[5].count, 2);
+	CHECK_EQ(events[6].action, 0);
+	CHECK_EQ(events[6].type, InputQueue::Key);
+}
+
+TEST_CASE("[InputQueue] Capacity")
+{
+	InputQueue queue;
+	for (int i = 0; i < InputQueue::Capacity + 10; ++i)
+	{
+		queue.PushButton(0.0, 0, i % 2, 0, 0.0f, 0.0f, 0.0f, 0.0f);
+	}
+	CHECK_EQ(queue.GetSize(), (size_t)InputQueue::Capacity);
+	CHECK_EQ(queue.GetDropped(), 10u);
+	queue.Drain();
+	queue.PushKey(0.0, 'A', 1, 0);
+	CHECK_EQ(queue.GetSize(), 1u);
+}
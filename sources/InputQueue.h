@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+
+// Buffer of input events, which are handed to python once per frame instead of calling back into it for each event.
+// Consecutive cursor moves are merged into one, that has the last position and the number of merged moves,
+// so a high-rate mouse adds one event per frame, while the order of moves, buttons, keys and scrolls is kept.
+// Not thread safe, GLFW callbacks and draining happen on the thread that owns the window.
+class InputQueue
+{
+public:
+	enum Type
+	{
+		MouseMove = 0,
+		MouseButton = 1,
+		Key = 2,
+		Scroll = 3
+	};
+
+	enum
+	{
+		// Events beyond this are dropped, if the queue is not drained, e.g. in a mode that does not use it
+		Capacity = 4096
+	};
+
+	// Layout of the numpy structured array. Time is of glfwGetTime, x, y are in framebuffer pixels and lx, ly are in image
+	// space of the view under the cursor, at the time of the event. `button` is the mouse button, key or zero,
+	// `action` is 1 for press, 0 for release, 2 for key repeat, `value` is the scroll offset.
+	struct Event
+	{
+		double time;
+		int32_t type;
+		int32_t button;
+		int32_t action;
+		int32_t mods;
+		int32_t count;
+		float x;
+		float y;
+		float lx;
+		float ly;
+		float value;
+	};
+
+	void PushMove(double time, float x, float y, float lx, float ly);
+	void PushButton(double time, int button, int action, int mods, float x, float y, float lx, float ly);
+	void PushKey(double time, int key, int action, int mods);
+	void PushScroll(double time, float offset, float x, float y, float lx, float ly);
+
+	// Returns events since the last call, oldest first, and clears the queue
+	std::vector<Event> Drain();
+
+	size_t GetSize() const
+	{
+		return m_events.size();
+	}
+
+	// Number of events dropped because the queue was full
+	uint64_t GetDropped() const
+	{
+		return m_dropped;
+	}
+
+private:
+	void Push(const Event& event);
+
+	std::vector<Event> m_events;
+	uint64_t m_dropped = 0;
+};
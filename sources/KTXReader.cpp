@@ -0,0 +1,267 @@
+#include "KTXReader.h"
+#include "GLCompressionTypes.h"
+#include "runtime_error.h"
+#include <GL/gl3w.h>
+#include <algorithm>
+#include <string.h>
+
+using namespace Render;
+
+
+namespace
+{
+	const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct KTXHeader
+	{
+		uint32_t endianness;
+		uint32_t glType;
+		uint32_t glTypeSize;
+		uint32_t glFormat;
+		uint32_t glInternalFormat;
+		uint32_t glBaseInternalFormat;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t numberOfArrayElements;
+		uint32_t numberOfFaces;
+		uint32_t numberOfMipmapLevels;
+		uint32_t bytesOfKeyValueData;
+	};
+
+	static_assert(sizeof(KTXHeader) == 52, "Wrong KTX header size");
+
+	const TextureFormat::DataType SignedFloat = TextureFormat::DataType(TextureFormat::Float | TextureFormat::Signed);
+
+	bool MapInternalFormat(uint32_t internal_format, TextureFormat& f)
+	{
+		const auto l = TextureFormat::lRGB;
+		const auto s = TextureFormat::sRGB;
+		const auto u8 = TextureFormat::UnsignedByteNormalized;
+		const auto s8 = TextureFormat::SignedByteNormalized;
+		switch (internal_format)
+		{
+			case COMPRESSED_RGB_S3TC_DXT1_EXT:
+			case COMPRESSED_RGBA_S3TC_DXT1_EXT: f = { l, TextureFormat::DXT1, u8 }; return true;
+			case COMPRESSED_SRGB_S3TC_DXT1_EXT:
+			case COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: f = { s, TextureFormat::DXT1, u8 }; return true;
+			case COMPRESSED_RGBA_S3TC_DXT3_EXT: f = { l, TextureFormat::DXT3, u8 }; return true;
+			case COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT: f = { s, TextureFormat::DXT3, u8 }; return true;
+			case COMPRESSED_RGBA_S3TC_DXT5_EXT: f = { l, TextureFormat::DXT5, u8 }; return true;
+			case COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: f = { s, TextureFormat::DXT5, u8 }; return true;
+			case COMPRESSED_RED_RGTC1: f = { l, TextureFormat::BC4, u8 }; return true;
+			case COMPRESSED_SIGNED_RED_RGTC1: f = { l, TextureFormat::BC4, s8 }; return true;
+			case COMPRESSED_RG_RGTC2: f = { l, TextureFormat::BC5, u8 }; return true;
+			case COMPRESSED_SIGNED_RG_RGTC2: f = { l, TextureFormat::BC5, s8 }; return true;
+			case COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_EXT: f = { l, TextureFormat::BC6, TextureFormat::Float }; return true;
+			case COMPRESSED_RGB_BPTC_SIGNED_FLOAT_EXT: f = { l, TextureFormat::BC6, SignedFloat }; return true;
+			case COMPRESSED_RGBA_BPTC_UNORM_EXT: f = { l, TextureFormat::BC7, u8 }; return true;
+			case COMPRESSED_SRGB_ALPHA_BPTC_UNORM_EXT: f = { s, TextureFormat::BC7, u8 }; return true;
+			case ETC1_RGB8_OES: f = { l, TextureFormat::ETC1, u8 }; return true;
+			case COMPRESSED_RGB8_ETC2: f = { l, TextureFormat::ETC2_RGB, u8 }; return true;
+			case COMPRESSED_SRGB8_ETC2: f = { s, TextureFormat::ETC2_RGB, u8 }; return true;
+			case COMPRESSED_RGBA8_ETC2_EAC: f = { l, TextureFormat::ETC2_RGBA, u8 }; return true;
+			case COMPRESSED_SRGB8_ALPHA8_ETC2_EAC: f = { s, TextureFormat::ETC2_RGBA, u8 }; return true;
+			case COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2: f = { l, TextureFormat::ETC2_RGB_A1, u8 }; return true;
+			case COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2: f = { s, TextureFormat::ETC2_RGB_A1, u8 }; return true;
+			case COMPRESSED_R11_EAC: f = { l, TextureFormat::EAC_R11, u8 }; return true;
+			case COMPRESSED_SIGNED_R11_EAC: f = { l, TextureFormat::EAC_R11, s8 }; return true;
+			case COMPRESSED_RG11_EAC: f = { l, TextureFormat::EAC_RG11, u8 }; return true;
+			case COMPRESSED_SIGNED_RG11_EAC: f = { l, TextureFormat::EAC_RG11, s8 }; return true;
+
+			case GL_R8: f = { l, TextureFormat::R8, u8 }; return true;
+			case GL_RG8: f = { l, TextureFormat::RG88, u8 }; return true;
+			case GL_RGB8: f = { l, TextureFormat::RGB888, u8 }; return true;
+			case GL_SRGB8: f = { s, TextureFormat::RGB888, u8 }; return true;
+			case GL_RGBA8: f = { l, TextureFormat::RGBA8888, u8 }; return true;
+			case GL_SRGB8_ALPHA8: f = { s, TextureFormat::RGBA8888, u8 }; return true;
+			case GL_R16: f = { l, TextureFormat::R16, TextureFormat::UnsignedShortNormalized }; return true;
+			case GL_RGBA16: f = { l, TextureFormat::RGBA16161616, TextureFormat::UnsignedShortNormalized }; return true;
+			case GL_R32F: f = { l, TextureFormat::R32, SignedFloat }; return true;
+			case GL_RGBA32F: f = { l, TextureFormat::RGBA32323232, SignedFloat }; return true;
+		}
+		return false;
+	}
+
+	size_t Align4(size_t x)
+	{
+		return (x + 3u) & ~size_t(3u);
+	}
+}
+
+
+KTXReader::KTXReader(Blob file): m_file(std::move(file))
+{
+	if (!CheckMagic(m_file))
+	{
+		throw runtime_error("Not a KTX file");
+	}
+	size_t offset = sizeof(KTX_IDENTIFIER);
+	if (m_file.size < offset + sizeof(KTXHeader))
+	{
+		throw runtime_error("KTX file is truncated");
+	}
+
+	KTXHeader header;
+	memcpy(&header, m_file.data.get() + offset, sizeof(KTXHeader));
+	offset += sizeof(KTXHeader) + header.bytesOfKeyValueData;
+
+	if (header.endianness != 0x04030201)
+	{
+		throw runtime_error("KTX files with non-native endianness are not supported");
+	}
+	if (header.pixelDepth > 1 || header.numberOfArrayElements > 0)
+	{
+		throw runtime_error("Only 2D KTX textures are supported");
+	}
+	if (header.numberOfFaces != 1 && header.numberOfFaces != 6)
+	{
+		throw runtime_error("Wrong number of faces in KTX file: %d", header.numberOfFaces);
+	}
+	if (!MapInternalFormat(header.glInternalFormat, m_format))
+	{
+		throw runtime_error("Unsupported KTX internal format: 0x%x", header.glInternalFormat);
+	}
+
+	m_size = glm::ivec2(header.pixelWidth, std::max(header.pixelHeight, 1u));
+	m_faceCount = header.numberOfFaces;
+	// Zero means that mipmaps should be generated on load, only the base level is stored
+	m_mipmapCount = std::max(int(header.numberOfMipmapLevels), 1);
+
+	int max_mipmaps = 1;
+	while ((std::max(m_size.x, m_size.y) >> max_mipmaps) > 0)
+	{
+		++max_mipmaps;
+	}
+	if (m_size.x < 1 || m_mipmapCount > max_mipmaps)
+	{
+		throw runtime_error("Wrong KTX texture size %dx%d with %d mipmaps", m_size.x, m_size.y, m_mipmapCount);
+	}
+
+	for (int mipmap = 0; mipmap < m_mipmapCount; ++mipmap)
+	{
+		if (m_file.size < offset + 4)
+		{
+			throw runtime_error("KTX file is truncated");
+		}
+		uint32_t image_size;
+		memcpy(&image_size, m_file.data.get() + offset, 4);
+		offset += 4;
+
+		if (image_size < GetLevelSize(mipmap))
+		{
+			throw runtime_error("Wrong size of mipmap %d in KTX file: %d", mipmap, image_size);
+		}
+		for (int face = 0; face < m_faceCount; ++face)
+		{
+			m_offsets.push_back(offset);
+			// Cubemap faces are padded individually, which is no-op for the rest of the textures
+			offset = Align4(offset + image_size);
+		}
+	}
+	if (offset > m_file.size)
+	{
+		throw runtime_error("KTX file is truncated, expected %d bytes, but got %d", (int)offset, (int)m_file.size);
+	}
+}
+
+bool KTXReader::CheckMagic(const Blob& file)
+{
+	return file.size >= sizeof(KTX_IDENTIFIER) && memcmp(file.data.get(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0;
+}
+
+IReader::Blob KTXReader::Read(int mipmap, int face)
+{
+	size_t offset = m_offsets[mipmap * m_faceCount + face];
+	const uint8_t* src = m_file.data.get() + offset;
+	size_t size = GetLevelSize(mipmap);
+
+	// Rows of uncompressed formats are aligned to 4 bytes in the file, but blobs are tightly packed
+	glm::ivec2 level = GetSize2D(mipmap);
+	size_t row = level.x * GetBitsPerPixel() / 8;
+	if (DecodePixelType(GetFormat().pixel_format).compressed || row % 4 == 0)
+	{
+		return m_file.Slice(offset, size);
+	}
+
+	std::shared_ptr<uint8_t> data(new uint8_t[size], std::default_delete<uint8_t[]>());
+	for (int y = 0; y < level.y; ++y)
+	{
+		memcpy(data.get() + y * row, src + y * Align4(row), row);
+	}
+	return { data, size };
+}
+
+glm::ivec3 KTXReader::GetSize(int mipmap) const
+{
+	return glm::ivec3(glm::max(m_size >> mipmap, glm::ivec2(1)), 1);
+}
+
+
+#include <doctest.h>
+
+namespace
+{
+	IReader::Blob MakeKTX(int width, int height, uint32_t internal_format, const std::vector<std::vector<uint8_t> >& mipmaps)
+	{
+		KTXHeader header = {};
+		header.endianness = 0x04030201;
+		header.glInternalFormat = internal_format;
+		header.pixelWidth = width;
+		header.pixelHeight = height;
+		header.numberOfFaces = 1;
+		header.numberOfMipmapLevels = (uint32_t)mipmaps.size();
+
+		std::vector<uint8_t> file(KTX_IDENTIFIER, KTX_IDENTIFIER + sizeof(KTX_IDENTIFIER));
+		file.insert(file.end(), (uint8_t*)&header, (uint8_t*)&header + sizeof(header));
+		for (auto& m: mipmaps)
+		{
+			uint32_t size = (uint32_t)m.size();
+			file.insert(file.end(), (uint8_t*)&size, (uint8_t*)&size + 4);
+			file.insert(file.end(), m.begin(), m.end());
+			file.resize(Align4(file.size()));
+		}
+
+		std::shared_ptr<uint8_t> data(new uint8_t[file.size()], std::default_delete<uint8_t[]>());
+		memcpy(data.get(), file.data(), file.size());
+		return { data, file.size() };
+	}
+}
+
+TEST_CASE("[Render] KTXReader")
+{
+	SUBCASE("Compressed")
+	{
+		std::vector<uint8_t> block(16, 0);
+		KTXReader reader(MakeKTX(5, 4, COMPRESSED_RGBA_BPTC_UNORM_EXT, { std::vector<uint8_t>(32), block, block }));
+		CHECK_EQ(reader.GetFormat().pixel_format, TextureFormat::BC7);
+		CHECK_EQ(reader.GetMipmapCount(), 3);
+		CHECK_EQ(reader.GetSize(1), glm::ivec3(2, 2, 1));
+		CHECK_EQ(reader.Read(0, 0).size, 32);
+		CHECK_EQ(reader.Read(2, 0).size, 16);
+	}
+
+	SUBCASE("Row padding")
+	{
+		// 3x2 RGB rows are 9 bytes in memory, and 12 bytes in the file
+		std::vector<uint8_t> level(12 * 2, 0xff);
+		for (int i = 0; i < 9; ++i)
+		{
+			level[i] = i;
+			level[12 + i] = 9 + i;
+		}
+		KTXReader reader(MakeKTX(3, 2, GL_RGB8, { level }));
+		auto blob = reader.Read(0, 0);
+		REQUIRE_EQ(blob.size, 18);
+		for (int i = 0; i < 18; ++i)
+		{
+			CHECK_EQ(blob.data.get()[i], i);
+		}
+	}
+
+	SUBCASE("Errors")
+	{
+		REQUIRE_THROWS(KTXReader(MakeKTX(4, 4, GL_RGBA8, { std::vector<uint8_t>(32) })));
+		REQUIRE_THROWS(KTXReader(MakeKTX(4, 4, GL_DEPTH_COMPONENT16, { std::vector<uint8_t>(32) })));
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "IReader.h"
+#include <vector>
+
+
+namespace Render
+{
+	// Reads KTX 1.1 files with compressed formats supported by GetGLMappedTypes, or with 8-bit, 16-bit and float formats.
+	// Blobs returned by `Read` point into the file data, unless rows of an uncompressed mipmap have to be repacked.
+	class KTXReader: public IReader
+	{
+	public:
+		// `file` is the whole content of the file. Throws if the file is malformed or the format is not supported.
+		explicit KTXReader(Blob file);
+
+		static bool CheckMagic(const Blob& file);
+
+		Blob Read(int mipmap, int face) override;
+
+		glm::ivec3 GetSize(int mipmap) const override;
+
+		int GetFaceCount() const override
+		{
+			return m_faceCount;
+		}
+
+		int GetMipmapCount() const override
+		{
+			return m_mipmapCount;
+		}
+
+		TextureFormat GetFormat() const override
+		{
+			return m_format;
+		}
+
+	private:
+		Blob m_file;
+		TextureFormat m_format;
+		glm::ivec2 m_size;
+		int m_faceCount = 1;
+		int m_mipmapCount = 1;
+		// Offset of each face of each mipmap, mipmaps are stored one after another with all of their faces
+		std::vector<size_t> m_offsets;
+	};
+}
@@ -0,0 +1,179 @@
+#include "MappedFile.h"
+#include "runtime_error.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Render;
+
+
+namespace
+{
+	size_t GetPageSize()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwPageSize;
+#else
+		return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	// Start of the page containing the blob and length from there up to the end of the blob
+	void PageRange(const IReader::Blob& blob, uint8_t*& start, size_t& length)
+	{
+		static size_t page = GetPageSize();
+		start = (uint8_t*)((uintptr_t)blob.data.get() & ~(uintptr_t)(page - 1));
+		length = blob.size + (blob.data.get() - start);
+	}
+}
+
+IReader::Blob Render::MapFile(const std::string& path)
+{
+	IReader::Blob blob;
+	blob.mapped = true;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw runtime_error("Could not open %s", path.c_str());
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		throw runtime_error("Could not map %s, file is empty", path.c_str());
+	}
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	// The mapping keeps the file open
+	CloseHandle(file);
+	if (mapping == nullptr)
+	{
+		throw runtime_error("Could not map %s", path.c_str());
+	}
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == nullptr)
+	{
+		throw runtime_error("Could not map %s", path.c_str());
+	}
+	blob.size = (size_t)size.QuadPart;
+	blob.data = std::shared_ptr<uint8_t>((uint8_t*)data, [](uint8_t* p)
+	{
+		UnmapViewOfFile(p);
+	});
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw runtime_error("Could not open %s", path.c_str());
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		throw runtime_error("Could not map %s, file is empty", path.c_str());
+	}
+	size_t size = (size_t)st.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file open
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		throw runtime_error("Could not map %s", path.c_str());
+	}
+	// Textures are read front to back, once
+	madvise(data, size, MADV_SEQUENTIAL);
+	blob.size = size;
+	blob.data = std::shared_ptr<uint8_t>((uint8_t*)data, [size](uint8_t* p)
+	{
+		munmap(p, size);
+	});
+#endif
+	return blob;
+}
+
+void Render::PrefetchBlob(const IReader::Blob& blob)
+{
+	if (!blob.mapped || blob.size == 0)
+	{
+		return;
+	}
+	uint8_t* start;
+	size_t length;
+	PageRange(blob, start, length);
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range = { start, length };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	madvise(start, length, MADV_WILLNEED);
+#endif
+}
+
+void Render::EvictBlob(const IReader::Blob& blob)
+{
+	if (!blob.mapped || blob.size == 0)
+	{
+		return;
+	}
+	uint8_t* start;
+	size_t length;
+	PageRange(blob, start, length);
+#ifdef _WIN32
+	// Unlocking pages that are not locked removes them from the working set
+	VirtualUnlock(start, length);
+#else
+	// Mapping is private and read-only, so the pages are never dirty and are simply read from the file again if needed
+	madvise(start, length, MADV_DONTNEED);
+#endif
+}
+
+
+#include <doctest.h>
+#include <stdio.h>
+#include <vector>
+
+TEST_CASE("[Render] MappedFile")
+{
+	std::vector<uint8_t> content(3 * 4096 + 17);
+	for (size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = uint8_t(i * 7 + 3);
+	}
+	std::string path = "mapped_file_test.bin";
+	FILE* f = fopen(path.c_str(), "wb");
+	REQUIRE(f != nullptr);
+	fwrite(content.data(), 1, content.size(), f);
+	fclose(f);
+
+	{
+		auto blob = MapFile(path);
+		CHECK(blob.mapped);
+		REQUIRE_EQ(blob.size, content.size());
+		CHECK(memcmp(blob.data.get(), content.data(), content.size()) == 0);
+
+		auto slice = blob.Slice(5000, 100);
+		CHECK(slice.mapped);
+		CHECK_EQ(slice.data.get(), blob.data.get() + 5000);
+
+		// Evicted pages are read again from the file
+		PrefetchBlob(slice);
+		EvictBlob(slice);
+		CHECK(memcmp(slice.data.get(), content.data() + 5000, 100) == 0);
+
+		// Mapping outlives the blob it was sliced from
+		blob = IReader::Blob();
+		CHECK_EQ(slice.data.get()[99], content[5099]);
+	}
+
+	remove(path.c_str());
+	REQUIRE_THROWS(MapFile(path));
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "IReader.h"
+#include <string>
+
+
+namespace Render
+{
+	// Maps the whole file read-only. The returned blob owns the mapping, which is released when the last blob
+	// referencing it is destroyed. Pages are loaded by the OS on first access, so only the parts that are touched
+	// take memory, and they are backed by the page cache rather than by the heap. Throws if the file can not be mapped.
+	IReader::Blob MapFile(const std::string& path);
+
+	// Hints that the blob is going to be read soon, so the OS can start reading it ahead. Does nothing for blobs that are not mapped.
+	void PrefetchBlob(const IReader::Blob& blob);
+
+	// Drops pages of the blob from the resident set of the process. The data stays valid and is read from the file again
+	// on the next access. Does nothing for blobs that are not mapped.
+	void EvictBlob(const IReader::Blob& blob);
+}
@@ -0,0 +1,363 @@
+#include "MipmapGenerator.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+	// Separable filter. For each output index there is a fixed number of taps, indices are already clamped to the edges.
+	struct Filter
+	{
+		int taps;
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	float BSpline(float x)
+	{
+		x = fabsf(x);
+		if (x < 1.0f)
+		{
+			return (4.0f + x * x * (3.0f * x - 6.0f)) / 6.0f;
+		}
+		if (x < 2.0f)
+		{
+			float t = 2.0f - x;
+			return t * t * t / 6.0f;
+		}
+		return 0.0f;
+	}
+
+	Filter MakeFilter(int in_size, int out_size, MipmapKernel kernel)
+	{
+		float scale = float(in_size) / float(out_size);
+		// Box averages the area covered by the output pixel, cubic B-spline spans two output pixels in each direction
+		float support = kernel == MipmapKernel::Box ? scale * 0.5f : scale * 2.0f;
+
+		Filter f;
+		f.taps = int(ceilf(support * 2.0f)) + 1;
+		f.indices.resize(size_t(out_size) * f.taps, 0);
+		f.weights.resize(size_t(out_size) * f.taps, 0.0f);
+
+		for (int i = 0; i < out_size; ++i)
+		{
+			// Pixel j covers [j, j + 1)
+			float center = (i + 0.5f) * scale;
+			int first = int(floorf(center - support));
+			int* indices = &f.indices[size_t(i) * f.taps];
+			float* weights = &f.weights[size_t(i) * f.taps];
+			float sum = 0.0f;
+			for (int t = 0; t < f.taps; ++t)
+			{
+				int j = first + t;
+				float w;
+				if (kernel == MipmapKernel::Box)
+				{
+					w = std::max(0.0f, std::min(j + 1.0f, center + support) - std::max(float(j), center - support));
+				}
+				else
+				{
+					w = BSpline((j + 0.5f - center) / scale);
+				}
+				indices[t] = std::min(std::max(j, 0), in_size - 1);
+				weights[t] = w;
+				sum += w;
+			}
+			for (int t = 0; t < f.taps; ++t)
+			{
+				weights[t] /= sum;
+			}
+		}
+
+		// Drop trailing taps that are zero for all outputs, e.g. for box filter with integer scale
+		int used = 1;
+		for (int i = 0; i < out_size; ++i)
+		{
+			for (int t = used; t < f.taps; ++t)
+			{
+				if (f.weights[size_t(i) * f.taps + t] != 0.0f)
+				{
+					used = t + 1;
+				}
+			}
+		}
+		if (used < f.taps)
+		{
+			for (int i = 0; i < out_size; ++i)
+			{
+				for (int t = 0; t < used; ++t)
+				{
+					f.indices[size_t(i) * used + t] = f.indices[size_t(i) * f.taps + t];
+					f.weights[size_t(i) * used + t] = f.weights[size_t(i) * f.taps + t];
+				}
+			}
+			f.taps = used;
+		}
+		return f;
+	}
+
+	// dst += src * w
+	inline void Accumulate(float* dst, const float* src, float w, int n)
+	{
+		int i = 0;
+#ifdef MIPMAP_USE_SSE
+		__m128 vw = _mm_set1_ps(w);
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128 a = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), vw));
+			__m128 b = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), vw));
+			_mm_storeu_ps(dst + i, a);
+			_mm_storeu_ps(dst + i + 4, b);
+		}
+		for (; i + 4 <= n; i += 4)
+		{
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), vw)));
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			dst[i] += src[i] * w;
+		}
+	}
+
+	template<int Channels>
+	void FilterRow(const float* src, float* dst, int out_width, const Filter& f)
+	{
+		for (int x = 0; x < out_width; ++x)
+		{
+			const int* indices = &f.indices[size_t(x) * f.taps];
+			const float* weights = &f.weights[size_t(x) * f.taps];
+			float acc[Channels] = {};
+			for (int t = 0; t < f.taps; ++t)
+			{
+				const float* p = src + indices[t] * Channels;
+				for (int c = 0; c < Channels; ++c)
+				{
+					acc[c] += p[c] * weights[t];
+				}
+			}
+			for (int c = 0; c < Channels; ++c)
+			{
+				dst[x * Channels + c] = acc[c];
+			}
+		}
+	}
+
+#ifdef MIPMAP_USE_SSE
+	template<>
+	void FilterRow<4>(const float* src, float* dst, int out_width, const Filter& f)
+	{
+		for (int x = 0; x < out_width; ++x)
+		{
+			const int* indices = &f.indices[size_t(x) * f.taps];
+			const float* weights = &f.weights[size_t(x) * f.taps];
+			__m128 acc = _mm_setzero_ps();
+			for (int t = 0; t < f.taps; ++t)
+			{
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + indices[t] * 4), _mm_set1_ps(weights[t])));
+			}
+			_mm_storeu_ps(dst + x * 4, acc);
+		}
+	}
+#endif
+
+	void FilterRow(const float* src, float* dst, int out_width, int channels, const Filter& f)
+	{
+		switch (channels)
+		{
+			case 1: FilterRow<1>(src, dst, out_width, f); break;
+			case 2: FilterRow<2>(src, dst, out_width, f); break;
+			case 3: FilterRow<3>(src, dst, out_width, f); break;
+			case 4: FilterRow<4>(src, dst, out_width, f); break;
+		}
+	}
+
+	// Converts between 8-bit gamma encoded values and linear floats
+	struct Transfer
+	{
+		Transfer(float gamma, int channels): channels(channels), decode(256), encode(EncodeSize + 1)
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				decode[i] = powf(i / 255.0f, gamma);
+			}
+			for (int i = 0; i <= EncodeSize; ++i)
+			{
+				encode[i] = uint8_t(lrintf(powf(i / float(EncodeSize), 1.0f / gamma) * 255.0f));
+			}
+		}
+
+		void Decode(const uint8_t* src, float* dst, int width, ptrdiff_t pixel_stride) const
+		{
+			if (pixel_stride == channels)
+			{
+				int n = width * channels;
+				for (int i = 0; i < n; ++i)
+				{
+					dst[i] = decode[src[i]];
+				}
+			}
+			else
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					for (int c = 0; c < channels; ++c)
+					{
+						dst[x * channels + c] = decode[src[x * pixel_stride + c]];
+					}
+				}
+			}
+			if (channels == 4)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					dst[x * 4 + 3] = src[x * pixel_stride + 3] / 255.0f;
+				}
+			}
+		}
+
+		void Encode(const float* src, uint8_t* dst, int width) const
+		{
+			int n = width * channels;
+			for (int i = 0; i < n; ++i)
+			{
+				float v = std::min(std::max(src[i], 0.0f), 1.0f);
+				dst[i] = encode[int(v * EncodeSize + 0.5f)];
+			}
+			if (channels == 4)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					float v = std::min(std::max(src[x * 4 + 3], 0.0f), 1.0f);
+					dst[x * 4 + 3] = uint8_t(v * 255.0f + 0.5f);
+				}
+			}
+		}
+
+		enum { EncodeSize = 65535 };
+		int channels;
+		std::vector<float> decode;
+		std::vector<uint8_t> encode;
+	};
+
+	// Output rows are processed in bands, each band filters horizontally only the source rows it needs
+	const int BandHeight = 16;
+
+	template<typename LoadRow>
+	void Resample(const LoadRow& load_row, int in_width, int in_height, int channels, float* dst, int out_width, int out_height,
+			MipmapKernel kernel, ThreadPool& pool)
+	{
+		Filter fx = MakeFilter(in_width, out_width, kernel);
+		Filter fy = MakeFilter(in_height, out_height, kernel);
+		int bands = (out_height + BandHeight - 1) / BandHeight;
+		size_t out_row_size = size_t(out_width) * channels;
+
+		pool.ParallelFor(0, bands, [&](int band_begin, int band_end)
+		{
+			std::vector<float> row(size_t(in_width) * channels);
+			std::vector<float> filtered;
+			for (int band = band_begin; band < band_end; ++band)
+			{
+				int y0 = band * BandHeight;
+				int y1 = std::min(out_height, y0 + BandHeight);
+				auto first = std::min_element(fy.indices.begin() + size_t(y0) * fy.taps, fy.indices.begin() + size_t(y1) * fy.taps);
+				auto last = std::max_element(fy.indices.begin() + size_t(y0) * fy.taps, fy.indices.begin() + size_t(y1) * fy.taps);
+				int row_min = *first;
+				int row_max = *last;
+
+				filtered.resize(size_t(row_max - row_min + 1) * out_row_size);
+				for (int r = row_min; r <= row_max; ++r)
+				{
+					const float* src = load_row(r, row.data());
+					FilterRow(src, &filtered[size_t(r - row_min) * out_row_size], out_width, channels, fx);
+				}
+
+				for (int y = y0; y < y1; ++y)
+				{
+					float* out = dst + size_t(y) * out_row_size;
+					memset(out, 0, out_row_size * sizeof(float));
+					const int* indices = &fy.indices[size_t(y) * fy.taps];
+					const float* weights = &fy.weights[size_t(y) * fy.taps];
+					for (int t = 0; t < fy.taps; ++t)
+					{
+						if (weights[t] != 0.0f)
+						{
+							Accumulate(out, &filtered[size_t(indices[t] - row_min) * out_row_size], weights[t], (int)out_row_size);
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+
+std::vector<glm::ivec2> GetMipmapChainSizes(int width, int height)
+{
+	std::vector<glm::ivec2> sizes;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		sizes.emplace_back(width, height);
+	}
+	return sizes;
+}
+
+void GenerateMipmaps(const uint8_t* source, int width, int height, int channels, ptrdiff_t pixel_stride, ptrdiff_t row_stride,
+		const std::vector<uint8_t*>& levels, MipmapKernel kernel, float gamma, ThreadPool* pool)
+{
+	TRACE_SCOPE("GenerateMipmaps", "loader");
+	if (pool == nullptr)
+	{
+		pool = &ThreadPool::GetDefault();
+	}
+
+	Transfer transfer(gamma, channels);
+	auto sizes = GetMipmapChainSizes(width, height);
+
+	std::vector<float> previous;
+	std::vector<float> current;
+	for (size_t i = 0; i < levels.size() && i < sizes.size(); ++i)
+	{
+		glm::ivec2 in_size = i == 0 ? glm::ivec2(width, height) : sizes[i - 1];
+		glm::ivec2 out_size = sizes[i];
+		current.resize(size_t(out_size.x) * out_size.y * channels);
+
+		if (i == 0)
+		{
+			Resample([&](int y, float* row)
+				{
+					transfer.Decode(source + y * row_stride, row, in_size.x, pixel_stride);
+					return (const float*)row;
+				}, in_size.x, in_size.y, channels, current.data(), out_size.x, out_size.y, kernel, *pool);
+		}
+		else
+		{
+			Resample([&](int y, float*)
+				{
+					return (const float*)&previous[size_t(y) * in_size.x * channels];
+				}, in_size.x, in_size.y, channels, current.data(), out_size.x, out_size.y, kernel, *pool);
+		}
+
+		uint8_t* level = levels[i];
+		pool->ParallelFor(0, out_size.y, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; ++y)
+			{
+				size_t offset = size_t(y) * out_size.x * channels;
+				transfer.Encode(&current[offset], level + offset, out_size.x);
+			}
+		}, 16);
+
+		std::swap(previous, current);
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+class ThreadPool;
+
+enum class MipmapKernel
+{
+	Box,
+	BSpline
+};
+
+// Sizes of mipmap levels that follow level 0 of size `width` x `height`, down to 1x1
+std::vector<glm::ivec2> GetMipmapChainSizes(int width, int height);
+
+// Generates mipmap levels from `source`, which has `channels` interleaved channels, pixels `pixel_stride` bytes apart
+// and rows `row_stride` bytes apart. Pixel stride may be larger than the number of channels, e.g. for a channel view.
+// Filtering is done in linear space: color channels are decoded with `gamma`, alpha (the 4th channel) is kept as is.
+// Each level is computed from the previous one without intermediate quantization.
+// `levels` point to tightly packed buffers with sizes given by GetMipmapChainSizes, the number of generated levels
+// is levels.size(), which may be less than the full chain.
+void GenerateMipmaps(const uint8_t* source, int width, int height, int channels, ptrdiff_t pixel_stride, ptrdiff_t row_stride,
+		const std::vector<uint8_t*>& levels, MipmapKernel kernel, float gamma = 2.2f, ThreadPool* pool = nullptr);
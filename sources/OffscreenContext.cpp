@@ -0,0 +1,281 @@
+#include "OffscreenContext.h"
+#include <spdlog/spdlog.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <stdint.h>
+
+// Subset of EGL 1.4 that is needed, so that EGL headers are not required
+namespace
+{
+	typedef void* EGLDisplay;
+	typedef void* EGLConfig;
+	typedef void* EGLContext;
+	typedef void* EGLSurface;
+	typedef int32_t EGLint;
+	typedef unsigned int EGLBoolean;
+	typedef unsigned int EGLenum;
+
+	enum
+	{
+		EGL_ALPHA_SIZE = 0x3021,
+		EGL_BLUE_SIZE = 0x3022,
+		EGL_GREEN_SIZE = 0x3023,
+		EGL_RED_SIZE = 0x3024,
+		EGL_DEPTH_SIZE = 0x3025,
+		EGL_STENCIL_SIZE = 0x3026,
+		EGL_SURFACE_TYPE = 0x3033,
+		EGL_NONE = 0x3038,
+		EGL_RENDERABLE_TYPE = 0x3040,
+		EGL_EXTENSIONS = 0x3055,
+		EGL_HEIGHT = 0x3056,
+		EGL_WIDTH = 0x3057,
+		EGL_OPENGL_API = 0x30A2,
+		EGL_PLATFORM_SURFACELESS_MESA = 0x31DD,
+		EGL_PBUFFER_BIT = 0x0001,
+		EGL_OPENGL_BIT = 0x0008
+	};
+
+	typedef EGLDisplay (*PFN_eglGetDisplay)(void*);
+	typedef EGLDisplay (*PFN_eglGetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+	typedef EGLBoolean (*PFN_eglInitialize)(EGLDisplay, EGLint*, EGLint*);
+	typedef EGLBoolean (*PFN_eglTerminate)(EGLDisplay);
+	typedef const char* (*PFN_eglQueryString)(EGLDisplay, EGLint);
+	typedef EGLBoolean (*PFN_eglChooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+	typedef EGLBoolean (*PFN_eglBindAPI)(EGLenum);
+	typedef EGLContext (*PFN_eglCreateContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*);
+	typedef EGLBoolean (*PFN_eglDestroyContext)(EGLDisplay, EGLContext);
+	typedef EGLSurface (*PFN_eglCreatePbufferSurface)(EGLDisplay, EGLConfig, const EGLint*);
+	typedef EGLBoolean (*PFN_eglDestroySurface)(EGLDisplay, EGLSurface);
+	typedef EGLBoolean (*PFN_eglMakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+	typedef EGLint (*PFN_eglGetError)();
+	typedef Render::OffscreenContext::Proc (*PFN_eglGetProcAddress)(const char*);
+
+	struct EGL
+	{
+		EGL()
+		{
+			handle = dlopen("libEGL.so.1", RTLD_LAZY | RTLD_LOCAL);
+			if (handle == nullptr)
+			{
+				handle = dlopen("libEGL.so", RTLD_LAZY | RTLD_LOCAL);
+			}
+			if (handle == nullptr)
+			{
+				return;
+			}
+			GetDisplay = (PFN_eglGetDisplay)dlsym(handle, "eglGetDisplay");
+			Initialize = (PFN_eglInitialize)dlsym(handle, "eglInitialize");
+			Terminate = (PFN_eglTerminate)dlsym(handle, "eglTerminate");
+			QueryString = (PFN_eglQueryString)dlsym(handle, "eglQueryString");
+			ChooseConfig = (PFN_eglChooseConfig)dlsym(handle, "eglChooseConfig");
+			BindAPI = (PFN_eglBindAPI)dlsym(handle, "eglBindAPI");
+			CreateContext = (PFN_eglCreateContext)dlsym(handle, "eglCreateContext");
+			DestroyContext = (PFN_eglDestroyContext)dlsym(handle, "eglDestroyContext");
+			CreatePbufferSurface = (PFN_eglCreatePbufferSurface)dlsym(handle, "eglCreatePbufferSurface");
+			DestroySurface = (PFN_eglDestroySurface)dlsym(handle, "eglDestroySurface");
+			MakeCurrent = (PFN_eglMakeCurrent)dlsym(handle, "eglMakeCurrent");
+			GetError = (PFN_eglGetError)dlsym(handle, "eglGetError");
+			GetProcAddress = (PFN_eglGetProcAddress)dlsym(handle, "eglGetProcAddress");
+			if (GetProcAddress != nullptr)
+			{
+				GetPlatformDisplayEXT = (PFN_eglGetPlatformDisplayEXT)GetProcAddress("eglGetPlatformDisplayEXT");
+			}
+		}
+
+		bool IsLoaded() const
+		{
+			return handle != nullptr && GetDisplay && Initialize && Terminate && QueryString && ChooseConfig && BindAPI
+				&& CreateContext && DestroyContext && CreatePbufferSurface && DestroySurface && MakeCurrent && GetError && GetProcAddress;
+		}
+
+		void* handle = nullptr;
+		PFN_eglGetDisplay GetDisplay = nullptr;
+		PFN_eglGetPlatformDisplayEXT GetPlatformDisplayEXT = nullptr;
+		PFN_eglInitialize Initialize = nullptr;
+		PFN_eglTerminate Terminate = nullptr;
+		PFN_eglQueryString QueryString = nullptr;
+		PFN_eglChooseConfig ChooseConfig = nullptr;
+		PFN_eglBindAPI BindAPI = nullptr;
+		PFN_eglCreateContext CreateContext = nullptr;
+		PFN_eglDestroyContext DestroyContext = nullptr;
+		PFN_eglCreatePbufferSurface CreatePbufferSurface = nullptr;
+		PFN_eglDestroySurface DestroySurface = nullptr;
+		PFN_eglMakeCurrent MakeCurrent = nullptr;
+		PFN_eglGetError GetError = nullptr;
+		PFN_eglGetProcAddress GetProcAddress = nullptr;
+	};
+
+	// Library stays loaded until the process exits
+	const EGL& GetEGL()
+	{
+		static const EGL egl;
+		return egl;
+	}
+
+	bool HasExtension(const char* extensions, const char* name)
+	{
+		if (extensions == nullptr)
+		{
+			return false;
+		}
+		size_t length = strlen(name);
+		for (const char* p = strstr(extensions, name); p != nullptr; p = strstr(p + length, name))
+		{
+			if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// eglTerminate is not reference counted, display is shared by all contexts, so it is terminated with the last one
+	int contextCount = 0;
+}
+
+
+namespace Render
+{
+	std::unique_ptr<OffscreenContext> OffscreenContext::Create(const OffscreenContext* share)
+	{
+		const EGL& egl = GetEGL();
+		if (!egl.IsLoaded())
+		{
+			spdlog::warn("Could not load libEGL");
+			return nullptr;
+		}
+
+		EGLDisplay display = nullptr;
+		// Client extensions, fails on EGL 1.4 without EGL_EXT_client_extensions
+		const char* client_extensions = egl.QueryString(nullptr, EGL_EXTENSIONS);
+		if (egl.GetPlatformDisplayEXT != nullptr && HasExtension(client_extensions, "EGL_MESA_platform_surfaceless"))
+		{
+			display = egl.GetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+		}
+		if (display == nullptr)
+		{
+			display = egl.GetDisplay(nullptr);
+		}
+		EGLint major = 0, minor = 0;
+		if (display == nullptr || !egl.Initialize(display, &major, &minor))
+		{
+			spdlog::warn("Could not initialize EGL display, error 0x{:x}", egl.GetError());
+			return nullptr;
+		}
+
+		bool surfaceless = HasExtension(egl.QueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+		const EGLint config_attributes[] = {
+			EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8,
+			EGL_GREEN_SIZE, 8,
+			EGL_BLUE_SIZE, 8,
+			EGL_ALPHA_SIZE, 8,
+			EGL_NONE
+		};
+		EGLConfig config = nullptr;
+		EGLint count = 0;
+		if (!egl.ChooseConfig(display, config_attributes, &config, 1, &count) || count == 0 || !egl.BindAPI(EGL_OPENGL_API))
+		{
+			spdlog::warn("EGL {}.{} has no suitable config for desktop OpenGL", major, minor);
+			if (contextCount == 0)
+			{
+				egl.Terminate(display);
+			}
+			return nullptr;
+		}
+
+		// No version is requested, the highest compatibility profile version is created, as for the windowed GL 3.0 context.
+		// Versioned requests for desktop GL need EGL_KHR_create_context
+		const EGLint context_attributes[] = {
+			EGL_NONE
+		};
+		std::unique_ptr<OffscreenContext> context(new OffscreenContext);
+		context->m_display = display;
+		++contextCount;
+		context->m_context = egl.CreateContext(display, config, share != nullptr ? share->m_context : nullptr, context_attributes);
+		if (context->m_context == nullptr)
+		{
+			spdlog::warn("Could not create EGL context, error 0x{:x}", egl.GetError());
+			return nullptr;
+		}
+		if (!surfaceless)
+		{
+			const EGLint pbuffer_attributes[] = {
+				EGL_WIDTH, 1,
+				EGL_HEIGHT, 1,
+				EGL_NONE
+			};
+			context->m_surface = egl.CreatePbufferSurface(display, config, pbuffer_attributes);
+			if (context->m_surface == nullptr)
+			{
+				spdlog::warn("Could not create EGL pbuffer, error 0x{:x}", egl.GetError());
+				return nullptr;
+			}
+		}
+		if (!context->MakeCurrent())
+		{
+			spdlog::warn("Could not make EGL context current, error 0x{:x}", egl.GetError());
+			return nullptr;
+		}
+		spdlog::info("Created offscreen EGL {}.{} context{}", major, minor, surfaceless ? ", surfaceless" : "");
+		return context;
+	}
+
+	OffscreenContext::~OffscreenContext()
+	{
+		const EGL& egl = GetEGL();
+		egl.MakeCurrent(m_display, nullptr, nullptr, nullptr);
+		if (m_surface != nullptr)
+		{
+			egl.DestroySurface(m_display, m_surface);
+		}
+		if (m_context != nullptr)
+		{
+			egl.DestroyContext(m_display, m_context);
+		}
+		if (--contextCount == 0)
+		{
+			egl.Terminate(m_display);
+		}
+	}
+
+	bool OffscreenContext::MakeCurrent()
+	{
+		return GetEGL().MakeCurrent(m_display, m_surface, m_surface, m_context) != 0;
+	}
+
+	OffscreenContext::Proc OffscreenContext::GetProcAddress(const char* name)
+	{
+		return GetEGL().GetProcAddress(name);
+	}
+}
+
+#else
+
+namespace Render
+{
+	std::unique_ptr<OffscreenContext> OffscreenContext::Create(const OffscreenContext*)
+	{
+		spdlog::warn("EGL offscreen contexts are supported on Linux only");
+		return nullptr;
+	}
+
+	OffscreenContext::~OffscreenContext()
+	{
+	}
+
+	bool OffscreenContext::MakeCurrent()
+	{
+		return false;
+	}
+
+	OffscreenContext::Proc OffscreenContext::GetProcAddress(const char*)
+	{
+		return nullptr;
+	}
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+
+
+namespace Render
+{
+	// OpenGL context without a window, for rendering on machines without a display, e.g. with llvmpipe on CPU-only servers.
+	// Created with EGL, on the surfaceless platform if EGL_MESA_platform_surfaceless is available, otherwise on the default
+	// display. Without EGL_KHR_surfaceless_context, a 1x1 pbuffer is made current, so rendering has to go to a framebuffer
+	// object anyway. libEGL is loaded at runtime, so that the module does not depend on it. Available on Linux only.
+	class OffscreenContext
+	{
+		OffscreenContext(const OffscreenContext&) = delete; // non construction-copyable
+		OffscreenContext& operator=(const OffscreenContext&) = delete; // non copyable
+	public:
+		typedef void (*Proc)();
+
+		// Returns null if EGL is not available or a context could not be created. The reason is logged.
+		// If `share` is given, GL objects are shared with it
+		static std::unique_ptr<OffscreenContext> Create(const OffscreenContext* share = nullptr);
+
+		~OffscreenContext();
+
+		bool MakeCurrent();
+
+		// Loader of GL functions, for gl3wInit2
+		static Proc GetProcAddress(const char* name);
+
+		bool IsSurfaceless() const
+		{
+			return m_surface == nullptr;
+		}
+
+	private:
+		OffscreenContext() = default;
+
+		void* m_display = nullptr;
+		void* m_context = nullptr;
+		void* m_surface = nullptr;
+	};
+}
@@ -0,0 +1,62 @@
+#include "PixelPackBuffer.h"
+#include <GL/gl3w.h>
+
+using namespace Render;
+
+
+PixelPackBuffer::PixelPackBuffer(): m_current(0)
+{
+	for (int i = 0; i < RingSize; ++i)
+	{
+		m_handles[i] = uint32_t(-1);
+		m_sizes[i] = 0;
+	}
+}
+
+PixelPackBuffer::~PixelPackBuffer()
+{
+	for (int i = 0; i < RingSize; ++i)
+	{
+		if (m_handles[i] != uint32_t(-1))
+		{
+			glDeleteBuffers(1, &m_handles[i]);
+			m_handles[i] = uint32_t(-1);
+		}
+	}
+}
+
+int PixelPackBuffer::Read(int width, int height)
+{
+	m_current = (m_current + 1) % RingSize;
+	if (m_handles[m_current] == uint32_t(-1))
+	{
+		glGenBuffers(1, &m_handles[m_current]);
+	}
+	size_t size = size_t(width) * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_handles[m_current]);
+	if (m_sizes[m_current] != size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		m_sizes[m_current] = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return m_current;
+}
+
+const uint8_t* PixelPackBuffer::Map(int index)
+{
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_handles[index]);
+	auto* ptr = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_sizes[index], GL_MAP_READ_BIT);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return ptr;
+}
+
+bool PixelPackBuffer::UnMap(int index)
+{
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_handles[index]);
+	bool result = glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Render
+{
+	// Ring of pixel pack buffers used for asynchronous readback.
+	// glReadPixels into a bound pack buffer returns right away, and the transfer is done by the driver, while the next
+	// frames are rendered. The buffer is mapped a few frames later, when the data is most likely already there.
+	class PixelPackBuffer
+	{
+		PixelPackBuffer(const PixelPackBuffer&) = delete; // non construction-copyable
+		PixelPackBuffer& operator=(const PixelPackBuffer&) = delete; // non copyable
+	public:
+		enum
+		{
+			RingSize = 3
+		};
+
+		PixelPackBuffer();
+		~PixelPackBuffer();
+
+		// Starts reading RGBA pixels of the bound read framebuffer into the next buffer in the ring and returns its index.
+		// Pending read into that buffer, if any, is discarded, so it should be mapped before the ring wraps around.
+		int Read(int width, int height);
+
+		// Maps buffer `index` for reading, blocks until the transfer is done. Rows go from bottom to top, without padding.
+		// Returns nullptr if mapping failed.
+		const uint8_t* Map(int index);
+
+		// Returns false if the content of the buffer was lost while it was mapped
+		bool UnMap(int index);
+
+	private:
+		uint32_t m_handles[RingSize];
+		size_t m_sizes[RingSize];
+		int m_current;
+	};
+}
@@ -0,0 +1,55 @@
+#include "PixelUnpackBuffer.h"
+#include <GL/gl3w.h>
+
+using namespace Render;
+
+
+PixelUnpackBuffer::PixelUnpackBuffer(): m_current(0)
+{
+	for (int i = 0; i < RingSize; ++i)
+	{
+		m_handles[i] = uint32_t(-1);
+	}
+}
+
+PixelUnpackBuffer::~PixelUnpackBuffer()
+{
+	for (int i = 0; i < RingSize; ++i)
+	{
+		if (m_handles[i] != uint32_t(-1))
+		{
+			glDeleteBuffers(1, &m_handles[i]);
+			m_handles[i] = uint32_t(-1);
+		}
+	}
+}
+
+uint8_t* PixelUnpackBuffer::Map(size_t size)
+{
+	m_current = (m_current + 1) % RingSize;
+	if (m_handles[m_current] == uint32_t(-1))
+	{
+		glGenBuffers(1, &m_handles[m_current]);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_handles[m_current]);
+
+	// Orphaning. If the driver still reads from the previous storage of this buffer, it will get a new one,
+	// instead of making us wait.
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	auto* ptr = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (ptr == nullptr)
+	{
+		UnBind();
+	}
+	return ptr;
+}
+
+bool PixelUnpackBuffer::UnMap()
+{
+	return glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+}
+
+void PixelUnpackBuffer::UnBind()
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
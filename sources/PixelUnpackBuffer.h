@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace Render
+{
+	// Ring of pixel unpack buffers used for asynchronous texture uploads.
+	// Pixel data is written into a mapped buffer, after that glTexImage2D is called with offsets into that buffer,
+	// so the driver can do the transfer in background without stalling the calling thread.
+	class PixelUnpackBuffer
+	{
+		PixelUnpackBuffer(const PixelUnpackBuffer&) = delete; // non construction-copyable
+		PixelUnpackBuffer& operator=(const PixelUnpackBuffer&) = delete; // non copyable
+	public:
+		enum
+		{
+			RingSize = 2
+		};
+
+		PixelUnpackBuffer();
+		~PixelUnpackBuffer();
+
+		// Binds the next buffer in the ring to GL_PIXEL_UNPACK_BUFFER, reallocates it to hold `size` bytes and maps it.
+		// Returns nullptr if mapping failed, in that case buffer is unbound.
+		uint8_t* Map(size_t size);
+
+		// Unmaps the buffer, but keeps it bound, so that it can be used as a source for glTexImage2D.
+		// Returns false if the content of the buffer was lost.
+		bool UnMap();
+
+		static void UnBind();
+
+	private:
+		uint32_t m_handles[RingSize];
+		int m_current;
+	};
+}
@@ -0,0 +1,107 @@
+#include "PointGrid.h"
+#include <math.h>
+
+
+void PointGrid::Clear()
+{
+	for (auto& cells: m_levels)
+	{
+		cells.clear();
+	}
+	m_count = 0;
+	++m_version;
+}
+
+int PointGrid::GetLevel(float size)
+{
+	if (!(size > 1.0f))
+	{
+		return 0;
+	}
+	int level = int(ceilf(log2f(size)));
+	return level < LevelCount ? level : LevelCount - 1;
+}
+
+glm::ivec4 PointGrid::GetCellRange(int level, glm::aabb2 rect)
+{
+	float size = ldexpf(1.0f, level);
+	glm::vec2 min = glm::floor(rect.minp / size);
+	glm::vec2 max = glm::floor(rect.maxp / size);
+	// Keeps indices representable, when the rectangle is far away or huge
+	min = glm::clamp(min, glm::vec2(-1e9f), glm::vec2(1e9f));
+	max = glm::clamp(max, glm::vec2(-1e9f), glm::vec2(1e9f));
+	return glm::ivec4(min.x, min.y, max.x, max.y);
+}
+
+void PointGrid::Update(glm::vec2 pos, glm::vec4 color, float radius, int sign)
+{
+	for (int level = 0; level < LevelCount; ++level)
+	{
+		float size = ldexpf(1.0f, level);
+		glm::ivec2 cell = glm::ivec2(glm::floor(pos / size));
+		auto key = GetKey(cell);
+		Cell& c = m_levels[level][key];
+		c.count += sign;
+		if (c.count == 0)
+		{
+			m_levels[level].erase(key);
+			continue;
+		}
+		c.pos += glm::dvec2(pos) * double(sign);
+		c.color += glm::dvec4(color) * double(sign);
+		c.radius += double(radius) * sign;
+	}
+	m_count += sign;
+	++m_version;
+}
+
+
+#include <doctest.h>
+
+TEST_CASE("[PointGrid] Incremental clusters")
+{
+	PointGrid grid;
+	glm::vec4 red(255.0f, 0.0f, 0.0f, 255.0f);
+	glm::vec4 blue(0.0f, 0.0f, 255.0f, 255.0f);
+	grid.Add(glm::vec2(1.0f, 1.0f), red, 4.0f);
+	grid.Add(glm::vec2(3.0f, 1.0f), blue, 6.0f);
+	grid.Add(glm::vec2(-5.0f, 1.0f), red, 4.0f);
+	CHECK_EQ(grid.GetCount(), 3);
+
+	CHECK_EQ(PointGrid::GetLevel(0.5f), 0);
+	CHECK_EQ(PointGrid::GetLevel(4.0f), 2);
+	CHECK_EQ(PointGrid::GetLevel(5.0f), 3);
+
+	auto count_cells = [&](int level, glm::aabb2 rect)
+	{
+		int cells = 0;
+		int points = 0;
+		grid.ForEach(level, PointGrid::GetCellRange(level, rect), [&](const PointGrid::Cell& c)
+		{
+			cells += 1;
+			points += c.count;
+		});
+		return glm::ivec2(cells, points);
+	};
+
+	auto all = glm::aabb2(glm::vec2(-100.0f), glm::vec2(100.0f));
+	CHECK_EQ(count_cells(0, all), glm::ivec2(3, 3));
+	CHECK_EQ(count_cells(2, all), glm::ivec2(2, 3));
+	CHECK_EQ(count_cells(3, all), glm::ivec2(2, 3));
+	CHECK_EQ(count_cells(2, glm::aabb2(glm::vec2(0.0f), glm::vec2(2.0f))), glm::ivec2(1, 2));
+
+	// Cluster is the mean of its points
+	grid.ForEach(2, PointGrid::GetCellRange(2, glm::aabb2(glm::vec2(0.0f), glm::vec2(2.0f))), [&](const PointGrid::Cell& c)
+	{
+		CHECK_EQ(c.GetPos(), glm::vec2(2.0f, 1.0f));
+		CHECK_EQ(c.GetRadius(), 5.0f);
+		CHECK_EQ(c.GetColor(), glm::vec4(127.5f, 0.0f, 127.5f, 255.0f));
+	});
+
+	auto version = grid.GetVersion();
+	grid.Remove(glm::vec2(3.0f, 1.0f), blue, 6.0f);
+	CHECK_GT(grid.GetVersion(), version);
+	CHECK_EQ(count_cells(2, all), glm::ivec2(2, 2));
+	grid.Clear();
+	CHECK_EQ(count_cells(PointGrid::LevelCount - 1, all), glm::ivec2(0, 0));
+}
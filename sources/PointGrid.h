@@ -0,0 +1,110 @@
+#pragma once
+#include "aabb.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <unordered_map>
+
+
+// Multi-resolution grid of points, used for level of detail. Level k has square cells of 2^k image pixels. A cell keeps
+// the number of points in it and sums of their positions, colors and radii, so that it can be drawn as one cluster
+// without visiting the points. Adding or removing a point updates one cell on each level, and enumerating cells of a
+// rectangle costs at most the number of cells it covers, regardless of the number of points.
+class PointGrid
+{
+public:
+	enum
+	{
+		LevelCount = 20
+	};
+
+	struct Cell
+	{
+		uint32_t count = 0;
+		glm::dvec2 pos = glm::dvec2(0.0);
+		glm::dvec4 color = glm::dvec4(0.0);
+		double radius = 0.0;
+
+		// Means of the points in the cell
+		glm::vec2 GetPos() const { return glm::vec2(pos / double(count)); }
+		glm::vec4 GetColor() const { return glm::vec4(color / double(count)); }
+		float GetRadius() const { return float(radius / count); }
+	};
+
+	void Add(glm::vec2 pos, glm::vec4 color, float radius)
+	{
+		Update(pos, color, radius, 1);
+	}
+
+	// Point has to be removed with the same values it was added with
+	void Remove(glm::vec2 pos, glm::vec4 color, float radius)
+	{
+		Update(pos, color, radius, -1);
+	}
+
+	void Clear();
+
+	size_t GetCount() const
+	{
+		return m_count;
+	}
+
+	// Incremented on every change
+	uint64_t GetVersion() const
+	{
+		return m_version;
+	}
+
+	// Smallest level which has cells not smaller than `size` image pixels
+	static int GetLevel(float size);
+
+	// Range of cells of `level` that intersect `rect`, as min and max cell indices
+	static glm::ivec4 GetCellRange(int level, glm::aabb2 rect);
+
+	// Calls `f(const Cell&)` for each non-empty cell of `level` within the range returned by GetCellRange
+	template<typename F>
+	void ForEach(int level, glm::ivec4 range, F f) const
+	{
+		const auto& cells = m_levels[level];
+		double area = double(range.z - range.x + 1) * double(range.w - range.y + 1);
+		if (area > double(cells.size()))
+		{
+			for (const auto& it: cells)
+			{
+				glm::ivec2 c = GetCell(it.first);
+				if (c.x >= range.x && c.x <= range.z && c.y >= range.y && c.y <= range.w)
+				{
+					f(it.second);
+				}
+			}
+			return;
+		}
+		for (int y = range.y; y <= range.w; ++y)
+		{
+			for (int x = range.x; x <= range.z; ++x)
+			{
+				auto it = cells.find(GetKey(glm::ivec2(x, y)));
+				if (it != cells.end())
+				{
+					f(it->second);
+				}
+			}
+		}
+	}
+
+private:
+	void Update(glm::vec2 pos, glm::vec4 color, float radius, int sign);
+
+	static uint64_t GetKey(glm::ivec2 cell)
+	{
+		return (uint64_t(uint32_t(cell.x)) << 32u) | uint64_t(uint32_t(cell.y));
+	}
+
+	static glm::ivec2 GetCell(uint64_t key)
+	{
+		return glm::ivec2(int32_t(uint32_t(key >> 32u)), int32_t(uint32_t(key)));
+	}
+
+	std::unordered_map<uint64_t, Cell> m_levels[LevelCount];
+	size_t m_count = 0;
+	uint64_t m_version = 0;
+};
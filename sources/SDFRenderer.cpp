@@ -0,0 +1,370 @@
+#include "SDFRenderer.h"
+#include "GLDebugMessage.h"
+#include "Vector/nanovg.h"
+#include <GL/gl3w.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+
+namespace Render
+{
+	void DrawPointPath(NVGcontext* vg, glm::vec2 pos, glm::vec<4, uint8_t> color, float radius)
+	{
+		nvgBeginPath(vg);
+		nvgCircle(vg, pos.x, pos.y, radius);
+		nvgFillColor(vg, nvgRGBA(color.r, color.g, color.b, color.a));
+		nvgFill(vg);
+		nvgBeginPath(vg);
+
+		nvgCircle(vg, pos.x, pos.y, radius * 6);
+		nvgCircle(vg, pos.x, pos.y, radius);
+		nvgPathWinding(vg, NVG_HOLE);
+		NVGpaint shadowPaint = nvgBoxGradient(
+				vg, pos.x - radius, pos.y - radius, radius * 2, radius * 2, radius,
+				radius * 0.3,
+				{0, 0, 0, 1.0f}, {0, 0, 0, 0});
+		nvgFillPaint(vg, shadowPaint);
+		nvgFill(vg);
+	}
+
+	void DrawBoxPath(NVGcontext* vg, glm::aabb2 box, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill)
+	{
+		nvgBeginPath(vg);
+		nvgRect(vg, box);
+		nvgFillColor(vg, nvgRGBA(fill.r, fill.g, fill.b, fill.a));
+		nvgFill(vg);
+
+		nvgBeginPath(vg);
+		nvgRect(vg, box);
+		nvgStrokeColor(vg, nvgRGBA(stroke.r, stroke.g, stroke.b, stroke.a));
+		nvgStroke(vg);
+	}
+
+	SDFRenderer::~SDFRenderer()
+	{
+		if (m_buffer != 0)
+		{
+			glDeleteBuffers(1, &m_quad);
+			glDeleteBuffers(1, &m_buffer);
+		}
+	}
+
+	bool SDFRenderer::IsSupported()
+	{
+		bool core = gl3wIsSupported(3, 3);
+		bool extensions = CheckExtension("GL_ARB_instanced_arrays") && CheckExtension("GL_ARB_draw_instanced");
+		return (core || extensions) && glVertexAttribDivisor != nullptr && glDrawArraysInstanced != nullptr;
+	}
+
+	bool SDFRenderer::Init()
+	{
+		if (!IsSupported())
+		{
+			spdlog::warn("Instanced rendering is not supported, points and boxes are drawn with nanovg");
+			return false;
+		}
+
+		const char* vertex_shader_src = R"(
+			uniform vec2 u_viewport;
+
+			attribute vec2 a_corner;
+			attribute vec2 i_center;
+			attribute vec2 i_halfSize;
+			attribute vec4 i_params;
+			attribute vec4 i_fill;
+			attribute vec4 i_stroke;
+
+			varying vec2 v_local;
+			varying vec2 v_halfSize;
+			varying vec4 v_params;
+			varying vec4 v_fill;
+			varying vec4 v_stroke;
+
+			void main()
+			{
+				// Quad covers the shape, stroke, shadow and one pixel of antialiasing
+				vec2 extent = i_halfSize + vec2(max(i_params.w, i_params.y * 0.5 + 0.5) + 1.0);
+				v_local = a_corner * extent;
+				v_halfSize = i_halfSize;
+				v_params = i_params;
+				v_fill = i_fill;
+				v_stroke = i_stroke;
+				vec2 p = i_center + v_local;
+				gl_Position = vec4(p / u_viewport * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+			}
+		)";
+
+		const char* fragment_shader_src = R"(
+			varying vec2 v_local;
+			varying vec2 v_halfSize;
+			varying vec4 v_params;
+			varying vec4 v_fill;
+			varying vec4 v_stroke;
+
+			float random(vec2 st)
+			{
+				return fract(sin(dot(st.xy, vec2(12.9898, 78.233))) * 43758.5453123);
+			}
+
+			// Signed distance to the border, negative inside. Rectangles without rounding have mitered corners, as nanovg strokes
+			float sdroundrect(vec2 pt, vec2 ext, float rad)
+			{
+				if (rad <= 0.0)
+				{
+					vec2 d = abs(pt) - ext;
+					return max(d.x, d.y);
+				}
+				vec2 ext2 = ext - vec2(rad, rad);
+				vec2 d = abs(pt) - ext2;
+				return min(max(d.x, d.y), 0.0) + length(max(d, 0.0)) - rad;
+			}
+
+			// Same as nanovg: premultiplied alpha, colors are converted to linear space, since GL_FRAMEBUFFER_SRGB is enabled
+			vec4 premultiply(vec4 c)
+			{
+				return vec4(pow(c.rgb * c.a, vec3(2.2)), c.a);
+			}
+
+			void main()
+			{
+				float d = sdroundrect(v_local, v_halfSize, v_params.x);
+
+				// Coverage of one pixel wide fringe centered on the border, the same as nanovg geometry antialiasing
+				float fill = clamp(0.5 - d, 0.0, 1.0);
+				vec4 color = premultiply(v_fill) * fill;
+				float coverage = fill;
+
+				if (v_params.w > 0.0)
+				{
+					// Shadow is drawn over the shape, as a ring with a hole, and has the falloff of nanovg box gradient
+					float ring = clamp(0.5 + d, 0.0, 1.0) * clamp(0.5 - (d - v_params.w), 0.0, 1.0);
+					float alpha = d > 0.0 ? atan(v_params.z / d) / 3.14 * ring : 0.0;
+					color = vec4(0.0, 0.0, 0.0, alpha) + color * (1.0 - alpha);
+					coverage = max(coverage, ring);
+				}
+
+				if (v_params.y > 0.0)
+				{
+					// Pyramid profile with 1px slopes, as nanovg stroke
+					float stroke = clamp(v_params.y * 0.5 + 0.5 - abs(d), 0.0, 1.0);
+					vec4 s = premultiply(v_stroke) * stroke;
+					color = s + color * (1.0 - s.a);
+					coverage = max(coverage, stroke);
+				}
+
+				if (coverage <= 0.0)
+					discard;
+
+				// Dithering, as in nanovg
+				vec2 p = gl_FragCoord.xy;
+				gl_FragColor = color + vec4(vec3(random(p) - 0.5) / 255.0, (random(p * 100.0) - 0.5) / 255.0 * 20.0) * coverage;
+			}
+		)";
+
+		m_program = MakeProgram(vertex_shader_src, fragment_shader_src);
+		u_viewport = m_program->GetUniform("u_viewport");
+
+		m_quadSpec = VertexSpecMaker()
+				.PushType<glm::vec2>("a_corner");
+		m_quadSpec.CollectHandles(m_program);
+
+		m_instanceSpec = VertexSpecMaker()
+				.PushType<glm::vec2>("i_center")
+				.PushType<glm::vec2>("i_halfSize")
+				.PushType<glm::vec4>("i_params")
+				.PushType<glm::vec<4, uint8_t> >("i_fill", true)
+				.PushType<glm::vec<4, uint8_t> >("i_stroke", true);
+		m_instanceSpec.CollectHandles(m_program);
+
+		glm::vec2 corners[] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {-1.0f, 1.0f}, {1.0f, 1.0f}};
+		glGenBuffers(1, &m_quad);
+		glBindBuffer(GL_ARRAY_BUFFER, m_quad);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &m_buffer);
+		return true;
+	}
+
+	void SDFRenderer::AddPoint(glm::vec2 pos, glm::vec<4, uint8_t> color, float radius)
+	{
+		Instance instance;
+		instance.center = pos;
+		instance.half_size = glm::vec2(radius);
+		// Feather is clamped the same way as in nvgBoxGradient
+		instance.params = glm::vec4(radius, 0.0f, std::max(1.0f, radius * 0.3f), radius * 5.0f);
+		instance.fill = color;
+		instance.stroke = glm::vec<4, uint8_t>(0);
+		m_instances.push_back(instance);
+	}
+
+	void SDFRenderer::AddBox(glm::aabb2 box, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill)
+	{
+		Instance instance;
+		instance.center = box.center();
+		instance.half_size = glm::abs(box.size()) / 2.0f;
+		instance.params = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+		instance.fill = fill;
+		instance.stroke = stroke;
+		m_instances.push_back(instance);
+	}
+
+	void SDFRenderer::Draw(int display_w, int display_h)
+	{
+		if (m_instances.empty())
+		{
+			return;
+		}
+
+		GLboolean blend = glIsEnabled(GL_BLEND);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+		m_program->Use();
+		u_viewport.ApplyValue(glm::vec2(display_w, display_h));
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_quad);
+		m_quadSpec.Enable();
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(Instance), m_instances.data(), GL_STREAM_DRAW);
+		m_instanceSpec.Enable();
+		for (int i = 0; m_instanceSpec.m_attributes[i].components != 0; ++i)
+		{
+			if (m_instanceSpec.m_attributes[i].handle != uint32_t(-1))
+			{
+				glVertexAttribDivisor(m_instanceSpec.m_attributes[i].handle, 1);
+			}
+		}
+
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)m_instances.size());
+
+		// Divisor is a state of the attribute index, not of the program, other renderers use the same indices
+		for (int i = 0; m_instanceSpec.m_attributes[i].components != 0; ++i)
+		{
+			if (m_instanceSpec.m_attributes[i].handle != uint32_t(-1))
+			{
+				glVertexAttribDivisor(m_instanceSpec.m_attributes[i].handle, 0);
+			}
+		}
+		m_instanceSpec.Disable();
+		m_quadSpec.Disable();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (!blend)
+		{
+			glDisable(GL_BLEND);
+		}
+		m_instances.clear();
+	}
+}
+
+
+#include <doctest.h>
+#include "Vector/nanovg_backend.h"
+
+namespace
+{
+	// Renders `draw` into an sRGB framebuffer over a gray background and reads it back
+	template<typename F>
+	std::vector<uint8_t> RenderToPixels(int size, F draw)
+	{
+		GLuint fbo, color, stencil;
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glGenTextures(1, &color);
+		glBindTexture(GL_TEXTURE_2D, color);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+		glGenRenderbuffers(1, &stencil);
+		glBindRenderbuffer(GL_RENDERBUFFER, stencil);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size, size);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencil);
+		CHECK_EQ(glCheckFramebufferStatus(GL_FRAMEBUFFER), GL_FRAMEBUFFER_COMPLETE);
+
+		glEnable(GL_FRAMEBUFFER_SRGB);
+		glViewport(0, 0, size, size);
+		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		draw();
+
+		std::vector<uint8_t> pixels(size * size * 4);
+		glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteRenderbuffers(1, &stencil);
+		glDeleteTextures(1, &color);
+		glDeleteFramebuffers(1, &fbo);
+		return pixels;
+	}
+}
+
+TEST_CASE("[Render] SDFRenderer")
+{
+	using namespace Render;
+	if (!SDFRenderer::IsSupported())
+	{
+		spdlog::warn("Instanced rendering is not supported, skipping");
+		return;
+	}
+	const int size = 128;
+	glm::vec<4, uint8_t> red(220, 40, 30, 255);
+	glm::vec<4, uint8_t> green(30, 200, 60, 255);
+	glm::vec<4, uint8_t> fill(60, 90, 200, 80);
+	glm::aabb2 box(glm::vec2(70.3f, 12.6f), glm::vec2(118.7f, 60.2f));
+
+	auto reference = RenderToPixels(size, [&]()
+	{
+		NVGcontext* vg = nvgCreateContext(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+		nvgBeginFrame(vg, size, size, 1.0f);
+		DrawPointPath(vg, glm::vec2(32.5f, 40.2f), red, 5.0f);
+		DrawPointPath(vg, glm::vec2(40.0f, 90.0f), red, 2.5f);
+		DrawBoxPath(vg, box, green, fill);
+		nvgEndFrame(vg);
+		nvgDeleteContext(vg);
+	});
+
+	SDFRenderer sdf;
+	REQUIRE(sdf.Init());
+	auto result = RenderToPixels(size, [&]()
+	{
+		sdf.AddPoint(glm::vec2(32.5f, 40.2f), red, 5.0f);
+		sdf.AddPoint(glm::vec2(40.0f, 90.0f), red, 2.5f);
+		sdf.AddBox(box, green, fill);
+		sdf.Draw(size, size);
+		CHECK_EQ(sdf.GetCount(), 0);
+	});
+
+	// Both have dithering and tessellate differently, so small differences are allowed. Each shape is compared inside
+	// of its own rectangle, so that the background does not dilute the mean. Antialiased edges differ the most
+	auto compare = [&](const char* name, glm::vec2 min, glm::vec2 max)
+	{
+		// Rows of glReadPixels go bottom up
+		int x0 = std::max(0, int(floorf(min.x)));
+		int x1 = std::min(size, int(ceilf(max.x)));
+		int y0 = std::max(0, size - int(ceilf(max.y)));
+		int y1 = std::min(size, size - int(floorf(min.y)));
+		int sum = 0;
+		int max_diff = 0;
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int i = x0 * 4; i < x1 * 4; ++i)
+			{
+				int diff = abs(int(reference[y * size * 4 + i]) - int(result[y * size * 4 + i]));
+				sum += diff;
+				max_diff = std::max(max_diff, diff);
+			}
+		}
+		float mean = float(sum) / ((x1 - x0) * (y1 - y0) * 4);
+		spdlog::info("SDFRenderer pixel diff of {}: mean {}, max {}", name, mean, max_diff);
+		CHECK_LT(mean, 2.0f);
+		CHECK_LT(max_diff, 64);
+	};
+	// Shadow of a point extends to 6 radii, stroke of a box is one pixel wide
+	compare("point", glm::vec2(32.5f, 40.2f) - 30.0f, glm::vec2(32.5f, 40.2f) + 30.0f);
+	compare("small point", glm::vec2(40.0f, 90.0f) - 15.0f, glm::vec2(40.0f, 90.0f) + 15.0f);
+	compare("box", box.minp - 1.0f, box.maxp + 1.0f);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "Shader.h"
+#include "VertexSpec.h"
+#include "aabb.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+struct NVGcontext;
+
+
+namespace Render
+{
+	// Vector versions of point and box, built as nanovg paths. This is the reference look for SDFRenderer.
+	// Positions are in framebuffer pixels. Point has a soft shadow that extends to 6x of its radius.
+	void DrawPointPath(NVGcontext* vg, glm::vec2 pos, glm::vec<4, uint8_t> color, float radius);
+	void DrawBoxPath(NVGcontext* vg, glm::aabb2 box, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill);
+
+	// Draws circles, rings, rectangles and their shadows analytically in the fragment shader, using signed distance
+	// to a rounded rectangle. Each shape is one instance of a quad that covers the shape and its shadow, all shapes
+	// queued in a frame are drawn with a single instanced draw call, in the order they were added.
+	// Colors are blended the same way nanovg does, so that it matches DrawPointPath and DrawBoxPath.
+	class SDFRenderer
+	{
+	public:
+		struct Instance
+		{
+			// Framebuffer pixels
+			glm::vec2 center;
+			glm::vec2 half_size;
+			// Corner radius, stroke width, shadow feather and distance from the edge to the outer border of the shadow.
+			// Zero corner radius gives sharp corners, zero stroke width or shadow size disables them
+			glm::vec4 params;
+			glm::vec<4, uint8_t> fill;
+			glm::vec<4, uint8_t> stroke;
+		};
+
+		SDFRenderer& operator=(const SDFRenderer&) = delete;
+		SDFRenderer(const SDFRenderer&) = delete;
+		SDFRenderer() = default;
+
+		~SDFRenderer();
+
+		// Instanced arrays and instanced draw calls are core since GL 3.3, or come with ARB extensions
+		static bool IsSupported();
+
+		// Returns false if instancing is not supported
+		bool Init();
+
+		bool IsReady() const
+		{
+			return m_program != nullptr;
+		}
+
+		void Add(const Instance& instance)
+		{
+			m_instances.push_back(instance);
+		}
+
+		// Same as DrawPointPath
+		void AddPoint(glm::vec2 pos, glm::vec<4, uint8_t> color, float radius);
+		// Same as DrawBoxPath
+		void AddBox(glm::aabb2 box, glm::vec<4, uint8_t> stroke, glm::vec<4, uint8_t> fill);
+
+		size_t GetCount() const
+		{
+			return m_instances.size();
+		}
+
+		// Draws and clears queued instances
+		void Draw(int display_w, int display_h);
+
+	private:
+		std::vector<Instance> m_instances;
+		uint32_t m_quad = 0;
+		uint32_t m_buffer = 0;
+
+		ProgramPtr m_program;
+		VertexSpec m_quadSpec;
+		VertexSpec m_instanceSpec;
+		Uniform u_viewport;
+	};
+}
@@ -0,0 +1,89 @@
+#include "ShareGroup.h"
+#include "Image.h"
+#include "TiledImage.h"
+#include "Texture.h"
+#include "PixelUnpackBuffer.h"
+
+
+// Contexts are made current on the thread that runs the event loop, so there is one current group
+static std::shared_ptr<ShareGroup> current;
+
+const std::shared_ptr<ShareGroup>& ShareGroup::GetCurrent()
+{
+	return current;
+}
+
+void ShareGroup::SetCurrent(const std::shared_ptr<ShareGroup>& group)
+{
+	current = group;
+}
+
+ShareGroup::ShareGroup() = default;
+
+ShareGroup::~ShareGroup()
+{
+	// Images may keep the group alive after its contexts were destroyed, then there is no GL context to delete buffers in
+	m_unpackBuffer.release();
+}
+
+Render::PixelUnpackBuffer& ShareGroup::GetUnpackBuffer()
+{
+	if (!m_unpackBuffer)
+	{
+		m_unpackBuffer.reset(new Render::PixelUnpackBuffer());
+	}
+	return *m_unpackBuffer;
+}
+
+void ShareGroup::ReleaseGLObjects()
+{
+	m_unpackBuffer.reset();
+}
+
+void ShareGroup::Register(const Image* image)
+{
+	m_images.insert(image);
+}
+
+void ShareGroup::Unregister(const Image* image)
+{
+	m_images.erase(image);
+}
+
+void ShareGroup::Register(const TiledImage* image)
+{
+	m_tiledImages.insert(image);
+}
+
+void ShareGroup::Unregister(const TiledImage* image)
+{
+	m_tiledImages.erase(image);
+}
+
+void ShareGroup::Register(const Render::Texture* texture)
+{
+	m_textures.insert(texture);
+}
+
+void ShareGroup::Unregister(const Render::Texture* texture)
+{
+	m_textures.erase(texture);
+}
+
+size_t ShareGroup::GetImageBytes() const
+{
+	size_t bytes = 0;
+	for (const Image* image: m_images)
+	{
+		bytes += image->GetBytes();
+	}
+	for (const TiledImage* image: m_tiledImages)
+	{
+		bytes += image->GetBytes();
+	}
+	for (const Render::Texture* texture: m_textures)
+	{
+		bytes += texture->GetBytes();
+	}
+	return bytes;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <stddef.h>
+#include <unordered_set>
+
+class Image;
+class TiledImage;
+
+namespace Render
+{
+	class PixelUnpackBuffer;
+	class Texture;
+}
+
+
+// Set of GL contexts that share objects: a context and all contexts that were created to share with it.
+// Textures created in any of them can be drawn in all of them. Images register in the group of the context that was
+// current when they were created, so that video memory they take is reported once for all contexts of the group.
+// Tiled images and textures loaded from files register the same way.
+class ShareGroup
+{
+	ShareGroup(const ShareGroup&) = delete; // non construction-copyable
+	ShareGroup& operator=(const ShareGroup&) = delete; // non copyable
+public:
+	ShareGroup();
+	~ShareGroup();
+
+	// Group of the context that was made current last, null if there is none
+	static const std::shared_ptr<ShareGroup>& GetCurrent();
+	static void SetCurrent(const std::shared_ptr<ShareGroup>& group);
+
+	void Register(const Image* image);
+	void Unregister(const Image* image);
+	void Register(const TiledImage* image);
+	void Unregister(const TiledImage* image);
+	void Register(const Render::Texture* texture);
+	void Unregister(const Render::Texture* texture);
+
+	size_t GetImageCount() const
+	{
+		return m_images.size() + m_tiledImages.size() + m_textures.size();
+	}
+
+	// Sum of GetBytes over the images, tiled images and textures of the group
+	size_t GetImageBytes() const;
+
+	// Ring of pixel unpack buffers for asynchronous uploads. Buffers are shared objects, so one ring serves all contexts
+	// of the group, and it is not used in contexts of other groups. Created on first use
+	Render::PixelUnpackBuffer& GetUnpackBuffer();
+
+	// Deletes GL objects owned by the group. Called by the last context of the group, while it is still current
+	void ReleaseGLObjects();
+
+	// Number of contexts in the group
+	int m_contextCount = 0;
+
+private:
+	std::unordered_set<const Image*> m_images;
+	std::unordered_set<const TiledImage*> m_tiledImages;
+	std::unordered_set<const Render::Texture*> m_textures;
+	std::unique_ptr<Render::PixelUnpackBuffer> m_unpackBuffer;
+};
+
+typedef std::shared_ptr<ShareGroup> ShareGroupPtr;
@@ -1,4 +1,10 @@
 #include "Texture.h"
+#include "DDSReader.h"
+#include "KTXReader.h"
+#include "MappedFile.h"
+#include "GLDebugMessage.h"
+#include "Tracer.h"
+#include "runtime_error.h"
 #include <GL/gl3w.h>
 #include <stdio.h>
 #include <spdlog/spdlog.h>
@@ -9,9 +15,15 @@
 
 using namespace Render;
 
-Texture::Texture(): header({{0, 0, 0}, 0, 0, Invalid, false, false }), m_textureHandle(uint32_t(-1))
+Texture::Texture(): header({{0, 0, 0}, 0, 0, Invalid, false, false }), m_textureHandle(uint32_t(-1)),
+	m_format({TextureFormat::lRGB, TextureFormat::RGBA8888, TextureFormat::UnsignedByteNormalized}),
+	m_shareGroup(ShareGroup::GetCurrent())
 {
 	glGenTextures(1, &m_textureHandle);
+	if (m_shareGroup)
+	{
+		m_shareGroup->Register(this);
+	}
 }
 
 void Texture::Bind(int slot)
@@ -27,6 +39,10 @@ void Texture::UnBind()
 
 Texture::~Texture()
 {
+	if (m_shareGroup)
+	{
+		m_shareGroup->Unregister(this);
+	}
 	if (m_textureHandle != uint32_t(-1))
 	{
 		glDeleteTextures(1, &m_textureHandle);
@@ -34,13 +50,61 @@ Texture::~Texture()
 	}
 }
 
+static bool IsSupported(TextureFormat& format)
+{
+	switch (format.pixel_format)
+	{
+		case TextureFormat::DXT1:
+		case TextureFormat::DXT2:
+		case TextureFormat::DXT3:
+		case TextureFormat::DXT4:
+		case TextureFormat::DXT5:
+			if (format.colorspace == TextureFormat::sRGB && !has_s3tc_srgb() && !CheckExtension("GL_EXT_texture_sRGB"))
+			{
+				spdlog::warn("sRGB S3TC textures are not supported, texture will be sampled as linear");
+				format.colorspace = TextureFormat::lRGB;
+			}
+			return has_s3tc();
+		case TextureFormat::BC6:
+		case TextureFormat::BC7:
+			return has_bptc();
+		case TextureFormat::ETC1:
+			return CheckExtension("GL_OES_compressed_ETC1_RGB8_texture") || CheckExtension("GL_ARB_ES3_compatibility");
+		case TextureFormat::ETC2_RGB:
+		case TextureFormat::ETC2_RGBA:
+		case TextureFormat::ETC2_RGB_A1:
+		case TextureFormat::EAC_R11:
+		case TextureFormat::EAC_RG11:
+			return CheckExtension("GL_ARB_ES3_compatibility");
+		default:
+			// RGTC is core since OpenGL 3.0
+			return true;
+	}
+}
+
+TexturePtr Texture::LoadTexture(const std::string& path)
+{
+	// Levels are uploaded straight from the page cache, the file is never copied to the heap
+	IReader::Blob blob = MapFile(path);
+
+	if (DDSReader::CheckMagic(blob))
+	{
+		return LoadTexture(TextureReader(std::make_shared<DDSReader>(blob)));
+	}
+	if (KTXReader::CheckMagic(blob))
+	{
+		return LoadTexture(TextureReader(std::make_shared<KTXReader>(blob)));
+	}
+	throw runtime_error("Unknown texture container: %s. Supported are DDS and KTX", path.c_str());
+}
+
 TexturePtr Texture::LoadTexture(TextureReader reader)
 {
+	TRACE_SCOPE("Texture::LoadTexture", "upload");
 	TexturePtr texture = std::make_shared<Texture>();
 	texture->header.size = reader.GetSize(0);
 
 	auto decoded = Render::DecodePixelType((uint64_t)reader.GetFormat().pixel_format);
-	// int channel_count = decoded.channel_names.size();
 	int dimensionality = 3;
 	texture->header.type = Texture::Texture_3D;
 	if (texture->header.size.z == 1)
@@ -84,12 +148,28 @@ TexturePtr Texture::LoadTexture(TextureReader reader)
 			break;
 	}
 
-	texture->Bind(0);
+	texture->m_format = reader.GetFormat();
+	if (!IsSupported(texture->m_format))
+	{
+		throw runtime_error("Texture compression format %d is not supported by the driver", (int)texture->m_format.pixel_format);
+	}
 
-	auto glformat = Render::GetGLMappedTypes(reader.GetFormat());
+	auto glformat = Render::GetGLMappedTypes(texture->m_format);
 	uint32_t internal_format = glformat[0];
 	uint32_t import_format = glformat[1];
 	uint32_t channel_type = glformat[2];
+	if (internal_format == 0)
+	{
+		throw runtime_error("Texture format %d has no GL mapping", (int)texture->m_format.pixel_format);
+	}
+
+	texture->Bind(0);
+
+	// Readers return tightly packed rows
+	GLint backup_alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &backup_alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	while (glGetError() != GL_NO_ERROR);
 
 	for (int mipmap = 0; mipmap < reader.GetMipmapCount(); ++mipmap)
 	{
@@ -97,18 +177,42 @@ TexturePtr Texture::LoadTexture(TextureReader reader)
 		{
 			auto block_size = reader.GetSize(mipmap);
 			auto blob = reader.Read(mipmap, face);
+			PrefetchBlob(blob);
+			texture->m_bytes += blob.size;
+			uint32_t target = texture->header.cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : texture->header.gltextype;
 
 			if (texture->header.compressed)
 			{
-				glCompressedTexImage2D(texture->header.gltextype + face, mipmap, internal_format, block_size.x, block_size.y, 0, blob.size, blob.data.get());
+				glCompressedTexImage2D(target, mipmap, internal_format, block_size.x, block_size.y, 0, blob.size, blob.data.get());
 			}
 			else
 			{
-				glTexImage2D(texture->header.gltextype + face, mipmap, internal_format, block_size.x, block_size.y, 0, import_format, channel_type, blob.data.get());
+				glTexImage2D(target, mipmap, internal_format, block_size.x, block_size.y, 0, import_format, channel_type, blob.data.get());
 			}
+			// GL has copied the data, so pages of the file do not have to stay resident
+			EvictBlob(blob);
 		}
 	}
 
+	glPixelStorei(GL_UNPACK_ALIGNMENT, backup_alignment);
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+	{
+		texture->UnBind();
+		throw runtime_error("Texture upload failed with GL error 0x%x", error);
+	}
+
+	// Files do not have to contain the full chain
+	glTexParameteri(texture->header.gltextype, GL_TEXTURE_MAX_LEVEL, texture->header.MIPMapCount - 1);
+
+	size_t channel_count = decoded.channel_names.size();
+	auto f = texture->m_format.pixel_format;
+	if (channel_count == 1 || f == TextureFormat::BC4 || f == TextureFormat::EAC_R11)
+	{
+		static GLint swizzleMask_R[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(texture->header.gltextype, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_R);
+	}
+
 	if (texture->header.MIPMapCount > 1)
 	{
 		glTexParameteri(texture->header.gltextype, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include "Types.h"
 #include "IReader.h"
+#include "ShareGroup.h"
 
 
 namespace Render
@@ -30,6 +31,10 @@ namespace Render
 
 		static TexturePtr LoadTexture(TextureReader reader);
 
+		// Loads DDS or KTX file, the container is detected by its signature. Throws if the file can not be loaded, or
+		// if its compression format is not supported by the driver.
+		static TexturePtr LoadTexture(const std::string& path);
+
 		void Bind(int slot);
 
 		void UnBind();
@@ -46,8 +51,48 @@ namespace Render
 
 		~Texture();
 
+		unsigned int GetHandle() const
+		{
+			return m_textureHandle;
+		}
+
+		glm::ivec3 GetSize() const
+		{
+			return header.size;
+		}
+
+		int GetMipmapCount() const
+		{
+			return header.MIPMapCount;
+		}
+
+		bool IsCompressed() const
+		{
+			return header.compressed;
+		}
+
+		TextureFormat GetFormat() const
+		{
+			return m_format;
+		}
+
+		// Amount of video memory taken by the texture data, including mipmaps and faces
+		size_t GetBytes() const
+		{
+			return m_bytes;
+		}
+
+		// Group of contexts the texture was created in, it can be drawn only in them
+		const ShareGroupPtr& GetShareGroup() const
+		{
+			return m_shareGroup;
+		}
+
 	private:
 		TextureHeader header;
 		unsigned int m_textureHandle;
+		TextureFormat m_format;
+		size_t m_bytes = 0;
+		ShareGroupPtr m_shareGroup;
 	};
 }
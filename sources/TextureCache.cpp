@@ -0,0 +1,78 @@
+#include "TextureCache.h"
+
+
+TextureCache::TextureCache(size_t budget): m_budget(budget)
+{
+}
+
+ImagePtr TextureCache::Get(const std::string& key)
+{
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		m_misses += 1;
+		return nullptr;
+	}
+	m_hits += 1;
+	m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+	return it->second.image;
+}
+
+bool TextureCache::Contains(const std::string& key) const
+{
+	return m_entries.find(key) != m_entries.end();
+}
+
+void TextureCache::Put(const std::string& key, ImagePtr image)
+{
+	Remove(key);
+
+	m_lru.push_front(key);
+	Entry entry;
+	entry.image = image;
+	entry.bytes = image->GetBytes();
+	entry.lru = m_lru.begin();
+	m_entries[key] = entry;
+	m_bytes += entry.bytes;
+
+	Evict();
+}
+
+bool TextureCache::Remove(const std::string& key)
+{
+	auto it = m_entries.find(key);
+	if (it == m_entries.end())
+	{
+		return false;
+	}
+	m_bytes -= it->second.bytes;
+	m_lru.erase(it->second.lru);
+	m_entries.erase(it);
+	return true;
+}
+
+void TextureCache::Clear()
+{
+	m_entries.clear();
+	m_lru.clear();
+	m_bytes = 0;
+}
+
+void TextureCache::SetBudget(size_t budget)
+{
+	m_budget = budget;
+	Evict();
+}
+
+void TextureCache::Evict()
+{
+	// The most recently used one stays, even if it alone exceeds the budget
+	while (m_bytes > m_budget && m_lru.size() > 1)
+	{
+		auto it = m_entries.find(m_lru.back());
+		m_bytes -= it->second.bytes;
+		m_entries.erase(it);
+		m_lru.pop_back();
+		m_evictions += 1;
+	}
+}
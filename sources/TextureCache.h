@@ -0,0 +1,62 @@
+#pragma once
+#include "Image.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+
+
+// Keeps uploaded images by a caller supplied key, e.g. path, so that revisiting an image does not upload it again.
+// Least recently used images are dropped when total size exceeds the budget. An image that is still referenced elsewhere,
+// e.g. displayed, is only released by the cache, its texture lives until the last reference is gone.
+class TextureCache
+{
+	TextureCache(const TextureCache&) = delete; // non construction-copyable
+	TextureCache& operator=(const TextureCache&) = delete; // non copyable
+public:
+	explicit TextureCache(size_t budget = 512u * 1024u * 1024u);
+
+	// Returns cached image and marks it as most recently used, or nullptr if there is no such key
+	ImagePtr Get(const std::string& key);
+
+	bool Contains(const std::string& key) const;
+
+	// Adds or replaces the image, then evicts least recently used images until the budget is met.
+	// The image that was just added is never evicted.
+	void Put(const std::string& key, ImagePtr image);
+
+	bool Remove(const std::string& key);
+
+	void Clear();
+
+	void SetBudget(size_t budget);
+
+	size_t GetBudget() const
+	{
+		return m_budget;
+	}
+
+	size_t GetCount() const
+	{
+		return m_entries.size();
+	}
+
+	size_t m_bytes = 0;
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+	size_t m_evictions = 0;
+
+private:
+	struct Entry
+	{
+		ImagePtr image;
+		size_t bytes;
+		std::list<std::string>::iterator lru;
+	};
+
+	void Evict();
+
+	size_t m_budget;
+	std::unordered_map<std::string, Entry> m_entries;
+	// Most recently used first
+	std::list<std::string> m_lru;
+};
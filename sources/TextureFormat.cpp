@@ -1,5 +1,6 @@
 #include "TextureFormat.h"
 #include <spdlog/spdlog.h>
+#include "GLCompressionTypes.h"
 #include <GL/gl3w.h>
 
 using namespace Render;
@@ -186,12 +187,16 @@ size_t TextureFormat::GetBitsPerPixel(Format f)
 		case ETC2_RGB:
 		case ETC2_RGB_A1:
 		case DXT1:
+		case BC4:
 			return 4;
 
 		case DXT2:
 		case DXT3:
 		case DXT4:
 		case DXT5:
+		case BC5:
+		case BC6:
+		case BC7:
 		case EAC_RG11:
 		case ETC2_RGBA:
 			return 8;
@@ -219,6 +224,10 @@ glm::ivec2 TextureFormat::GetMinBlockSize(Format f)
 			case DXT3:
 			case DXT4:
 			case DXT5:
+			case BC4:
+			case BC5:
+			case BC6:
+			case BC7:
 			case ETC1:
 			case ETC2_RGB:
 			case ETC2_RGB_A1:
@@ -302,6 +311,7 @@ std::vector<uint32_t> Render::GetGLMappedTypes(TextureFormat format)
 	bool _signed = Render::TextureFormat::IsSigned(format.type);
 	bool _normalized = Render::TextureFormat::IsNormalized(format.type);
 	bool _float = Render::TextureFormat::IsFloat(format.type);
+	bool _srgb = format.colorspace == Render::TextureFormat::sRGB;
 
 	switch (format.pixel_format)
 	{
@@ -344,7 +354,7 @@ std::vector<uint32_t> Render::GetGLMappedTypes(TextureFormat format)
 		case Render::PixelType<'r', 8, 'g', 8, 'b', 8>::ID:
 			import_format = _normalized ? GL_RGB : GL_RGB_INTEGER;
 			channel_type = _signed ? GL_BYTE : GL_UNSIGNED_BYTE;
-			internal_format = _normalized ? (_signed ? GL_RGB8_SNORM : GL_RGB8) : (_signed ? GL_RGB8I : GL_RGB8UI);
+			internal_format = _normalized ? (_signed ? GL_RGB8_SNORM : (_srgb ? GL_SRGB8 : GL_RGB8)) : (_signed ? GL_RGB8I : GL_RGB8UI);
 			break;
 
 		case Render::PixelType<'r', 16, 'g', 16, 'b', 16>::ID:
@@ -362,7 +372,15 @@ std::vector<uint32_t> Render::GetGLMappedTypes(TextureFormat format)
 		case Render::PixelType<'r', 8, 'g', 8, 'b', 8, 'a', 8>::ID:
 			import_format = _normalized ? GL_RGBA : GL_RGBA_INTEGER;
 			channel_type = _signed ? GL_BYTE : GL_UNSIGNED_BYTE;
-			internal_format = _normalized ? (_signed ? GL_RGBA8_SNORM : GL_RGBA8) : (_signed ? GL_RGBA8I : GL_RGBA8UI);
+			internal_format = _normalized ? (_signed ? GL_RGBA8_SNORM : (_srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8)) : (_signed ? GL_RGBA8I : GL_RGBA8UI);
+			break;
+
+		case Render::PixelType<'b', 8, 'g', 8, 'r', 8, 'a', 8>::ID:
+			assert(!_signed);
+			assert(_normalized);
+			import_format = GL_BGRA;
+			channel_type = GL_UNSIGNED_BYTE;
+			internal_format = _srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
 			break;
 
 		case Render::PixelType<'r', 16, 'g', 16, 'b', 16, 'a', 16>::ID:
@@ -410,6 +428,61 @@ std::vector<uint32_t> Render::GetGLMappedTypes(TextureFormat format)
 			internal_format = _normalized ? GL_RGB10_A2 : GL_RGB10_A2UI;
 			break;
 
+		// Compressed formats have no import format and channel type
+		case Render::TextureFormat::DXT1:
+			internal_format = _srgb ? COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			break;
+
+		case Render::TextureFormat::DXT2:
+		case Render::TextureFormat::DXT3:
+			internal_format = _srgb ? COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT : COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			break;
+
+		case Render::TextureFormat::DXT4:
+		case Render::TextureFormat::DXT5:
+			internal_format = _srgb ? COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			break;
+
+		case Render::TextureFormat::BC4:
+			internal_format = _signed ? COMPRESSED_SIGNED_RED_RGTC1 : COMPRESSED_RED_RGTC1;
+			break;
+
+		case Render::TextureFormat::BC5:
+			internal_format = _signed ? COMPRESSED_SIGNED_RG_RGTC2 : COMPRESSED_RG_RGTC2;
+			break;
+
+		case Render::TextureFormat::BC6:
+			internal_format = _signed ? COMPRESSED_RGB_BPTC_SIGNED_FLOAT_EXT : COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_EXT;
+			break;
+
+		case Render::TextureFormat::BC7:
+			internal_format = _srgb ? COMPRESSED_SRGB_ALPHA_BPTC_UNORM_EXT : COMPRESSED_RGBA_BPTC_UNORM_EXT;
+			break;
+
+		case Render::TextureFormat::ETC1:
+			internal_format = ETC1_RGB8_OES;
+			break;
+
+		case Render::TextureFormat::ETC2_RGB:
+			internal_format = _srgb ? COMPRESSED_SRGB8_ETC2 : COMPRESSED_RGB8_ETC2;
+			break;
+
+		case Render::TextureFormat::ETC2_RGBA:
+			internal_format = _srgb ? COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : COMPRESSED_RGBA8_ETC2_EAC;
+			break;
+
+		case Render::TextureFormat::ETC2_RGB_A1:
+			internal_format = _srgb ? COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 : COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+			break;
+
+		case Render::TextureFormat::EAC_R11:
+			internal_format = _signed ? COMPRESSED_SIGNED_R11_EAC : COMPRESSED_R11_EAC;
+			break;
+
+		case Render::TextureFormat::EAC_RG11:
+			internal_format = _signed ? COMPRESSED_SIGNED_RG11_EAC : COMPRESSED_RG11_EAC;
+			break;
+
 		default:
 			spdlog::error("Could not find proper GL mapping of format: {}", GetStringRepresentation(format));
 			throw runtime_error("Could not find proper GL mapping of format: %s", GetStringRepresentation(format).c_str());
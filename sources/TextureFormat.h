@@ -71,6 +71,10 @@ namespace Render
 			DXT3,
 			DXT4,
 			DXT5,
+			BC4,
+			BC5,
+			BC6,
+			BC7,
 			BC1 = DXT1,
 			BC2 = DXT3,
 			BC3 = DXT5,
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+
+ThreadPool::ThreadPool(int threads): m_stop(false)
+{
+	if (threads <= 0)
+	{
+		threads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	for (int i = 0; i < threads; ++i)
+	{
+		m_threads.emplace_back([this, i]()
+		{
+			Tracer::SetThreadName("worker " + std::to_string(i));
+			Worker();
+		});
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (auto& thread: m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::Worker()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		TRACE_SCOPE("task", "worker");
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(int begin, int end, const std::function<void(int, int)>& fn, int grain)
+{
+	if (end <= begin)
+	{
+		return;
+	}
+
+	int count = end - begin;
+	// A few chunks per thread to even out the load
+	int chunk_size = std::max(std::max(grain, 1), (count + GetThreadCount() * 4 - 1) / (GetThreadCount() * 4));
+	int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	struct State
+	{
+		std::atomic<int> next;
+		std::atomic<int> done;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	auto state = std::make_shared<State>();
+	state->next = 0;
+	state->done = 0;
+
+	// Helpers may start after all chunks are taken, in that case they do not touch `fn`
+	auto run = [state, &fn, begin, end, chunk_size, chunk_count]()
+	{
+		while (true)
+		{
+			int chunk = state->next++;
+			if (chunk >= chunk_count)
+			{
+				break;
+			}
+			int chunk_begin = begin + chunk * chunk_size;
+			fn(chunk_begin, std::min(end, chunk_begin + chunk_size));
+			if (++state->done == chunk_count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	int helpers = std::min(GetThreadCount(), chunk_count - 1);
+	for (int i = 0; i < helpers; ++i)
+	{
+		Enqueue(run);
+	}
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state, chunk_count]() { return state->done == chunk_count; });
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
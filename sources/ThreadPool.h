@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+	ThreadPool(const ThreadPool&) = delete; // non construction-copyable
+	ThreadPool& operator=(const ThreadPool&) = delete; // non copyable
+public:
+	// If `threads` is zero, number of hardware threads is used
+	explicit ThreadPool(int threads = 0);
+
+	~ThreadPool();
+
+	void Enqueue(std::function<void()> task);
+
+	// Splits range [begin, end) into chunks of at least `grain` elements and calls fn(chunk_begin, chunk_end) for each of them.
+	// Chunks are processed by the workers and by the calling thread. Blocks until all chunks are done.
+	void ParallelFor(int begin, int end, const std::function<void(int, int)>& fn, int grain = 1);
+
+	int GetThreadCount() const
+	{
+		return (int)m_threads.size();
+	}
+
+	// Pool shared by the whole module
+	static ThreadPool& GetDefault();
+
+private:
+	void Worker();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()> > m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop;
+};
@@ -0,0 +1,294 @@
+#include "TiledImage.h"
+#include "MipmapGenerator.h"
+#include "Tracer.h"
+#include "runtime_error.h"
+#include <GL/gl3w.h>
+#include <algorithm>
+#include <math.h>
+
+
+TiledImage::TiledImage(const uint8_t* data, int width, int height, int channels, std::shared_ptr<void> owner, int tile_size, size_t budget):
+	m_width(width), m_height(height), m_budget(budget), m_tileSize(tile_size), m_channels(channels), m_owner(owner),
+	m_shareGroup(ShareGroup::GetCurrent())
+{
+	if (channels < 1 || channels > 4)
+	{
+		throw runtime_error("Wrong number of channels. Should be either 1, 2, 3, or 4, but got %d", channels);
+	}
+	if (tile_size < 1)
+	{
+		throw runtime_error("Wrong tile size: %d", tile_size);
+	}
+
+	Level level0;
+	level0.width = width;
+	level0.height = height;
+	level0.data = data;
+	m_levels.push_back(std::move(level0));
+
+	// Levels are generated until the whole image fits into one tile
+	std::vector<uint8_t*> pointers;
+	for (auto size: GetMipmapChainSizes(width, height))
+	{
+		if (m_levels.back().width <= tile_size && m_levels.back().height <= tile_size)
+		{
+			break;
+		}
+		Level level;
+		level.width = size.x;
+		level.height = size.y;
+		level.storage.resize(size_t(level.width) * level.height * channels);
+		level.data = level.storage.data();
+		pointers.push_back(level.storage.data());
+		m_levels.push_back(std::move(level));
+	}
+	GenerateMipmaps(data, width, height, channels, channels, ptrdiff_t(width) * channels, pointers, MipmapKernel::Box);
+
+	for (auto& level: m_levels)
+	{
+		level.tiles_x = (level.width + tile_size - 1) / tile_size;
+		level.tiles_y = (level.height + tile_size - 1) / tile_size;
+	}
+
+	if (m_shareGroup)
+	{
+		m_shareGroup->Register(this);
+	}
+}
+
+TiledImage::~TiledImage()
+{
+	if (m_shareGroup)
+	{
+		m_shareGroup->Unregister(this);
+	}
+	for (auto& tile: m_tiles)
+	{
+		glDeleteTextures(1, &tile.second.handle);
+	}
+}
+
+void TiledImage::GetTexels(int level, int x, int y, glm::ivec2& min, glm::ivec2& max) const
+{
+	const Level& l = m_levels[level];
+	min = glm::max(glm::ivec2(x, y) * m_tileSize - 1, glm::ivec2(0));
+	max = glm::min(glm::ivec2(x + 1, y + 1) * m_tileSize + 1, glm::ivec2(l.width, l.height));
+}
+
+TiledImage::DrawTile TiledImage::GetRect(int level, int x, int y, uint32_t handle) const
+{
+	const Level& l = m_levels[level];
+	float scale = float(1u << unsigned(level));
+	glm::ivec2 p0 = glm::ivec2(x, y) * m_tileSize;
+	glm::ivec2 p1 = glm::min(p0 + m_tileSize, glm::ivec2(l.width, l.height));
+	glm::ivec2 t0, t1;
+	GetTexels(level, x, y, t0, t1);
+
+	// Coarser levels may be shorter than the image by a few pixels of level 0, their last tiles are stretched to its edge
+	glm::vec2 e0 = glm::vec2(p0) * scale;
+	glm::vec2 e1 = glm::vec2(p1) * scale;
+	if (p1.x == l.width)
+	{
+		e1.x = float(m_width);
+	}
+	if (p1.y == l.height)
+	{
+		e1.y = float(m_height);
+	}
+	glm::vec2 stretch = (GetSize() + 1.0f) / GetSize();
+	glm::vec2 texture_size = glm::vec2(t1 - t0);
+
+	DrawTile tile;
+	tile.handle = handle;
+	tile.min = e0 * stretch - 0.5f;
+	tile.max = e1 * stretch - 0.5f;
+	tile.uv = glm::vec4(glm::vec2(p0 - t0) / texture_size, glm::vec2(p1 - p0) / texture_size);
+	return tile;
+}
+
+TiledImage::Tile* TiledImage::Find(uint64_t key)
+{
+	auto it = m_tiles.find(key);
+	if (it == m_tiles.end())
+	{
+		return nullptr;
+	}
+	Tile& tile = it->second;
+	tile.last_used = m_frame;
+	m_lru.splice(m_lru.begin(), m_lru, tile.lru);
+	return &tile;
+}
+
+TiledImage::Tile* TiledImage::Upload(int level, int x, int y)
+{
+	TRACE_SCOPE("TiledImage::Upload", "upload");
+	static GLint swizzleMask_R[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+	static GLint swizzleMask_RG[] = { GL_RED, GL_GREEN, GL_ZERO, GL_ONE };
+	static GLint swizzleMask_RGB[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ONE };
+	static GLint swizzleMask_RGBA[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+	static GLint internal_formats[] = { GL_R8, GL_RG8, GL_SRGB8, GL_SRGB8_ALPHA8 };
+	static GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	static GLint* swizzleMasks[] = { swizzleMask_R, swizzleMask_RG, swizzleMask_RGB, swizzleMask_RGBA };
+
+	const Level& l = m_levels[level];
+	glm::ivec2 t0, t1;
+	GetTexels(level, x, y, t0, t1);
+	int w = t1.x - t0.x;
+	int h = t1.y - t0.y;
+
+	Tile tile;
+	glGenTextures(1, &tile.handle);
+	glBindTexture(GL_TEXTURE_2D, tile.handle);
+
+	GLint backup_alignment, backup_row_length;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &backup_alignment);
+	glGetIntegerv(GL_UNPACK_ROW_LENGTH, &backup_row_length);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, l.width);
+
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMasks[m_channels - 1]);
+	const uint8_t* src = l.data + (size_t(t0.y) * l.width + t0.x) * m_channels;
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_formats[m_channels - 1], w, h, 0, formats[m_channels - 1], GL_UNSIGNED_BYTE, src);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, backup_row_length);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, backup_alignment);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	uint64_t key = MakeKey(level, x, y);
+	tile.bytes = size_t(w) * h * m_channels;
+	tile.last_used = m_frame;
+	m_lru.push_front(key);
+	tile.lru = m_lru.begin();
+
+	m_residentBytes += tile.bytes;
+	m_residentTiles += 1;
+	m_uploads += 1;
+	return &(m_tiles[key] = tile);
+}
+
+void TiledImage::Evict()
+{
+	int coarsest = (int)m_levels.size() - 1;
+	auto it = m_lru.end();
+	while (m_residentBytes > m_budget && it != m_lru.begin())
+	{
+		--it;
+		auto tile = m_tiles.find(*it);
+		// Everything towards the front was used in this frame too
+		if (tile->second.last_used == m_frame)
+		{
+			break;
+		}
+		// The coarsest level is the last resort substitute, so it is never evicted
+		if (int(*it >> 56u) == coarsest)
+		{
+			continue;
+		}
+		glDeleteTextures(1, &tile->second.handle);
+		m_residentBytes -= tile->second.bytes;
+		m_residentTiles -= 1;
+		m_evictions += 1;
+		m_tiles.erase(tile);
+		it = m_lru.erase(it);
+	}
+}
+
+void TiledImage::Update(glm::vec2 view_min, glm::vec2 view_max, float scale, std::vector<DrawTile>& out, int max_uploads)
+{
+	++m_frame;
+	out.clear();
+	m_complete = true;
+
+	int coarsest = (int)m_levels.size() - 1;
+	int level = 0;
+	if (scale < 1.0f)
+	{
+		level = std::min(coarsest, (int)floorf(-log2f(scale)));
+	}
+
+	if (view_max.x < -0.5f || view_max.y < -0.5f || view_min.x > m_width + 0.5f || view_min.y > m_height + 0.5f)
+	{
+		return;
+	}
+
+	// View in pixels of level 0, see GetRect
+	glm::vec2 stretch = (GetSize() + 1.0f) / GetSize();
+	view_min = (view_min + 0.5f) / stretch;
+	view_max = (view_max + 0.5f) / stretch;
+
+	const Level& l = m_levels[level];
+	float tile_extent = float(m_tileSize) * float(1u << unsigned(level));
+	int tx0 = glm::clamp(int(floorf(view_min.x / tile_extent)), 0, l.tiles_x - 1);
+	int ty0 = glm::clamp(int(floorf(view_min.y / tile_extent)), 0, l.tiles_y - 1);
+	int tx1 = glm::clamp(int(floorf(view_max.x / tile_extent)), 0, l.tiles_x - 1);
+	int ty1 = glm::clamp(int(floorf(view_max.y / tile_extent)), 0, l.tiles_y - 1);
+
+	std::vector<std::pair<uint64_t, DrawTile> > substitutes;
+	std::vector<DrawTile> tiles;
+	int uploads = 0;
+
+	for (int y = ty0; y <= ty1; ++y)
+	{
+		for (int x = tx0; x <= tx1; ++x)
+		{
+			Tile* tile = Find(MakeKey(level, x, y));
+			if (tile == nullptr && uploads < max_uploads)
+			{
+				tile = Upload(level, x, y);
+				++uploads;
+			}
+			if (tile != nullptr)
+			{
+				tiles.push_back(GetRect(level, x, y, tile->handle));
+				continue;
+			}
+
+			// Not resident yet, substitute with the nearest coarser tile
+			for (int parent_level = level + 1; parent_level <= coarsest; ++parent_level)
+			{
+				int shift = parent_level - level;
+				int px = x >> shift;
+				int py = y >> shift;
+				uint64_t key = MakeKey(parent_level, px, py);
+				Tile* parent = Find(key);
+				if (parent == nullptr && parent_level == coarsest)
+				{
+					parent = Upload(parent_level, px, py);
+				}
+				if (parent != nullptr)
+				{
+					bool found = false;
+					for (auto& s: substitutes)
+					{
+						found = found || s.first == key;
+					}
+					if (!found)
+					{
+						substitutes.emplace_back(key, GetRect(parent_level, px, py, parent->handle));
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	m_complete = substitutes.empty();
+
+	// Coarser tiles go first, so that finer ones are drawn on top of them
+	std::sort(substitutes.begin(), substitutes.end(), [](const std::pair<uint64_t, DrawTile>& a, const std::pair<uint64_t, DrawTile>& b)
+	{
+		return (a.first >> 56u) > (b.first >> 56u);
+	});
+	for (auto& s: substitutes)
+	{
+		out.push_back(s.second);
+	}
+	out.insert(out.end(), tiles.begin(), tiles.end());
+
+	Evict();
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "ShareGroup.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+// Virtual texture for images that do not fit into a single GL texture.
+// Source is split into fixed-size tiles for each level of a mipmap pyramid. Only tiles that are visible are uploaded,
+// residency is limited by a memory budget with least recently used tiles evicted first.
+class TiledImage
+{
+public:
+	TiledImage& operator=(const TiledImage&) = delete;
+	TiledImage(const TiledImage&) = delete;
+
+	// `data` must stay valid for the lifetime of the object, `owner` is kept to guarantee that.
+	TiledImage(const uint8_t* data, int width, int height, int channels, std::shared_ptr<void> owner, int tile_size = 512, size_t budget = 256 * 1024 * 1024);
+
+	~TiledImage();
+
+	struct DrawTile
+	{
+		uint32_t handle;
+		// Rectangle in image space
+		glm::vec2 min;
+		glm::vec2 max;
+		// Part of the texture that covers the rectangle, offset and size in texture coordinates. Tiles have a border of
+		// one texel of their neighbours, so that linear filtering does not show seams between them
+		glm::vec4 uv;
+	};
+
+	// Image covers [-0.5, size + 0.5] in image space, same as a single texture drawn by Context::DrawImage.
+	// Makes tiles covering the rectangle [view_min, view_max] (in image space) resident for the given scale
+	// (window pixels per image pixel). At most `max_uploads` tiles are uploaded per call, tiles that are not resident yet
+	// are substituted with coarser ones. Tiles to draw are written to `out`, coarser first.
+	void Update(glm::vec2 view_min, glm::vec2 view_max, float scale, std::vector<DrawTile>& out, int max_uploads = 8);
+
+	glm::vec2 GetSize() const
+	{
+		return glm::vec2(m_width, m_height);
+	}
+
+	// Color tiles are sRGB encoded, same as uint8 color images
+	bool IsSRGB() const
+	{
+		return m_channels >= 3;
+	}
+
+	int GetLevelCount() const
+	{
+		return (int)m_levels.size();
+	}
+
+	// Video memory taken by resident tiles
+	size_t GetBytes() const
+	{
+		return m_residentBytes;
+	}
+
+	// Group of contexts that was current when the image was created, tiles are uploaded to and drawn only in them
+	const ShareGroupPtr& GetShareGroup() const
+	{
+		return m_shareGroup;
+	}
+
+	int m_width;
+	int m_height;
+
+	// Statistics
+	size_t m_residentBytes = 0;
+	size_t m_residentTiles = 0;
+	size_t m_uploads = 0;
+	size_t m_evictions = 0;
+	// False if the last Update drew coarser substitutes for tiles that are still to be uploaded
+	bool m_complete = true;
+	size_t m_budget;
+	int m_tileSize;
+
+private:
+	struct Level
+	{
+		int width;
+		int height;
+		int tiles_x;
+		int tiles_y;
+		const uint8_t* data;
+		std::vector<uint8_t> storage;
+	};
+
+	struct Tile
+	{
+		uint32_t handle;
+		size_t bytes;
+		uint64_t last_used;
+		std::list<uint64_t>::iterator lru;
+	};
+
+	static uint64_t MakeKey(int level, int x, int y)
+	{
+		return (uint64_t(level) << 56u) | (uint64_t(y) << 28u) | uint64_t(x);
+	}
+
+	// Pixels of the level that are uploaded for the tile, including the border
+	void GetTexels(int level, int x, int y, glm::ivec2& min, glm::ivec2& max) const;
+	DrawTile GetRect(int level, int x, int y, uint32_t handle) const;
+	Tile* Find(uint64_t key);
+	Tile* Upload(int level, int x, int y);
+	void Evict();
+
+	int m_channels;
+	std::shared_ptr<void> m_owner;
+	std::vector<Level> m_levels;
+	std::unordered_map<uint64_t, Tile> m_tiles;
+	// Most recently used tiles are at the front
+	std::list<uint64_t> m_lru;
+	uint64_t m_frame = 0;
+	ShareGroupPtr m_shareGroup;
+};
+
+typedef std::shared_ptr<TiledImage> TiledImagePtr;
@@ -0,0 +1,264 @@
+#include "Tracer.h"
+#include "runtime_error.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+
+std::atomic<bool> Tracer::s_enabled(false);
+
+namespace
+{
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		int64_t begin;
+		int64_t end;
+		uint32_t thread;
+	};
+
+	// Written by one thread only. The writer publishes an event by incrementing `head`, the reader copies events
+	// below it, so it never waits for the writer
+	struct Ring
+	{
+		std::atomic<uint64_t> head;
+		Event events[Tracer::RingSize];
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+		// Rings are never freed, a ring of a thread that has exited is reused by the next thread
+		std::vector<std::unique_ptr<Ring> > rings;
+		std::vector<Ring*> free;
+		std::map<uint32_t, std::string> names;
+		int64_t start = 0;
+	};
+
+	// Not destroyed, so that threads that exit after static destructors still can return their rings
+	Registry& GetRegistry()
+	{
+		static Registry* registry = new Registry;
+		return *registry;
+	}
+
+	std::atomic<uint32_t> threadCount(0);
+
+	struct ThreadState
+	{
+		uint32_t id = ++threadCount;
+		Ring* ring = nullptr;
+
+		~ThreadState()
+		{
+			if (ring != nullptr)
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.free.push_back(ring);
+			}
+		}
+	};
+
+	thread_local ThreadState threadState;
+
+	// Ring is taken when the thread records its first event, so threads that never record while tracing take no memory
+	Ring* GetRing()
+	{
+		if (threadState.ring == nullptr)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			if (registry.free.empty())
+			{
+				registry.rings.emplace_back(new Ring);
+				registry.rings.back()->head = 0;
+				threadState.ring = registry.rings.back().get();
+			}
+			else
+			{
+				threadState.ring = registry.free.back();
+				registry.free.pop_back();
+			}
+		}
+		return threadState.ring;
+	}
+
+	void WriteString(FILE* file, const char* str)
+	{
+		fputc('"', file);
+		for (const char* c = str; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				fputc('\\', file);
+			}
+			fputc((unsigned char)*c < 0x20 ? ' ' : *c, file);
+		}
+		fputc('"', file);
+	}
+}
+
+
+int64_t Tracer::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::Start()
+{
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.start = Now();
+	}
+	s_enabled.store(true);
+}
+
+void Tracer::Record(const char* name, const char* category, int64_t begin, int64_t end)
+{
+	Ring* ring = GetRing();
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	ring->events[head % RingSize] = { name, category, begin, end, threadState.id };
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const std::string& name)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.names[threadState.id] = name;
+}
+
+size_t Tracer::Stop(const std::string& path)
+{
+	s_enabled.store(false);
+
+	std::vector<Event> events;
+	std::map<uint32_t, std::string> names;
+	int64_t start;
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		start = registry.start;
+		names = registry.names;
+		for (auto& ring: registry.rings)
+		{
+			// Scopes that began before Stop may still be writing. The ones that overwrote events while they were copied,
+			// and the event that may be half-written, are dropped
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t first = head > RingSize ? head - RingSize : 0;
+			size_t offset = events.size();
+			for (uint64_t i = first; i < head; ++i)
+			{
+				events.push_back(ring->events[i % RingSize]);
+			}
+			uint64_t overwritten = ring->head.load(std::memory_order_acquire) + 1;
+			if (overwritten > RingSize && overwritten - RingSize > first)
+			{
+				size_t count = std::min<uint64_t>(overwritten - RingSize - first, head - first);
+				events.erase(events.begin() + offset, events.begin() + offset + count);
+			}
+		}
+	}
+	// Events of previous traces
+	events.erase(std::remove_if(events.begin(), events.end(), [start](const Event& e) { return e.begin < start; }), events.end());
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.begin < b.begin; });
+
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		throw runtime_error("Could not open %s for writing", path.c_str());
+	}
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	bool first = true;
+	for (auto& name: names)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", name.first);
+		WriteString(file, name.second.c_str());
+		fputs("}}", file);
+		first = false;
+	}
+	for (auto& e: events)
+	{
+		fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+		WriteString(file, e.name);
+		fputs(",\"cat\":", file);
+		WriteString(file, e.category);
+		// Microseconds
+		fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.thread, (e.begin - start) / 1000.0,
+				(e.end - e.begin) / 1000.0);
+		first = false;
+	}
+	fputs("\n]}\n", file);
+	bool ok = ferror(file) == 0;
+	ok = fclose(file) == 0 && ok;
+	if (!ok)
+	{
+		throw runtime_error("Could not write %s", path.c_str());
+	}
+	return events.size();
+}
+
+
+#include <doctest.h>
+#include <thread>
+
+TEST_CASE("[Tracer] Chrome trace")
+{
+	{
+		TRACE_SCOPE("disabled", "test");
+	}
+	Tracer::Start();
+	{
+		TRACE_SCOPE("outer", "test");
+		TRACE_SCOPE("inner", "test");
+	}
+	std::thread thread([]()
+	{
+		Tracer::SetThreadName("test thread");
+		for (int i = 0; i < Tracer::RingSize + 10; ++i)
+		{
+			TRACE_SCOPE("worker", "test");
+		}
+	});
+	thread.join();
+
+	std::string path = "tracer_test.json";
+	// Ring of the worker keeps the last RingSize events, and the oldest of them is dropped, as the next one to be
+	// overwritten
+	CHECK_EQ(Tracer::Stop(path), size_t(Tracer::RingSize - 1 + 2));
+	CHECK(!Tracer::IsEnabled());
+	{
+		TRACE_SCOPE("after stop", "test");
+	}
+
+	FILE* file = fopen(path.c_str(), "r");
+	REQUIRE(file != nullptr);
+	std::string json;
+	char buffer[4096];
+	for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) != 0;)
+	{
+		json.append(buffer, n);
+	}
+	fclose(file);
+	remove(path.c_str());
+	CHECK(json.find("\"name\":\"outer\"") != std::string::npos);
+	CHECK(json.find("\"name\":\"test thread\"") != std::string::npos);
+	CHECK(json.find("disabled") == std::string::npos);
+	CHECK(json.find("after stop") == std::string::npos);
+
+	// Events of the previous trace are not written again
+	Tracer::Start();
+	{
+		TRACE_SCOPE("second", "test");
+	}
+	CHECK_EQ(Tracer::Stop(path), size_t(1));
+	remove(path.c_str());
+	CHECK_THROWS(Tracer::Stop("no_such_directory/trace.json"));
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Records scoped events of the render loop, uploads and worker threads, and writes them as Chrome trace JSON, which
+// can be opened in chrome://tracing or ui.perfetto.dev. Each thread appends to its own ring buffer without locks, rings
+// are read when the trace is stopped. If a thread records more than RingSize events during a trace, the oldest ones
+// are lost. While tracing is disabled, a scope costs a relaxed load of a flag and a branch.
+class Tracer
+{
+public:
+	enum
+	{
+		RingSize = 1 << 16
+	};
+
+	static bool IsEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	// Nanoseconds of steady clock
+	static int64_t Now();
+
+	// Starts recording, events of a previous trace are discarded
+	static void Start();
+
+	// Stops recording and writes the events recorded since Start to `path`. Returns number of events. Throws if the file
+	// could not be written
+	static size_t Stop(const std::string& path);
+
+	// Complete event, times are from Now(). Only pointers to `name` and `category` are kept, they should be literals
+	static void Record(const char* name, const char* category, int64_t begin, int64_t end);
+
+	// Name of the calling thread in the trace
+	static void SetThreadName(const std::string& name);
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+
+// Records an event from construction to destruction, if tracing was enabled at construction
+class TraceScope
+{
+	TraceScope(const TraceScope&) = delete; // non construction-copyable
+	TraceScope& operator=(const TraceScope&) = delete; // non copyable
+public:
+	TraceScope(const char* name, const char* category): m_name(nullptr)
+	{
+		if (Tracer::IsEnabled())
+		{
+			m_name = name;
+			m_category = category;
+			m_begin = Tracer::Now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (m_name != nullptr)
+		{
+			Tracer::Record(m_name, m_category, m_begin, Tracer::Now());
+		}
+	}
+
+private:
+	const char* m_name;
+	const char* m_category;
+	int64_t m_begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, category)
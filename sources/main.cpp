@@ -3,6 +3,21 @@
  * License: https://raw.githubusercontent.com/podgorskiy/bimpy/master/LICENSE.txt
  */
 #include "Camera2D.h"
+#include "Image.h"
+#include "TiledImage.h"
+#include "MipmapGenerator.h"
+#include "ImageLoader.h"
+#include "TextureCache.h"
+#include "AnnotationLayer.h"
+#include "SDFRenderer.h"
+#include "OffscreenContext.h"
+#include "Framebuffer.h"
+#include "BatchRenderer.h"
+#include "ShareGroup.h"
+#include "FrameTimer.h"
+#include "Tracer.h"
+#include "InputQueue.h"
+#include "Texture.h"
 #include "DebugRenderer.h"
 #include "simpletext.h"
 #include "GLDebugMessage.h"
@@ -22,14 +37,14 @@
 #include <pybind11/functional.h>
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
+#include <math.h>
+#include <stdio.h>
 #include <memory>
 #include <mutex>
 #include <spdlog/spdlog.h>
 
 namespace py = pybind11;
 
-typedef py::array_t<uint8_t, py::array::c_style> ndarray_uint8;
-
 enum SpecialKeys
 {
 	KeyEscape = 256,
@@ -45,155 +60,9 @@ enum SpecialKeys
 };
 
 
-class Image
-{
-public:
-	Image& operator=(const Image&) = delete;
-	Image(const Image&) = delete;
-
-	Image()
-	{
-		glGenTextures(1, &m_textureHandle);
-		m_width = -1;
-		m_height = -1;
-	}
-
-	Image(std::vector<ndarray_uint8> ims)
-	{
-		glGenTextures(1, &m_textureHandle);
-		m_width = -1;
-		m_height = -1;
-		SetImage(ims);
-	}
-
-	~Image()
-	{
-		glDeleteTextures(1, &m_textureHandle);
-	}
-
-	GLuint GetHandle() const
-	{
-		return m_textureHandle;
-	}
-
-	void GrayScaleToAlpha()
-	{
-		GLint swizzleMask[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
-		glBindTexture(GL_TEXTURE_2D, m_textureHandle);
-		glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
-
-	glm::vec2 GetSize() const
-	{
-		return glm::vec2(m_width, m_height);
-	}
-
-	ssize_t m_width;
-	ssize_t m_height;
-
-	void SetImage(std::vector<ndarray_uint8> ims)
-	{
-		// Render::debug_guard<> m_guard;
-		const py::buffer_info& ndarray_info = ims[0].request();
-		glBindTexture(GL_TEXTURE_2D, m_textureHandle);
-
-		GLint backup;
-		glGetIntegerv(GL_UNPACK_ALIGNMENT, &backup);
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-		GLint swizzleMask_R[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
-		GLint swizzleMask_RG[] = { GL_RED, GL_GREEN, GL_ZERO, GL_ONE };
-		GLint swizzleMask_RGB[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ONE };
-		GLint swizzleMask_RGBA[] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
-
-		if (ndarray_info.ndim == 2)
-		{
-			m_width = ndarray_info.shape[1];
-			m_height = ndarray_info.shape[0];
-			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_R);
-			int mipmap = 0;
-			for (auto im: ims)
-			{
-				glTexImage2D(GL_TEXTURE_2D, mipmap, GL_R8, im.request().shape[1], im.request().shape[0], 0, GL_RED, GL_UNSIGNED_BYTE, im.request().ptr);
-				mipmap += 1;
-			}
-		}
-		else if (ndarray_info.ndim == 3)
-		{
-			m_width = ndarray_info.shape[1];
-			m_height = ndarray_info.shape[0];
-			if (ndarray_info.shape[2] == 1)
-			{
-				glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_R);
-				int mipmap = 0;
-				for (auto im: ims)
-				{
-					glTexImage2D(GL_TEXTURE_2D, mipmap, GL_R8, im.request().shape[1], im.request().shape[0], 0, GL_RGB, GL_UNSIGNED_BYTE, im.request().ptr);
-					mipmap += 1;
-				}
-			}
-			else if (ndarray_info.shape[2] == 2)
-			{
-				glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_RG);
-				int mipmap = 0;
-				for (auto im: ims)
-				{
-					glTexImage2D(GL_TEXTURE_2D, mipmap, GL_RG8, im.request().shape[1], im.request().shape[0], 0, GL_RG, GL_UNSIGNED_BYTE, im.request().ptr);
-					mipmap += 1;
-				}
-			}
-			else if (ndarray_info.shape[2] == 3)
-			{
-				glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_RGB);
-				int mipmap = 0;
-				for (auto im: ims)
-				{
-					glTexImage2D(GL_TEXTURE_2D, mipmap, GL_SRGB8, im.request().shape[1], im.request().shape[0], 0, GL_RGB, GL_UNSIGNED_BYTE, im.request().ptr);
-					mipmap += 1;
-				}
-			}
-			else if (ndarray_info.shape[2] == 4)
-			{
-				glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask_RGBA);
-				int mipmap = 0;
-				for (auto im: ims)
-				{
-					glTexImage2D(GL_TEXTURE_2D, mipmap, GL_SRGB8_ALPHA8, im.request().shape[1], im.request().shape[0], 0, GL_RGBA, GL_UNSIGNED_BYTE, im.request().ptr);
-					mipmap += 1;
-				}
-			}
-			else
-			{
-				glBindTexture(GL_TEXTURE_2D, 0);
-				glPixelStorei(GL_UNPACK_ALIGNMENT, backup);
-				throw runtime_error("Wrong number of channels. Should be either 1, 2, 3, or 4, but got %d", (int)ndarray_info.shape[2]);
-			}
-		}
-		else
-		{
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glPixelStorei(GL_UNPACK_ALIGNMENT, backup);
-			throw runtime_error("Wrong number of dimensions. Should be either 2 or 3, but got %d", (int)ndarray_info.ndim);
-		}
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		if (ims.size() > 1)
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		else
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		glPixelStorei(GL_UNPACK_ALIGNMENT, backup);
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
-
-	GLuint m_textureHandle;
-};
-
-typedef std::shared_ptr<Image> ImagePtr;
 typedef std::shared_ptr<SimpleText> SimpleTextPtr;
+typedef py::array_t<float, py::array::c_style | py::array::forcecast> FloatArray;
+typedef py::array_t<uint8_t, py::array::c_style | py::array::forcecast> ByteArray;
 
 class Context
 {
@@ -208,29 +77,152 @@ public:
 	Context(const Context&) = delete;
 	Context() = default;
 
-	void Init(int width, int height, const std::string& name);
+	// If `offscreen` is True, there is no window, frames are rendered into a framebuffer of the given size.
+	// If `share` is given, GL objects are shared with it, so images created in one context can be drawn in the other.
+	// Both contexts have to be windows, or both offscreen
+	void Init(int width, int height, const std::string& name, bool offscreen, Context* share);
+	void InitOffscreen(int width, int height, Context* share);
+
+	// Makes the GL context current on the calling thread. Images created after that belong to its share group
+	void MakeCurrent();
 
 	void Resize(int width, int height, int display_w, int display_h);
 
 	void Recenter(RECENTER r);
 	void Recenter(float x0, float y0, float x1, float y1);
 
+	// Sets image to display. If the image has a pending asynchronous upload, the current one stays visible until it is done
+	void SetImage(ImagePtr image, bool recenter);
+	void SetImage(TiledImagePtr image, bool recenter);
+	void SetImage(Render::TexturePtr texture, bool recenter);
+	// Sets image from the texture cache. Returns the image, or nullptr if there is no image with such key
+	ImagePtr SetImage(const std::string& key, bool recenter);
+
+	// Image of the current view
+	bool HasImage() const;
+	glm::vec2 GetImageSize() const;
+	// Value of image data that is sampled as 1.0
+	float GetValueRange() const;
+	// True if any of the views has an image
+	bool HasAnyImage() const;
+
+	// Image and overlay shown in one viewport. All views are driven by the same camera, so they show the same region
+	struct View
+	{
+		bool HasImage() const;
+		glm::vec2 GetImageSize() const;
+		float GetValueRange() const;
+		bool IsSRGB() const;
+
+		ImagePtr image;
+		ImagePtr pendingImage;
+		bool pendingRecenter = false;
+		TiledImagePtr tiledImage;
+		Render::TexturePtr texture;
+		std::vector<TiledImage::DrawTile> tiles;
+		AnnotationLayer annotations;
+		// Renderer of point() and box() when m_useSdf is set. Nanovg is used otherwise, or if instancing is not supported
+		Render::SDFRenderer sdf;
+	};
+
+	// Lays out `count` views in a grid of `columns` columns, or of about square shape if `columns` is zero.
+	// Views that are added have no image, views that are removed are released. View 0 always exists
+	void SetViewCount(int count, int columns);
+	// Makes view `index` current: set_image, drawing calls and annotations apply to it
+	void SetCurrentView(int index);
+
+	// Size of one view in framebuffer pixels, which is the size of the framebuffer if there is one view
+	glm::ivec2 GetViewSize() const;
+	// Top left corner of the view in framebuffer pixels
+	glm::ivec2 GetViewOrigin(int index) const;
+	// View under framebuffer position, the nearest one if it is in a gap between them
+	int GetViewAt(glm::vec2 pos) const;
+	// Image to framebuffer transform of the view
+	glm::mat3 GetViewTransform(int index) const;
+	// Framebuffer position to image coordinates of the view under it
+	glm::vec2 WindowToImage(glm::vec2 pos) const;
+
 	void NewFrame();
 
 	void Render();
 
 	bool ShouldClose();
 
+	// In on-demand mode, blocks until there is something to redraw: input, camera change, pending upload or RequestRedraw.
+	// Returns false if it woke up by timeout with nothing to redraw, then the frame should be skipped.
+	// In continuous mode, returns true right away.
+	bool WaitForRedraw();
+
+	void RequestRedraw()
+	{
+		m_redraw = true;
+	}
+
+	// Called by input callbacks. Marks the window for redraw and remembers time of the first input since the last present
+	void OnInput()
+	{
+		m_redraw = true;
+		if (m_inputTime < 0.0)
+		{
+			m_inputTime = glfwGetTime();
+		}
+	}
+
+	// True while content changes without input, e.g. asynchronous upload or tile streaming is in progress
+	bool IsAnimating() const;
+
+	// Updates image-space rectangle that is visible in the window. Called when the camera or the window changes
+	void UpdateVisibleRect();
+	// Counts a primitive submitted with point, box or text_loc, returns false if it should be culled.
+	// `box` is in image space, `margin` is in framebuffer pixels and covers parts that do not scale with zoom, e.g. shadows
+	bool Submit(glm::aabb2 box, float margin);
+
+	// Labels are culled by their anchor point, text is assumed to extend this many framebuffer pixels from it at most
+	enum
+	{
+		LabelCullMargin = 512
+	};
+
 	int GetWidth() const;
 
 	int GetHeight() const;
 
-	void Point(float x, float y, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size) const;
-	void Box(float minx, float miny, float maxx, float maxy, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_stroke, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_fill) const;
+	void Point(float x, float y, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size);
+	// Point in framebuffer coordinates, clipped to `view`
+	void DrawPoint(View& view, int index, glm::vec2 point_pos, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size);
+	// Draws the image of the view with the camera, into the current GL viewport
+	void DrawImage(View& view);
+	// Clips nanovg paths that are recorded in between to the view, if there are several of them
+	void BeginViewScissor(int index);
+	void EndViewScissor();
+	// Point that is drawn under the mouse cursor. Cursor is sampled in Render, right before the frame is submitted
+	void CursorPoint(std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size);
+	void Box(float minx, float miny, float maxx, float maxy, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_stroke, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_fill);
+
+	// Batches of primitives from numpy arrays, see AnnotationLayer::Points. Geometry is built with the GIL released
+	void Points(FloatArray xy, ByteArray colors, FloatArray radii);
+	void Boxes(FloatArray boxes, ByteArray colors_stroke, ByteArray colors_fill);
+	void Lines(FloatArray segments, ByteArray colors, float width);
+
+	// Renders jobs (image, annotations, output path) in offscreen mode and writes them to files, see BatchRenderer.
+	// Image is a path, which is decoded on the workers, or an array. Annotations is None or a dict with optional "points",
+	// "boxes" and "lines" entries, which are tuples of arguments of Points, Boxes and Lines. Image of the context is replaced
+	BatchRenderer::Stats RenderBatch(py::list jobs, int threads, int quality);
 
 	~Context();
 
+	// Destroys the window after all GL objects of the context, GLFW is terminated with the last window
+	struct WindowDeleter
+	{
+		void operator()(GLFWwindow* window) const;
+	};
+	std::unique_ptr<GLFWwindow, WindowDeleter> m_windowOwner;
 	GLFWwindow* m_window = nullptr;
+	ShareGroupPtr m_shareGroup;
+	// Offscreen mode. Declared before all GL objects, so that the context outlives them
+	bool m_offscreen = false;
+	std::unique_ptr<Render::OffscreenContext> m_offscreenContext;
+	Render::Framebuffer m_framebuffer;
 	int m_width;
 	int m_height;
 	int m_display_w;
@@ -238,17 +230,79 @@ public:
 	py::function mouse_button_callback;
 	py::function mouse_position_callback;
 	py::function keyboard_callback;
+	// If true, input events are buffered and drained by python once per frame, instead of calling the callbacks above
+	// for each event
+	bool m_queueInput = false;
+	InputQueue m_input;
 
 	Camera2D m_camera;
 	Render::DebugRenderer m_dr;
-	ImagePtr m_image;
+	// Views in row-major order. m_view is the current one
+	std::vector<std::unique_ptr<View> > m_views;
+	View* m_view = nullptr;
+	int m_currentView = 0;
+	int m_viewColumns = 1;
+	int m_viewRows = 1;
+	// View that is under the cursor, or the one where panning has started
+	int m_cursorView = 0;
+	TextureCache m_cache;
+	bool m_useSdf = false;
+
+	// Culling of point, box and text_loc against the visible rectangle. Counters are for the current frame,
+	// and for the last rendered one
+	glm::aabb2 m_visibleRect;
+	bool m_culling = true;
+	uint64_t m_submitted = 0;
+	uint64_t m_drawn = 0;
+	uint64_t m_lastSubmitted = 0;
+	uint64_t m_lastDrawn = 0;
 	NVGcontext* vg = nullptr;
 	Render::VertexSpec m_spec;
 	Render::VertexBuffer m_buff;
 	Render::ProgramPtr m_program;
 	Render::Uniform u_modelViewProj;
 	Render::Uniform u_texture;
+	Render::Uniform u_window;
+	Render::Uniform u_uv;
+	Render::Uniform u_srgb;
+	Render::Uniform u_exposure;
+	Render::Uniform u_gamma;
+
+	// Display transform, done in the fragment shader. Sampled value is multiplied by 2^exposure,
+	// then range [level - window / 2, level + window / 2] is mapped to [0, 1] and the result is raised to 1 / gamma.
+	// Window and level are in units of image data, e.g. 0..65535 for uint16. If window is not positive, the full range is used.
+	float m_windowWidth = 0.0f;
+	float m_level = 0.0f;
+	float m_gamma = 1.0f;
+	float m_exposure = 0.0f;
 	SimpleTextPtr m_text;
+
+	// On-demand redraw. Active frames are the ones that were drawn, idle ones are wake-ups with nothing to draw
+	bool m_onDemand = false;
+	bool m_redraw = true;
+	double m_idleTimeout = 0.5;
+	uint64_t m_activeFrames = 0;
+	uint64_t m_idleFrames = 0;
+
+	// Low latency mode: input is polled right before drawing instead of after swap, and the CPU waits for the GPU
+	// after swap, so that the driver does not queue frames
+	bool m_lowLatency = false;
+	int m_swapInterval = 1;
+	int m_appliedSwapInterval = -1;
+	std::vector<std::pair<std::tuple<uint8_t, uint8_t, uint8_t, uint8_t>, float> > m_cursorPoints;
+
+	// Input-to-present latency in milliseconds, measured from the first input event since the previous present,
+	// until swap returned, or until the GPU finished the frame in low latency mode
+	double m_inputTime = -1.0;
+	double m_inputLatency = 0.0;
+	double m_inputLatencySum = 0.0;
+	uint64_t m_inputLatencyCount = 0;
+
+	// CPU and GPU time of the stages of the last frames, and whether it is shown as a graph over the image
+	Render::FrameTimer m_frameTimer;
+	bool m_showFrameStats = false;
+	// Graph of the stage times of the last frames, in the bottom left corner
+	void DrawFrameStats();
 };
 
 struct Vertex
@@ -257,111 +311,193 @@ struct Vertex
 	glm::vec2 uv;
 };
 
-void Context::Init(int width, int height, const std::string& name)
+// Number of windows of all contexts
+static int windowCount = 0;
+
+void Context::WindowDeleter::operator()(GLFWwindow* window) const
+{
+	glfwDestroyWindow(window);
+	if (--windowCount == 0)
+	{
+		glfwTerminate();
+	}
+}
+
+void Context::Init(int width, int height, const std::string& name, bool offscreen, Context* share)
 {
-	if (nullptr == m_window)
+	if (share != nullptr && share->m_window == nullptr && !share->m_offscreen)
+	{
+		throw runtime_error("Context to share objects with is not initialized");
+	}
+	if (share != nullptr && share->m_offscreen != offscreen)
+	{
+		throw runtime_error("Window and offscreen contexts can not share objects");
+	}
+	// GL calls are made on this thread
+	Tracer::SetThreadName("render");
+	if (nullptr == m_window && !m_offscreen)
 	{
-		if (!glfwInit())
+		if (offscreen)
 		{
-			throw runtime_error("GLFW initialization failed.\nThis may happen if you try to run bimpy on a headless machine ");
+			InitOffscreen(width, height, share);
 		}
+		else
+		{
+			if (!glfwInit())
+			{
+				throw runtime_error("GLFW initialization failed.\nThis may happen if you try to run bimpy on a headless machine ");
+			}
 
-		glfwWindowHint(GLFW_DEPTH_BITS, 24);
-		glfwWindowHint(GLFW_RED_BITS, 8);
+			glfwWindowHint(GLFW_DEPTH_BITS, 24);
+			glfwWindowHint(GLFW_RED_BITS, 8);
 #if __APPLE__
-		// GL 3.2 + GLSL 150
-		// const char* glsl_version = "#version 150";
-		// glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-		// glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-		// glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
-		// glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
+			// GL 3.2 + GLSL 150
+			// const char* glsl_version = "#version 150";
+			// glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			// glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+			// glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
+			// glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
 #else
-		// GL 3.0 + GLSL 130
-		const char* glsl_version = "#version 130";
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+			// GL 3.0 + GLSL 130
+			const char* glsl_version = "#version 130";
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
 
-		//glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
-		//glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
+			//glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
+			//glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // 3.0+ only
 #endif
-		glfwWindowHint(GLFW_SRGB_CAPABLE, 1);
+			glfwWindowHint(GLFW_SRGB_CAPABLE, 1);
 
-		m_window = glfwCreateWindow(width, height, name.c_str(), NULL, NULL);
-	    if (!m_window)
-	    {
-	        glfwTerminate();
-			throw runtime_error("GLFW failed to create window.\nThis may happen if you try to run bimpy on a headless machine ");
-	    }
-
-		glfwMakeContextCurrent(m_window);
-		if (gl3wInit() != GL3W_OK)
-		{
-			// throw runtime_error("GL3W initialization failed.\nThis may happen if you try to run bimpy on a headless machine ");
-		}
+			m_window = glfwCreateWindow(width, height, name.c_str(), NULL, share != nullptr ? share->m_window : NULL);
+		    if (!m_window)
+		    {
+				if (windowCount == 0)
+				{
+					glfwTerminate();
+				}
+				throw runtime_error("GLFW failed to create window.\nThis may happen if you try to run bimpy on a headless machine ");
+		    }
 
-		// Render::debug_guard<> m_guard;
-		m_dr.Init();
+			m_windowOwner.reset(m_window);
+			++windowCount;
 
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glfwMakeContextCurrent(m_window);
+			if (gl3wInit() != GL3W_OK)
+			{
+				// throw runtime_error("GL3W initialization failed.\nThis may happen if you try to run bimpy on a headless machine ");
+			}
 
-		m_width = width;
-		m_height = height;
+			m_width = width;
+			m_height = height;
 
-		glfwGetWindowSize(m_window, &m_width, &m_height);
-		glfwGetFramebufferSize(m_window, &m_display_w, &m_display_h);
+			glfwGetWindowSize(m_window, &m_width, &m_height);
+			glfwGetFramebufferSize(m_window, &m_display_w, &m_display_h);
 
-		glfwSetWindowUserPointer(m_window, this); // replaced m_imp.get()
+			glfwSetWindowUserPointer(m_window, this); // replaced m_imp.get()
 
-		glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int width, int height)
-		{
-			Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
-		    int display_w, display_h;
-		    glfwGetFramebufferSize(window, &display_w, &display_h);
-		    ctx->Resize(width, height, display_w, display_h);
-		});
+			glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int width, int height)
+			{
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->m_redraw = true;
+			    int display_w, display_h;
+			    glfwGetFramebufferSize(window, &display_w, &display_h);
+			    ctx->Resize(width, height, display_w, display_h);
+			});
+
+			// Events may be processed while the GIL is released, see WaitForRedraw
+			glfwSetKeyCallback(m_window, [](GLFWwindow* window, int key, int, int action, int mods)
+			{
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->OnInput();
+				if (ctx->m_queueInput)
+				{
+					ctx->m_input.PushKey(glfwGetTime(), key, action, mods);
+					return;
+				}
 
-		glfwSetKeyCallback(m_window, [](GLFWwindow* window, int key, int, int action, int mods)
-		{
-			Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				py::gil_scoped_acquire acquire;
+				ctx->keyboard_callback(key, action, mods);
+			});
 
-			ctx->keyboard_callback(key, action, mods);
-		});
+			glfwSetCharCallback(m_window, [](GLFWwindow*, unsigned int c)
+			{
+			});
 
-		glfwSetCharCallback(m_window, [](GLFWwindow*, unsigned int c)
-		{
-		});
+			glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window)
+			{
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->m_redraw = true;
+			});
 
-		glfwSetScrollCallback(m_window, [](GLFWwindow* window, double /*xoffset*/, double yoffset)
-		{
-			Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+			glfwSetScrollCallback(m_window, [](GLFWwindow* window, double /*xoffset*/, double yoffset)
+			{
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->OnInput();
+				if (ctx->m_queueInput)
+				{
+					double x, y;
+					glfwGetCursorPos(window, &x, &y);
+					glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
+					// Position in the image under the cursor before the zoom
+					auto local = ctx->WindowToImage(cursorposition);
+					ctx->m_input.PushScroll(glfwGetTime(), float(yoffset), cursorposition.x, cursorposition.y, local.x, local.y);
+				}
 
-			ctx->m_camera.Scroll(float(-yoffset));
-		});
+				ctx->m_camera.Scroll(float(-yoffset));
+			});
 
-		glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int button, int action, int /*mods*/)
-		{
-			Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
-			if (button == 1)
-				ctx->m_camera.TogglePanning(action == GLFW_PRESS);
-			if (button == 0 && ctx->mouse_button_callback)
+			glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int button, int action, int mods)
 			{
-				double x, y;
-				glfwGetCursorPos(window, &x, &y);
-				glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
-				auto local = glm::vec2(ctx->m_camera.GetWorldToCanvas() * glm::vec3(cursorposition, 1.0f));
-				ctx->mouse_button_callback(action == GLFW_PRESS, cursorposition.x, cursorposition.y, local.x, local.y);
-			}
-		});
-		glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double x, double y)
-		{
-			Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
-			if (ctx->mouse_position_callback)
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->OnInput();
+				if (button == 1)
+					ctx->m_camera.TogglePanning(action == GLFW_PRESS);
+				if (ctx->m_queueInput)
+				{
+					double x, y;
+					glfwGetCursorPos(window, &x, &y);
+					glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
+					auto local = ctx->WindowToImage(cursorposition);
+					ctx->m_input.PushButton(glfwGetTime(), button, action, mods, cursorposition.x, cursorposition.y, local.x, local.y);
+				}
+				else if (button == 0 && ctx->mouse_button_callback)
+				{
+					double x, y;
+					glfwGetCursorPos(window, &x, &y);
+					glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
+					auto local = ctx->WindowToImage(cursorposition);
+					py::gil_scoped_acquire acquire;
+					ctx->mouse_button_callback(action == GLFW_PRESS, cursorposition.x, cursorposition.y, local.x, local.y);
+				}
+			});
+			glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double x, double y)
 			{
-				glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
-				auto local = glm::vec2(ctx->m_camera.GetWorldToCanvas() * glm::vec3(cursorposition, 1.0f));
-				ctx->mouse_position_callback(cursorposition.x, cursorposition.y, local.x, local.y);
-			}
-		});
+				Context* ctx = static_cast<Context*>(glfwGetWindowUserPointer(window));
+				ctx->OnInput();
+				if (ctx->m_queueInput)
+				{
+					glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
+					auto local = ctx->WindowToImage(cursorposition);
+					ctx->m_input.PushMove(glfwGetTime(), cursorposition.x, cursorposition.y, local.x, local.y);
+				}
+				else if (ctx->mouse_position_callback)
+				{
+					glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(ctx->m_display_w, ctx->m_display_h) / glm::vec2(ctx->m_width, ctx->m_height);
+					auto local = ctx->WindowToImage(cursorposition);
+					py::gil_scoped_acquire acquire;
+					ctx->mouse_position_callback(cursorposition.x, cursorposition.y, local.x, local.y);
+				}
+			});
+		}
+
+		m_shareGroup = share != nullptr ? share->m_shareGroup : std::make_shared<ShareGroup>();
+		m_shareGroup->m_contextCount += 1;
+		ShareGroup::SetCurrent(m_shareGroup);
+
+		// Render::debug_guard<> m_guard;
+		m_dr.Init();
+
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
 		vg = nvgCreateContext(NVG_ANTIALIAS | NVG_STENCIL_STROKES | NVG_DEBUG);
 		if (vg == nullptr)
@@ -384,8 +520,26 @@ void Context::Init(int width, int height, const std::string& name)
 
 		const char* fragment_shader_src = R"(
 			uniform sampler2D u_texture;
+			// x - low end of the window, y - reciprocal of the window width
+			uniform vec2 u_window;
+			uniform float u_exposure;
+			uniform float u_gamma;
+			// xy - offset, zw - size of the part of the texture that is drawn on the quad
+			uniform vec4 u_uv;
+			// 1.0 if the texture is sRGB encoded, 0.0 otherwise
+			uniform float u_srgb;
 			varying vec2 v_pos;
 
+			vec3 to_srgb(vec3 c)
+			{
+				return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c));
+			}
+
+			vec3 to_linear(vec3 c)
+			{
+				return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+			}
+
 			vec3 sample(vec2 q)
 			{
 				vec4 color = texture2D(u_texture, q, -0.3);
@@ -395,7 +549,19 @@ void Context::Init(int width, int height, const std::string& name)
 			void main()
 			{
 				vec2 q = v_pos * vec2(0.5, 0.5);
-			    vec3 color = sample(vec2(0.5) + q).rgb;
+			    vec3 color = sample(u_uv.xy + (vec2(0.5) + q) * u_uv.zw).rgb;
+				// Sampling decodes sRGB textures, but the window is in units of the stored data, so it is applied to
+				// encoded values, and the result is decoded back, which keeps the full window an identity
+				if (u_srgb > 0.5)
+				{
+					color = to_srgb(color);
+				}
+				color = (color * u_exposure - u_window.x) * u_window.y;
+				color = pow(clamp(color, 0.0, 1.0), vec3(1.0 / u_gamma));
+				if (u_srgb > 0.5)
+				{
+					color = to_linear(color);
+				}
 				gl_FragColor = vec4(color, 1.0);
 			}
 		)";
@@ -403,6 +569,11 @@ void Context::Init(int width, int height, const std::string& name)
 		m_program = Render::MakeProgram(vertex_shader_src, fragment_shader_src);
 		u_modelViewProj = m_program->GetUniform("u_modelViewProj");
 		u_texture = m_program->GetUniform("u_texture");
+		u_window = m_program->GetUniform("u_window");
+		u_exposure = m_program->GetUniform("u_exposure");
+		u_gamma = m_program->GetUniform("u_gamma");
+		u_uv = m_program->GetUniform("u_uv");
+		u_srgb = m_program->GetUniform("u_srgb");
 		std::vector<glm::vec2> vertices = {
 				{-1.0f, -1.0f},
 				{ 1.0f, -1.0f},
@@ -423,188 +594,815 @@ void Context::Init(int width, int height, const std::string& name)
 		m_spec = Render::VertexSpecMaker().PushType<glm::vec2>("a_position");
 
 		m_text.reset(new SimpleText);
+		SetViewCount(1, 0);
+		m_frameTimer.Init();
 	}
 }
 
 
-void Context::Recenter(RECENTER r)
+void Context::SetImage(ImagePtr image, bool recenter)
 {
-	if (!m_image)
+	if (image->GetShareGroup() && image->GetShareGroup() != m_shareGroup)
 	{
-		throw std::runtime_error("No image assigned");
+		throw runtime_error("Image was created in another context, which does not share objects with this one");
 	}
-	auto size = m_image->GetSize();
-	if (r == RECENTER::FIT_DOCUMENT)
+	m_redraw = true;
+	if (!image->IsReady())
 	{
-		glm::vec2 r = glm::vec2(m_display_w, m_display_h) / glm::vec2(size);
-
-		if (m_display_w * 1.0f / m_display_h > size.x * 1.0f / size.y)
-		{
-			m_camera.SetFOV(size.y * 1.2f / m_display_h);
-		}
-		else
+		if (HasImage())
 		{
-			m_camera.SetFOV(size.x * 1.2f / m_display_w);
+			m_view->pendingImage = image;
+			m_view->pendingRecenter = recenter;
+			return;
 		}
+		// Nothing to show in the meantime
+		image->Finish();
 	}
-	else
+	m_view->pendingImage.reset();
+	m_view->tiledImage.reset();
+	m_view->texture.reset();
+	m_view->image = image;
+	if (recenter)
 	{
-		m_camera.SetFOV(1.0f);
+		Recenter(Context::FIT_DOCUMENT);
 	}
-
-	auto clientArea = glm::vec2(m_display_w, m_display_h);
-
-	clientArea = glm::ivec2(glm::vec2(clientArea) * m_camera.GetFOV());
-
-	auto pos = glm::vec2(clientArea - size) / 2.0f;
-	m_camera.SetPos(pos);
 }
 
 
-void Context::Recenter(float x0, float y0, float x1, float y1)
+void Context::SetImage(TiledImagePtr image, bool recenter)
 {
-	if (!m_image)
+	if (image->GetShareGroup() && image->GetShareGroup() != m_shareGroup)
 	{
-		throw std::runtime_error("No image assigned");
+		throw runtime_error("Image was created in another context, which does not share objects with this one");
 	}
-	auto p0 = glm::vec2(x0, y0);
-	auto p1 = glm::vec2(x1, y1);
-	auto size = p1 - p0;
+	m_redraw = true;
+	m_view->pendingImage.reset();
+	m_view->image.reset();
+	m_view->texture.reset();
+	m_view->tiledImage = image;
+	if (recenter)
+	{
+		Recenter(Context::FIT_DOCUMENT);
+	}
+}
 
-	glm::vec2 r = glm::vec2(m_display_w, m_display_h) / glm::vec2(size);
 
-	if (m_display_w * 1.0f / m_display_h > size.x * 1.0f / size.y)
+void Context::SetImage(Render::TexturePtr texture, bool recenter)
+{
+	if (texture->GetShareGroup() && texture->GetShareGroup() != m_shareGroup)
 	{
-		m_camera.SetFOV(size.y * 1.2f / m_display_h);
+		throw runtime_error("Texture was created in another context, which does not share objects with this one");
 	}
-	else
+	m_redraw = true;
+	m_view->pendingImage.reset();
+	m_view->image.reset();
+	m_view->tiledImage.reset();
+	m_view->texture = texture;
+	if (recenter)
 	{
-		m_camera.SetFOV(size.x * 1.2f / m_display_w);
+		Recenter(Context::FIT_DOCUMENT);
 	}
+}
 
-	auto clientArea = glm::vec2(m_display_w, m_display_h);
-
-	clientArea = glm::ivec2(glm::vec2(clientArea) * m_camera.GetFOV());
 
-	auto pos = glm::vec2(clientArea - size) / 2.0f;
-	m_camera.SetPos(pos - p0);
+ImagePtr Context::SetImage(const std::string& key, bool recenter)
+{
+	auto image = m_cache.Get(key);
+	if (image)
+	{
+		SetImage(image, recenter);
+	}
+	return image;
 }
 
 
-Context::~Context()
+bool Context::View::HasImage() const
 {
-	glfwSetWindowSizeCallback(m_window, nullptr);
-	glfwTerminate();
+	return image || tiledImage || texture;
 }
 
 
-void Context::Render()
+glm::vec2 Context::View::GetImageSize() const
 {
-	auto size = m_image->GetSize();
-
-	auto transform = m_camera.GetTransform();
-	glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3((size.x + 1) / 2.0f,  (size.y + 1) / 2.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), glm::vec3(1.0, 1.0, 0.0f));
-	model[3].x -= 0.5;
-	model[3].y -= 0.5;
-	// Render::DrawRect(m_dr, glm::vec2(-1.0f), glm::vec&Image::2(1.0f), transform * model);
+	if (texture)
 	{
-		m_program->Use();
-		u_modelViewProj.ApplyValue(transform * model);
-		u_texture.ApplyValue(0);
-		glBindTexture(GL_TEXTURE_2D, m_image->GetHandle());
+		return glm::vec2(texture->GetSize());
+	}
+	return tiledImage ? tiledImage->GetSize() : image->GetSize();
+}
 
-		m_buff.Bind();
-		m_spec.Enable();
-		m_buff.DrawElements();
-		m_buff.UnBind();
-		m_spec.Disable();
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+float Context::View::GetValueRange() const
+{
+	if (texture)
+	{
+		auto type = texture->GetFormat().type;
+		return Render::TextureFormat::IsFloat(type) ? 1.0f : (Render::TextureFormat::IsShort(type) ? 65535.0f : 255.0f);
 	}
+	return tiledImage ? 255.0f : image->GetValueRange();
+}
 
+
+bool Context::View::IsSRGB() const
+{
+	if (texture)
 	{
-		auto transform = m_camera.GetCanvasToWorld();
+		auto format = texture->GetFormat();
+		// Only 8-bit formats have sRGB variants
+		return format.colorspace == Render::TextureFormat::sRGB && Render::TextureFormat::IsByte(format.type);
+	}
+	return tiledImage ? tiledImage->IsSRGB() : image->IsSRGB();
+}
 
-		glm::vec2 pos = transform * glm::vec3(-0.5, -0.5, 1);
-		size = transform * glm::vec3(size + 1.0f, 0);
 
+bool Context::HasImage() const
+{
+	return m_view->HasImage();
+}
 
-		float margin = size.x * 0.3;
-		NVGpaint shadowPaint = nvgBoxGradient(
-				vg, pos.x, pos.y, size.x, size.y, 0, margin * 0.03,
-				{0, 0, 0, 1.0f}, {0, 0, 0, 0});
 
-		nvgSave(vg);
-		nvgResetScissor(vg);
-		nvgBeginPath(vg);
-		nvgRect(vg, pos.x - margin, pos.y - margin, size.x + 2 * margin, size.y + 2 * margin);
-		nvgRect(vg, pos.x, pos.y, size.x, size.y);
-		nvgPathWinding(vg, NVG_HOLE);
-		nvgFillPaint(vg, shadowPaint);
-		nvgFill(vg);
-		nvgRestore(vg);
-		nvgEndFrame(vg);
-	}
+glm::vec2 Context::GetImageSize() const
+{
+	return m_view->GetImageSize();
+}
 
-	m_text->EnableBlending(true);
-	m_text->Render();
 
-	glfwSwapInterval(1);
-	glfwSwapBuffers(m_window);
-	glfwPollEvents();
+float Context::GetValueRange() const
+{
+	return m_view->GetValueRange();
 }
 
 
-void Context::NewFrame()
+bool Context::HasAnyImage() const
 {
-	glm::vec2 cursorposition;
+	for (auto& view: m_views)
 	{
-		double x, y;
-		glfwGetCursorPos(m_window, &x, &y);
-		cursorposition = glm::vec2(x, y) * glm::vec2(m_display_w, m_display_h) / glm::vec2(m_width, m_height);
+		if (view->HasImage())
+		{
+			return true;
+		}
 	}
-	m_camera.Move(cursorposition.x, cursorposition.y);
-	m_camera.UpdateViewProjection(m_display_w, m_display_h);
+	return false;
+}
+
 
-	if (!m_image)
+void Context::SetViewCount(int count, int columns)
+{
+	if (count < 1)
 	{
-		throw std::runtime_error("No image assigned");
+		throw runtime_error("There should be at least one view, got %d", count);
 	}
-	glfwMakeContextCurrent(m_window);
-	Render::debug_guard<> m_guard;
-	glViewport(0, 0, m_display_w, m_display_h);
-	glClear(GL_COLOR_BUFFER_BIT);
-	glEnable(GL_FRAMEBUFFER_SRGB);
-	nvgBeginFrame(vg, m_display_w, m_display_h, 1.0f);
+	if (columns <= 0)
+	{
+		columns = (int)ceilf(sqrtf(float(count)));
+	}
+	columns = std::min(columns, count);
+	// Images are released in this context
+	MakeCurrent();
+	while ((int)m_views.size() > count)
+	{
+		m_views.pop_back();
+	}
+	while ((int)m_views.size() < count)
+	{
+		std::unique_ptr<View> view(new View);
+		view->annotations.Init();
+		view->sdf.Init();
+		m_views.push_back(std::move(view));
+	}
+	m_viewColumns = columns;
+	m_viewRows = (count + columns - 1) / columns;
+	SetCurrentView(std::min(m_currentView, count - 1));
+	m_camera.UpdateViewProjection(GetViewSize().x, GetViewSize().y);
+	UpdateVisibleRect();
+	m_redraw = true;
 }
 
 
-void Context::Resize(int width, int height, int display_w, int display_h)
+void Context::SetCurrentView(int index)
 {
-	if (!m_image)
+	if (index < 0 || index >= (int)m_views.size())
 	{
-		throw std::runtime_error("No image assigned");
+		throw runtime_error("View index %d is out of range, there are %d views", index, (int)m_views.size());
 	}
-	auto oldWindowBufferSize = glm::vec2(m_display_w, m_display_h);
-	m_width = width;
+	m_currentView = index;
+	m_view = m_views[index].get();
+}
+
+
+glm::ivec2 Context::GetViewSize() const
+{
+	return glm::max(glm::ivec2(m_display_w / m_viewColumns, m_display_h / m_viewRows), glm::ivec2(1));
+}
+
+
+glm::ivec2 Context::GetViewOrigin(int index) const
+{
+	return glm::ivec2(index % m_viewColumns, index / m_viewColumns) * GetViewSize();
+}
+
+
+int Context::GetViewAt(glm::vec2 pos) const
+{
+	glm::ivec2 cell = glm::ivec2(glm::floor(pos / glm::vec2(GetViewSize())));
+	cell = glm::clamp(cell, glm::ivec2(0), glm::ivec2(m_viewColumns - 1, m_viewRows - 1));
+	return std::min(cell.y * m_viewColumns + cell.x, (int)m_views.size() - 1);
+}
+
+
+glm::mat3 Context::GetViewTransform(int index) const
+{
+	glm::vec2 origin = GetViewOrigin(index);
+	return glm::mat3(1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, origin.x, origin.y, 1.0f) * m_camera.GetCanvasToWorld();
+}
+
+
+glm::vec2 Context::WindowToImage(glm::vec2 pos) const
+{
+	return glm::inverse(GetViewTransform(GetViewAt(pos))) * glm::vec3(pos, 1.0f);
+}
+
+
+void Context::Recenter(RECENTER r)
+{
+	m_redraw = true;
+	if (!HasImage())
+	{
+		throw std::runtime_error("No image assigned");
+	}
+	auto size = GetImageSize();
+	glm::vec2 viewport = GetViewSize();
+	if (r == RECENTER::FIT_DOCUMENT)
+	{
+		glm::vec2 r = viewport / glm::vec2(size);
+
+		if (viewport.x / viewport.y > size.x * 1.0f / size.y)
+		{
+			m_camera.SetFOV(size.y * 1.2f / viewport.y);
+		}
+		else
+		{
+			m_camera.SetFOV(size.x * 1.2f / viewport.x);
+		}
+	}
+	else
+	{
+		m_camera.SetFOV(1.0f);
+	}
+
+	auto clientArea = viewport;
+
+	clientArea = glm::ivec2(glm::vec2(clientArea) * m_camera.GetFOV());
+
+	auto pos = glm::vec2(clientArea - size) / 2.0f;
+	m_camera.SetPos(pos);
+	UpdateVisibleRect();
+}
+
+
+void Context::Recenter(float x0, float y0, float x1, float y1)
+{
+	m_redraw = true;
+	if (!HasImage())
+	{
+		throw std::runtime_error("No image assigned");
+	}
+	auto p0 = glm::vec2(x0, y0);
+	auto p1 = glm::vec2(x1, y1);
+	auto size = p1 - p0;
+	glm::vec2 viewport = GetViewSize();
+
+	glm::vec2 r = viewport / glm::vec2(size);
+
+	if (viewport.x / viewport.y > size.x * 1.0f / size.y)
+	{
+		m_camera.SetFOV(size.y * 1.2f / viewport.y);
+	}
+	else
+	{
+		m_camera.SetFOV(size.x * 1.2f / viewport.x);
+	}
+
+	auto clientArea = viewport;
+
+	clientArea = glm::ivec2(glm::vec2(clientArea) * m_camera.GetFOV());
+
+	auto pos = glm::vec2(clientArea - size) / 2.0f;
+	m_camera.SetPos(pos - p0);
+	UpdateVisibleRect();
+}
+
+
+void Context::InitOffscreen(int width, int height, Context* share)
+{
+	m_offscreenContext = Render::OffscreenContext::Create(share != nullptr ? share->m_offscreenContext.get() : nullptr);
+	if (!m_offscreenContext)
+	{
+		throw runtime_error("Could not create offscreen OpenGL context.\nIt needs EGL with desktop OpenGL, e.g. Mesa with llvmpipe, on Linux");
+	}
+	if (gl3wInit2(&Render::OffscreenContext::GetProcAddress) != GL3W_OK)
+	{
+		throw runtime_error("GL3W initialization failed for offscreen context");
+	}
+	m_offscreen = true;
+	m_width = m_display_w = width;
+	m_height = m_display_h = height;
+	m_framebuffer.Resize(width, height);
+}
+
+
+Context::~Context()
+{
+	if (m_window)
+	{
+		glfwSetWindowSizeCallback(m_window, nullptr);
+	}
+	// GL objects of the context are deleted after this, while the window or the offscreen context still exists,
+	// so its context has to be current, not of another window
+	MakeCurrent();
+	m_cache.Clear();
+	if (m_shareGroup)
+	{
+		m_shareGroup->m_contextCount -= 1;
+		if (m_shareGroup->m_contextCount == 0)
+		{
+			m_shareGroup->ReleaseGLObjects();
+		}
+	}
+}
+
+
+void Context::MakeCurrent()
+{
+	if (m_window)
+	{
+		glfwMakeContextCurrent(m_window);
+	}
+	else if (m_offscreenContext)
+	{
+		m_offscreenContext->MakeCurrent();
+	}
+	ShareGroup::SetCurrent(m_shareGroup);
+}
+
+
+void Context::DrawImage(View& view)
+{
+	auto size = view.GetImageSize();
+
+	auto transform = m_camera.GetTransform();
+	glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3((size.x + 1) / 2.0f,  (size.y + 1) / 2.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), glm::vec3(1.0, 1.0, 0.0f));
+	model[3].x -= 0.5;
+	model[3].y -= 0.5;
+	glm::vec2 window(0.0f, 1.0f);
+	if (m_windowWidth > 0.0f)
+	{
+		float range = view.GetValueRange();
+		window = glm::vec2((m_level - m_windowWidth / 2.0f) / range, range / m_windowWidth);
+	}
+	m_program->Use();
+	u_window.ApplyValue(window);
+	u_exposure.ApplyValue(exp2f(m_exposure));
+	u_gamma.ApplyValue(m_gamma > 0.0f ? m_gamma : 1.0f);
+	u_srgb.ApplyValue(view.IsSRGB() ? 1.0f : 0.0f);
+
+	if (view.image || view.texture)
+	{
+		u_modelViewProj.ApplyValue(transform * model);
+		u_texture.ApplyValue(0);
+		u_uv.ApplyValue(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+		glBindTexture(GL_TEXTURE_2D, view.image ? view.image->GetHandle() : view.texture->GetHandle());
+
+		m_buff.Bind();
+		m_spec.Enable();
+		m_buff.DrawElements();
+		m_buff.UnBind();
+		m_spec.Disable();
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else
+	{
+		auto w2c = m_camera.GetWorldToCanvas();
+		glm::vec2 view_min = w2c * glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec2 view_max = w2c * glm::vec3(GetViewSize(), 1.0f);
+		view.tiledImage->Update(view_min, view_max, 1.0f / m_camera.GetFOV(), view.tiles);
+
+		u_texture.ApplyValue(0);
+		m_buff.Bind();
+		m_spec.Enable();
+		for (auto& tile: view.tiles)
+		{
+			glm::vec2 center = (tile.min + tile.max) / 2.0f;
+			glm::vec2 half_size = (tile.max - tile.min) / 2.0f;
+			glm::mat4 tile_model = glm::translate(glm::mat4(1.0f), glm::vec3(center, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(half_size, 1.0f));
+			u_modelViewProj.ApplyValue(transform * tile_model);
+			u_uv.ApplyValue(tile.uv);
+			glBindTexture(GL_TEXTURE_2D, tile.handle);
+			m_buff.DrawElements();
+		}
+		m_buff.UnBind();
+		m_spec.Disable();
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+
+void Context::DrawFrameStats()
+{
+	// Stacked bars of CPU time of the stages, one bar per frame with the newest on the right, over two frames at 60 Hz.
+	// Legend has CPU and GPU time of the stages, averaged over the history
+	static const uint8_t colors[Render::FrameTimer::StageCount][3] = {
+		{ 90, 160, 255 }, { 255, 200, 60 }, { 255, 140, 200 }, { 100, 220, 120 }, { 240, 110, 90 }, { 200, 130, 240 },
+		{ 150, 150, 150 }
+	};
+	const float bar_width = 2.0f;
+	const float height = 120.0f;
+	const float range = 2000.0f / 60.0f;
+	const float scale = height / range;
+
+	auto history = m_frameTimer.GetHistory();
+	glm::vec2 origin(10.0f, m_display_h - 10.0f);
+	float width = bar_width * Render::FrameTimer::HistorySize;
+	float x0 = origin.x + width - bar_width * history.size();
+
+	nvgSave(vg);
+	nvgResetScissor(vg);
+	nvgBeginPath(vg);
+	nvgRect(vg, origin.x, origin.y - height, width, height);
+	nvgFillColor(vg, nvgRGBA(0, 0, 0, 160));
+	nvgFill(vg);
+
+	std::vector<float> bottom(history.size(), 0.0f);
+	for (int stage = 0; stage < Render::FrameTimer::StageCount; ++stage)
+	{
+		nvgBeginPath(vg);
+		for (size_t i = 0; i < history.size(); ++i)
+		{
+			float top = std::min(bottom[i] + float(history[i].cpu[stage]) * scale, height);
+			if (top > bottom[i])
+			{
+				nvgRect(vg, x0 + bar_width * i, origin.y - top, bar_width, top - bottom[i]);
+			}
+			bottom[i] = top;
+		}
+		nvgFillColor(vg, nvgRGBA(colors[stage][0], colors[stage][1], colors[stage][2], 220));
+		nvgFill(vg);
+	}
+
+	nvgBeginPath(vg);
+	nvgMoveTo(vg, origin.x, origin.y - height / 2.0f);
+	nvgLineTo(vg, origin.x + width, origin.y - height / 2.0f);
+	nvgStrokeColor(vg, nvgRGBA(255, 255, 255, 120));
+	nvgStrokeWidth(vg, 1.0f);
+	nvgStroke(vg);
+	nvgRestore(vg);
+
+	for (int stage = 0; stage < Render::FrameTimer::StageCount; ++stage)
+	{
+		double cpu = 0.0, gpu = 0.0;
+		int gpu_count = 0;
+		for (auto& frame: history)
+		{
+			cpu += frame.cpu[stage];
+			if (frame.gpu[stage] >= 0.0)
+			{
+				gpu += frame.gpu[stage];
+				++gpu_count;
+			}
+		}
+		cpu /= std::max(history.size(), size_t(1));
+		char label[128];
+		if (gpu_count != 0)
+		{
+			snprintf(label, sizeof(label), "%-12s cpu %6.2f gpu %6.2f ms", Render::FrameTimer::GetStageName(stage), cpu, gpu / gpu_count);
+		}
+		else
+		{
+			snprintf(label, sizeof(label), "%-12s cpu %6.2f ms", Render::FrameTimer::GetStageName(stage), cpu);
+		}
+		m_text->SetColorf(SimpleText::TEXT_COLOR, colors[stage][0] / 255.f, colors[stage][1] / 255.f, colors[stage][2] / 255.f, 1.0f);
+		m_text->SetColorf(SimpleText::BACKGROUND_COLOR, 0.0f, 0.0f, 0.0f, 0.6f);
+		m_text->EnableBlending(true);
+		m_text->Label(label, origin.x, origin.y - height - 16.0f * (Render::FrameTimer::StageCount - stage), SimpleText::LEFT);
+		m_text->ResetFont();
+	}
+}
+
+
+void Context::Render()
+{
+	// on_update may have made another context current, e.g. by setting an image in another application
+	MakeCurrent();
+	m_frameTimer.End(Render::FrameTimer::Update);
+	m_frameTimer.Begin(Render::FrameTimer::Images);
+	bool multiview = m_views.size() > 1;
+
+	// Shadows around the images, recorded first, so that they are under the cursor points
+	for (int i = 0; i < (int)m_views.size(); ++i)
+	{
+		View& view = *m_views[i];
+		if (!view.HasImage())
+		{
+			continue;
+		}
+		auto transform = GetViewTransform(i);
+
+		glm::vec2 pos = transform * glm::vec3(-0.5, -0.5, 1);
+		glm::vec2 size = transform * glm::vec3(view.GetImageSize() + 1.0f, 0);
+
+		float margin = size.x * 0.3;
+		NVGpaint shadowPaint = nvgBoxGradient(
+				vg, pos.x, pos.y, size.x, size.y, 0, margin * 0.03,
+				{0, 0, 0, 1.0f}, {0, 0, 0, 0});
+
+		nvgSave(vg);
+		nvgResetScissor(vg);
+		if (multiview)
+		{
+			glm::vec2 origin = GetViewOrigin(i);
+			nvgScissor(vg, origin.x, origin.y, GetViewSize().x, GetViewSize().y);
+		}
+		m_frameTimer.BeginInner(Render::FrameTimer::Tessellation);
+		nvgBeginPath(vg);
+		nvgRect(vg, pos.x - margin, pos.y - margin, size.x + 2 * margin, size.y + 2 * margin);
+		nvgRect(vg, pos.x, pos.y, size.x, size.y);
+		nvgPathWinding(vg, NVG_HOLE);
+		nvgFillPaint(vg, shadowPaint);
+		nvgFill(vg);
+		m_frameTimer.EndInner(Render::FrameTimer::Tessellation);
+		nvgRestore(vg);
+	}
+
+	if (!m_cursorPoints.empty() && m_window)
+	{
+		// Late latch, the cursor may have moved since the frame has started
+		double x, y;
+		glfwGetCursorPos(m_window, &x, &y);
+		glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(m_display_w, m_display_h) / glm::vec2(m_width, m_height);
+		// Same image location is marked in all views
+		glm::vec2 local = WindowToImage(cursorposition);
+		for (int i = 0; i < (int)m_views.size(); ++i)
+		{
+			glm::vec2 pos = GetViewTransform(i) * glm::vec3(local, 1.0f);
+			for (auto& p: m_cursorPoints)
+			{
+				DrawPoint(*m_views[i], i, pos, p.first, p.second);
+			}
+		}
+	}
+	m_cursorPoints.clear();
+
+	glm::ivec2 view_size = GetViewSize();
+	if (multiview)
+	{
+		glEnable(GL_SCISSOR_TEST);
+	}
+	for (int i = 0; i < (int)m_views.size(); ++i)
+	{
+		View& view = *m_views[i];
+		// Camera projects onto one view, so its viewport is set for the image, and the rest is drawn in framebuffer
+		// coordinates, clipped by scissor
+		glm::ivec2 origin = GetViewOrigin(i);
+		glm::ivec2 gl_origin(origin.x, m_display_h - origin.y - view_size.y);
+		glScissor(gl_origin.x, gl_origin.y, view_size.x, view_size.y);
+
+		if (view.HasImage())
+		{
+			glViewport(gl_origin.x, gl_origin.y, view_size.x, view_size.y);
+			DrawImage(view);
+			glViewport(0, 0, m_display_w, m_display_h);
+		}
+
+		view.annotations.Draw(GetViewTransform(i), m_display_w, m_display_h, *m_text);
+		view.sdf.Draw(m_display_w, m_display_h);
+	}
+	if (multiview)
+	{
+		glDisable(GL_SCISSOR_TEST);
+	}
+	m_frameTimer.End(Render::FrameTimer::Images);
+
+	m_frameTimer.Begin(Render::FrameTimer::Nanovg);
+	if (m_showFrameStats)
+	{
+		DrawFrameStats();
+	}
+	nvgEndFrame(vg);
+	m_frameTimer.End(Render::FrameTimer::Nanovg);
+
+	m_frameTimer.Begin(Render::FrameTimer::Text);
+	m_text->EnableBlending(true);
+	m_text->Render();
+	m_frameTimer.End(Render::FrameTimer::Text);
+
+	m_lastSubmitted = m_submitted;
+	m_lastDrawn = m_drawn;
+	m_submitted = 0;
+	m_drawn = 0;
+
+	if (m_offscreen)
+	{
+		// Nothing to present, the frame stays in the framebuffer until it is read
+		m_frameTimer.EndFrame();
+		return;
+	}
+
+	if (m_appliedSwapInterval != m_swapInterval)
+	{
+		glfwSwapInterval(m_swapInterval);
+		m_appliedSwapInterval = m_swapInterval;
+	}
+	m_frameTimer.Begin(Render::FrameTimer::Swap);
+	glfwSwapBuffers(m_window);
+	if (m_lowLatency)
+	{
+		glFinish();
+	}
+	m_frameTimer.End(Render::FrameTimer::Swap);
+	m_frameTimer.EndFrame();
+	if (m_inputTime >= 0.0)
+	{
+		m_inputLatency = (glfwGetTime() - m_inputTime) * 1000.0;
+		m_inputLatencySum += m_inputLatency;
+		m_inputLatencyCount += 1;
+		m_inputTime = -1.0;
+	}
+	if (!m_lowLatency)
+	{
+		glfwPollEvents();
+	}
+}
+
+
+void Context::NewFrame()
+{
+	if (!HasAnyImage())
+	{
+		throw std::runtime_error("No image assigned");
+	}
+	MakeCurrent();
+	m_frameTimer.BeginFrame();
+	m_frameTimer.Begin(Render::FrameTimer::NewFrame);
+
+	if (m_window)
+	{
+		if (m_lowLatency)
+		{
+			glfwPollEvents();
+		}
+		double x, y;
+		glfwGetCursorPos(m_window, &x, &y);
+		glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(m_display_w, m_display_h) / glm::vec2(m_width, m_height);
+		// Camera works in coordinates of one view. The view is not switched while panning, so that the image does not
+		// jump when the cursor crosses into another one
+		if (!m_camera.m_panningActive || m_cursorView >= (int)m_views.size())
+		{
+			m_cursorView = GetViewAt(cursorposition);
+		}
+		cursorposition -= glm::vec2(GetViewOrigin(m_cursorView));
+		m_camera.Move(cursorposition.x, cursorposition.y);
+	}
+	m_camera.UpdateViewProjection(GetViewSize().x, GetViewSize().y);
+
+	if (m_offscreen)
+	{
+		m_framebuffer.Bind();
+	}
+
+	for (auto& view: m_views)
+	{
+		if (view->pendingImage && view->pendingImage->Poll())
+		{
+			view->image = view->pendingImage;
+			view->pendingImage.reset();
+			view->tiledImage.reset();
+			view->texture.reset();
+			if (view->pendingRecenter)
+			{
+				// Camera is shared, the image fits into the view regardless of which view it is
+				View* current = m_view;
+				m_view = view.get();
+				Recenter(Context::FIT_DOCUMENT);
+				m_view = current;
+				m_camera.UpdateViewProjection(GetViewSize().x, GetViewSize().y);
+			}
+		}
+		if (view->image)
+		{
+			view->image->Poll();
+		}
+	}
+	Render::debug_guard<> m_guard;
+	glViewport(0, 0, m_display_w, m_display_h);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_FRAMEBUFFER_SRGB);
+	nvgBeginFrame(vg, m_display_w, m_display_h, 1.0f);
+	UpdateVisibleRect();
+
+	m_frameTimer.End(Render::FrameTimer::NewFrame);
+	// Until Render, the python code of the frame runs
+	m_frameTimer.Begin(Render::FrameTimer::Update);
+}
+
+
+void Context::UpdateVisibleRect()
+{
+	auto w2c = m_camera.GetWorldToCanvas();
+	glm::vec2 a = w2c * glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec2 b = w2c * glm::vec3(GetViewSize(), 1.0f);
+	m_visibleRect = glm::aabb2(glm::min(a, b), glm::max(a, b));
+}
+
+
+bool Context::Submit(glm::aabb2 box, float margin)
+{
+	++m_submitted;
+	if (m_culling)
+	{
+		glm::vec2 m(margin * m_camera.GetFOV());
+		bool visible = glm::all(glm::lessThanEqual(box.minp - m, m_visibleRect.maxp)) && glm::all(glm::greaterThanEqual(box.maxp + m, m_visibleRect.minp));
+		if (!visible)
+		{
+			return false;
+		}
+	}
+	++m_drawn;
+	return true;
+}
+
+
+void Context::Resize(int width, int height, int display_w, int display_h)
+{
+	m_redraw = true;
+	if (!HasAnyImage())
+	{
+		throw std::runtime_error("No image assigned");
+	}
+	auto oldWindowBufferSize = glm::vec2(GetViewSize());
+	m_width = width;
 	m_height = height;
 	m_display_w = display_w;
 	m_display_h = display_h;
-	m_camera.UpdateViewProjection(m_display_w, m_display_h);
-	auto size = m_image->GetSize();
-
+	m_camera.UpdateViewProjection(GetViewSize().x, GetViewSize().y);
+	if (m_offscreen)
+	{
+		m_framebuffer.Resize(display_w, display_h);
+	}
 	auto oldClientArea = oldWindowBufferSize;
-	auto clientArea = glm::vec2(m_display_w, m_display_h);// - glm::ivec2(0, MainMenuBar * m_window->GetPixelScale());
+	auto clientArea = glm::vec2(GetViewSize());// - glm::ivec2(0, MainMenuBar * m_window->GetPixelScale());
 
 	auto pos = m_camera.GetPos();
 	auto delta = glm::vec2((clientArea - oldClientArea) / 2.0f) * m_camera.GetFOV();
 	m_camera.SetPos(pos + delta);
+	UpdateVisibleRect();
 }
 
 
 bool Context::ShouldClose()
 {
-	return glfwWindowShouldClose(m_window) != 0;
+	return m_window != nullptr && glfwWindowShouldClose(m_window) != 0;
+}
+
+
+bool Context::IsAnimating() const
+{
+	for (auto& view: m_views)
+	{
+		if (view->pendingImage || (view->image && !view->image->IsReady()) || (view->tiledImage && !view->tiledImage->m_complete))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool Context::WaitForRedraw()
+{
+	bool changes = false;
+	for (auto& view: m_views)
+	{
+		changes = changes || view->annotations.HasChanges();
+	}
+	if (m_window && m_onDemand && !m_redraw && !changes && !IsAnimating())
+	{
+		// Callbacks take the GIL back when they call into python
+		py::gil_scoped_release release;
+		glfwWaitEventsTimeout(m_idleTimeout);
+	}
+	bool redraw = !m_onDemand || m_redraw || changes || IsAnimating();
+	m_redraw = false;
+	if (redraw)
+	{
+		m_activeFrames += 1;
+	}
+	else
+	{
+		m_idleFrames += 1;
+	}
+	return redraw;
 }
 
 int Context::GetWidth() const
@@ -617,68 +1415,525 @@ int Context::GetHeight() const
 	return m_display_h;
 }
 
-void Context::Point(float x, float y, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size) const
+void Context::Point(float x, float y, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size)
 {
-	auto transform = m_camera.GetCanvasToWorld();
+	// Shadow extends to 6x of the radius
+	if (!Submit(glm::aabb2(glm::vec2(x, y)), point_size * 6.0f + 1.0f))
+	{
+		return;
+	}
+	auto transform = GetViewTransform(m_currentView);
 
 	glm::vec2 point_pos_local = glm::vec2(x, y);
 	glm::vec2 point_pos = transform * glm::vec3(point_pos_local, 1);
+	DrawPoint(*m_view, m_currentView, point_pos, color, point_size);
+}
 
-	nvgBeginPath(vg);
-	nvgCircle(vg, point_pos.x, point_pos.y, point_size);
-	nvgFillColor(vg, nvgRGBA(std::get<0>(color), std::get<1>(color), std::get<2>(color), std::get<3>(color)));
-	nvgFill(vg);
-	nvgBeginPath(vg);
+void Context::CursorPoint(std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size)
+{
+	m_cursorPoints.emplace_back(color, point_size);
+}
 
-	nvgCircle(vg, point_pos.x, point_pos.y, point_size * 6);
-	nvgCircle(vg, point_pos.x, point_pos.y, point_size);
-	nvgPathWinding(vg, NVG_HOLE);
-	NVGpaint rshadowPaint = nvgBoxGradient(
-			vg, point_pos.x - point_size, point_pos.y - point_size, point_size * 2, point_size * 2, point_size,
-			point_size * 0.3,
-			{0, 0, 0, 1.0f}, {0, 0, 0, 0});
-	nvgFillPaint(vg, rshadowPaint);
-	nvgFill(vg);
+static glm::vec<4, uint8_t> ToVec(std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> c)
+{
+	return glm::vec<4, uint8_t>(std::get<0>(c), std::get<1>(c), std::get<2>(c), std::get<3>(c));
+}
+
+void Context::DrawPoint(View& view, int index, glm::vec2 point_pos, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, float point_size)
+{
+	if (m_useSdf && view.sdf.IsReady())
+	{
+		// Clipped with GL scissor, when the view is drawn
+		view.sdf.AddPoint(point_pos, ToVec(color), point_size);
+	}
+	else
+	{
+		BeginViewScissor(index);
+		m_frameTimer.BeginInner(Render::FrameTimer::Tessellation);
+		Render::DrawPointPath(vg, point_pos, ToVec(color), point_size);
+		m_frameTimer.EndInner(Render::FrameTimer::Tessellation);
+		EndViewScissor();
+	}
 }
 
-void Context::Box(float minx, float miny, float maxx, float maxy, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_stroke, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_fill) const
+void Context::BeginViewScissor(int index)
 {
-	auto transform = m_camera.GetCanvasToWorld();
+	if (m_views.size() > 1)
+	{
+		glm::vec2 origin = GetViewOrigin(index);
+		glm::vec2 size = GetViewSize();
+		nvgSave(vg);
+		nvgScissor(vg, origin.x, origin.y, size.x, size.y);
+	}
+}
+
+void Context::EndViewScissor()
+{
+	if (m_views.size() > 1)
+	{
+		nvgRestore(vg);
+	}
+}
+
+void Context::Box(float minx, float miny, float maxx, float maxy, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_stroke, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color_fill)
+{
+	// Corners may be given in any order
+	glm::vec2 a(minx, miny);
+	glm::vec2 b(maxx, maxy);
+	if (!Submit(glm::aabb2(glm::min(a, b), glm::max(a, b)), 1.0f))
+	{
+		return;
+	}
+	auto transform = GetViewTransform(m_currentView);
 
 	glm::aabb2 box(transform * glm::vec3(minx, miny, 1), transform * glm::vec3(maxx, maxy, 1));
 
-	nvgBeginPath(vg);
-	nvgRect(vg, box);
-	nvgFillColor(vg, nvgRGBA(std::get<0>(color_stroke), std::get<1>(color_fill), std::get<2>(color_fill), std::get<3>(color_fill)));
-	nvgFill(vg);
+	if (m_useSdf && m_view->sdf.IsReady())
+	{
+		m_view->sdf.AddBox(box, ToVec(color_stroke), ToVec(color_fill));
+	}
+	else
+	{
+		BeginViewScissor(m_currentView);
+		m_frameTimer.BeginInner(Render::FrameTimer::Tessellation);
+		Render::DrawBoxPath(vg, box, ToVec(color_stroke), ToVec(color_fill));
+		m_frameTimer.EndInner(Render::FrameTimer::Tessellation);
+		EndViewScissor();
+	}
+}
 
-	nvgBeginPath(vg);
-	nvgRect(vg, box);
-	nvgStrokeColor(vg, nvgRGBA(std::get<0>(color_stroke), std::get<1>(color_stroke), std::get<2>(color_stroke), std::get<3>(color_stroke)));
-	nvgStroke(vg);
+
+// Returns number of rows of `a`, which should have shape (N, columns)
+static size_t GetRowCount(const py::array& a, size_t columns, const char* name)
+{
+	if (a.ndim() != 2 || a.shape(1) != (ssize_t)columns)
+	{
+		throw runtime_error("%s should have shape (N, %d)", name, (int)columns);
+	}
+	return (size_t)a.shape(0);
+}
+
+// Returns number of elements between values of consecutive primitives. Zero if there is one value for all of them
+static size_t GetStride(const py::array& a, size_t count, size_t columns, const char* name)
+{
+	if (a.size() == (ssize_t)columns && a.ndim() <= 1)
+	{
+		return 0;
+	}
+	bool per_primitive = columns == 1
+			? a.ndim() == 1 && a.shape(0) == (ssize_t)count
+			: a.ndim() == 2 && a.shape(0) == (ssize_t)count && a.shape(1) == (ssize_t)columns;
+	if (!per_primitive)
+	{
+		throw runtime_error("%s should have %d values, or one row of them for each of %d primitives", name, (int)columns, (int)count);
+	}
+	return columns;
+}
+
+void Context::Points(FloatArray xy, ByteArray colors, FloatArray radii)
+{
+	size_t count = GetRowCount(xy, 2, "xy");
+	size_t color_stride = GetStride(colors, count, 4, "colors");
+	size_t radius_stride = GetStride(radii, count, 1, "radii");
+	if (count == 0)
+	{
+		return;
+	}
+	py::gil_scoped_release release;
+	m_view->annotations.Points(xy.data(), count, colors.data(), color_stride, radii.data(), radius_stride);
+}
+
+void Context::Boxes(FloatArray boxes, ByteArray colors_stroke, ByteArray colors_fill)
+{
+	size_t count = GetRowCount(boxes, 4, "boxes");
+	size_t stroke_stride = GetStride(colors_stroke, count, 4, "colors_stroke");
+	size_t fill_stride = GetStride(colors_fill, count, 4, "colors_fill");
+	if (count == 0)
+	{
+		return;
+	}
+	py::gil_scoped_release release;
+	m_view->annotations.Boxes(boxes.data(), count, colors_stroke.data(), stroke_stride, colors_fill.data(), fill_stride);
+}
+
+void Context::Lines(FloatArray segments, ByteArray colors, float width)
+{
+	size_t count = GetRowCount(segments, 4, "segments");
+	size_t color_stride = GetStride(colors, count, 4, "colors");
+	if (count == 0)
+	{
+		return;
+	}
+	py::gil_scoped_release release;
+	m_view->annotations.Lines(segments.data(), count, colors.data(), color_stride, width);
+}
+
+BatchRenderer::Stats Context::RenderBatch(py::list jobs, int threads, int quality)
+{
+	if (!m_offscreen)
+	{
+		throw runtime_error("render_batch is available only for offscreen contexts");
+	}
+	MakeCurrent();
+
+	std::vector<BatchRenderer::Job> batch;
+	std::vector<py::object> images;
+	std::vector<py::object> annotations;
+	for (auto item: jobs)
+	{
+		auto job = item.cast<py::tuple>();
+		if (job.size() != 3)
+		{
+			throw runtime_error("Job should be a tuple (image, annotations, output path)");
+		}
+		BatchRenderer::Job j;
+		if (py::isinstance<py::str>(job[0]))
+		{
+			j.input = job[0].cast<std::string>();
+		}
+		j.output = job[2].cast<std::string>();
+		batch.push_back(j);
+		images.push_back(job[0]);
+		annotations.push_back(job[1]);
+	}
+
+	auto upload = [this, &images](size_t index, const DecodedImagePtr& decoded)
+	{
+		py::gil_scoped_acquire acquire;
+		std::vector<py::array> levels;
+		if (decoded)
+		{
+			for (int i = 0; i < (int)decoded->levels.size(); ++i)
+			{
+				levels.push_back(ImageLoader::ToArray(decoded, i));
+			}
+		}
+		else
+		{
+			levels.push_back(images[index].cast<py::array>());
+		}
+		SetImage(std::make_shared<Image>(levels), true);
+	};
+
+	auto render = [this, &annotations](size_t index)
+	{
+		py::gil_scoped_acquire acquire;
+		NewFrame();
+		if (!annotations[index].is_none())
+		{
+			auto a = annotations[index].cast<py::dict>();
+			if (a.contains("points"))
+			{
+				auto args = a["points"].cast<py::tuple>();
+				Points(args[0].cast<FloatArray>(), args[1].cast<ByteArray>(), args.size() > 2 ? args[2].cast<FloatArray>() : py::cast(5.0f).cast<FloatArray>());
+			}
+			if (a.contains("boxes"))
+			{
+				auto args = a["boxes"].cast<py::tuple>();
+				Boxes(args[0].cast<FloatArray>(), args[1].cast<ByteArray>(), args[2].cast<ByteArray>());
+			}
+			if (a.contains("lines"))
+			{
+				auto args = a["lines"].cast<py::tuple>();
+				Lines(args[0].cast<FloatArray>(), args[1].cast<ByteArray>(), args.size() > 2 ? args[2].cast<float>() : 1.0f);
+			}
+		}
+		Render();
+	};
+
+	BatchRenderer renderer(threads, quality);
+	py::gil_scoped_release release;
+	return renderer.Run(batch, m_framebuffer, upload, render);
 }
 
 
 PYBIND11_MODULE(_anntoolkit, m) {
 	m.doc() = "anntoolkit";
 
+	PYBIND11_NUMPY_DTYPE(InputQueue::Event, time, type, button, action, mods, count, x, y, lx, ly, value);
+
 	py::class_<Context>(m, "Context")
 		.def(py::init())
-		.def("init", &Context::Init, "Initializes context and creates window")
+		.def("init", &Context::Init, py::arg("width"), py::arg("height"), py::arg("name"), py::arg("offscreen") = false,
+			py::arg("share") = nullptr,
+			"Initializes context and creates window. With offscreen=True, creates a context without a window using EGL, "
+			"which also works on headless machines, and frames are rendered into a framebuffer of width x height. "
+			"If share is another context, textures are shared with it, so the same Image can be set in both")
+		.def("make_current", &Context::MakeCurrent, "Makes GL context current, images created after that belong to it")
+		.def_static("start_trace", &Tracer::Start,
+			"Starts recording frame stages, uploads and work of the loader threads of all contexts, see stop_trace")
+		.def_static("stop_trace", [](const std::string& path)
+			{
+				py::gil_scoped_release release;
+				return Tracer::Stop(path);
+			}, py::arg("path"),
+			"Stops recording and writes the trace to `path` as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev. "
+			"Returns number of events")
+		.def_property_readonly("vram", [](Context& self)
+			{
+				py::dict result;
+				if (self.m_shareGroup)
+				{
+					result["images"] = self.m_shareGroup->GetImageCount();
+					result["image_bytes"] = self.m_shareGroup->GetImageBytes();
+					result["contexts"] = self.m_shareGroup->m_contextCount;
+				}
+				return result;
+			}, "Video memory taken by images of all contexts that share objects with this one: dict with number of "
+			"images, their total size in bytes and number of contexts. Shared images are counted once")
+		.def_readonly("offscreen", &Context::m_offscreen)
+		.def("read_pixels", [](Context& self)
+			{
+				if (!self.m_offscreen)
+				{
+					throw runtime_error("read_pixels is available only for offscreen contexts");
+				}
+				py::array_t<uint8_t> pixels(std::vector<ssize_t>{self.m_framebuffer.GetHeight(), self.m_framebuffer.GetWidth(), 4});
+				uint8_t* data = pixels.mutable_data();
+				{
+					py::gil_scoped_release release;
+					self.MakeCurrent();
+					self.m_framebuffer.ReadPixels(data);
+				}
+				return pixels;
+			}, "Returns the last rendered frame of an offscreen context as uint8 array of shape (height, width, 4), in sRGB")
+		.def("resize", [](Context& self, int width, int height)
+			{
+				if (!self.m_offscreen)
+				{
+					throw runtime_error("Only offscreen contexts can be resized, windows are resized by the user");
+				}
+				self.Resize(width, height, width, height);
+			}, py::arg("width"), py::arg("height"), "Changes size of the framebuffer of an offscreen context")
+		.def("render_batch", [](Context& self, py::list jobs, int threads, int quality)
+			{
+				auto stats = self.RenderBatch(jobs, threads, quality);
+				size_t count = std::max<size_t>(stats.images, 1);
+				py::dict result;
+				result["images"] = stats.images;
+				result["failed"] = stats.failed;
+				result["decode"] = stats.decode / count;
+				result["upload"] = stats.upload / count;
+				result["render"] = stats.render / count;
+				result["readback"] = stats.readback / count;
+				result["encode"] = stats.encode / count;
+				result["decode_stall"] = stats.decode_stall;
+				result["encode_stall"] = stats.encode_stall;
+				result["total"] = stats.total;
+				result["images_per_second"] = stats.GetImagesPerSecond();
+				return result;
+			}, py::arg("jobs"), py::arg("threads") = 0, py::arg("quality") = 90,
+			"Renders a list of (image, annotations, output path) jobs in offscreen mode and writes them to PNG or JPEG files. "
+			"Decoding, upload, rendering, readback and encoding are pipelined. Returns dict of mean per-image times of the stages "
+			"and total stall times of the GL thread in milliseconds, total time and images per second")
 		.def("new_frame", &Context::NewFrame, "Starts a new frame. NewFrame must be called before any imgui functions")
 		.def("render", &Context::Render, "Finilizes the frame and draws all UI. Render must be called after all imgui functions")
 		.def("should_close", &Context::ShouldClose)
+		.def("wait_for_redraw", &Context::WaitForRedraw,
+			"In on-demand mode, waits until there is something to redraw or until idle_timeout passes. "
+			"Returns False if the frame should be skipped")
+		.def("request_redraw", &Context::RequestRedraw, "Makes the next wait_for_redraw return True")
+		.def_readwrite("on_demand", &Context::m_onDemand,
+			"If True, frames are drawn only on input, camera change, pending upload or request_redraw")
+		.def_readwrite("idle_timeout", &Context::m_idleTimeout, "Longest time in seconds that wait_for_redraw blocks")
+		.def_readonly("active_frames", &Context::m_activeFrames, "Number of frames that were drawn")
+		.def_readonly("idle_frames", &Context::m_idleFrames, "Number of wake-ups with nothing to redraw")
+		.def_readwrite("low_latency", &Context::m_lowLatency,
+			"If True, input is polled right before drawing and the CPU waits for the GPU after each swap, so that frames are not queued")
+		.def_property("culling", [](const Context& self)
+			{
+				return self.m_culling;
+			}, [](Context& self, bool value)
+			{
+				self.m_culling = value;
+				self.RequestRedraw();
+			},
+			"If True, point, box and text_loc calls outside of the visible part of the image are skipped before any tessellation")
+		.def_property_readonly("culling_stats", [](const Context& self)
+			{
+				return std::make_tuple(self.m_lastSubmitted, self.m_lastDrawn);
+			}, "Number of primitives submitted with point, box and text_loc in the last rendered frame, and the number of them that were drawn")
+		.def_property("sdf", [](const Context& self)
+			{
+				return self.m_useSdf;
+			}, [](Context& self, bool value)
+			{
+				if (value && !self.m_views[0]->sdf.IsReady())
+				{
+					throw runtime_error("Instanced rendering is not supported by the OpenGL context");
+				}
+				self.m_useSdf = value;
+			}, "If True, point() and box() are drawn analytically in a fragment shader with one instanced draw call per frame, instead of nanovg paths")
+		.def_property("swap_interval", [](const Context& self)
+			{
+				return self.m_swapInterval;
+			}, [](Context& self, int value)
+			{
+				self.m_swapInterval = value;
+				self.RequestRedraw();
+			}, "Number of vertical blanks to wait for on swap, 0 disables vsync")
+		.def_readonly("input_latency", &Context::m_inputLatency, "Input-to-present latency of the last frame that had input, in milliseconds")
+		.def_property_readonly("mean_input_latency", [](const Context& self)
+			{
+				return self.m_inputLatencyCount != 0 ? self.m_inputLatencySum / self.m_inputLatencyCount : 0.0;
+			}, "Mean input-to-present latency in milliseconds")
+		.def("frame_stats", [](const Context& self)
+			{
+				auto history = self.m_frameTimer.GetHistory();
+				const int stages = Render::FrameTimer::StageCount;
+				py::list names;
+				for (int i = 0; i < stages; ++i)
+				{
+					names.append(Render::FrameTimer::GetStageName(i));
+				}
+				ssize_t n = (ssize_t)history.size();
+				py::array_t<double> cpu(std::vector<ssize_t>{n, stages});
+				py::array_t<double> gpu(std::vector<ssize_t>{n, stages});
+				py::array_t<double> total(n);
+				py::array_t<double> interval(n);
+				for (ssize_t i = 0; i < n; ++i)
+				{
+					for (int j = 0; j < stages; ++j)
+					{
+						cpu.mutable_at(i, j) = history[i].cpu[j];
+						gpu.mutable_at(i, j) = history[i].gpu[j] >= 0.0 ? history[i].gpu[j] : NAN;
+					}
+					total.mutable_at(i) = history[i].total;
+					interval.mutable_at(i) = history[i].interval;
+				}
+				py::dict result;
+				result["stages"] = names;
+				result["cpu"] = cpu;
+				result["gpu"] = gpu;
+				result["total"] = total;
+				result["interval"] = interval;
+				return result;
+			}, "Times of the last frames in milliseconds, oldest first: dict with stage names, cpu and gpu arrays of shape "
+			"(frames, stages), and total CPU time and interval between frames of shape (frames,). GPU time is NaN "
+			"for stages without GPU work, if timer queries are not supported, or for the last few frames, which are not finished yet. "
+			"Tessellation of nanovg paths is reported as its own stage and is not included in update and images")
+		.def_property("frame_stats_overlay", [](const Context& self)
+			{
+				return self.m_showFrameStats;
+			}, [](Context& self, bool value)
+			{
+				self.m_showFrameStats = value;
+				self.RequestRedraw();
+			}, "If True, graph of frame_stats is drawn over the image")
+		.def("reset_input_latency", [](Context& self)
+			{
+				self.m_inputLatencySum = 0.0;
+				self.m_inputLatencyCount = 0;
+			})
 		.def("width", &Context::GetWidth)
 		.def("height", &Context::GetHeight)
 		.def("set", [](Context& self, ImagePtr im)
 			{
-				self.m_image = im;
-				self.Recenter(Context::FIT_DOCUMENT);
+				self.SetImage(im, true);
 			})
 		.def("set_without_recenter", [](Context& self, ImagePtr im)
 			{
-				self.m_image = im;
+				self.SetImage(im, false);
+			})
+		.def("set", [](Context& self, TiledImagePtr im)
+			{
+				self.SetImage(im, true);
+			})
+		.def("set_without_recenter", [](Context& self, TiledImagePtr im)
+			{
+				self.SetImage(im, false);
+			})
+		.def("set", [](Context& self, Render::TexturePtr texture)
+			{
+				self.SetImage(texture, true);
+			})
+		.def("set_without_recenter", [](Context& self, Render::TexturePtr texture)
+			{
+				self.SetImage(texture, false);
+			})
+		.def("set", [](Context& self, const std::string& key)
+			{
+				return self.SetImage(key, true);
+			}, py::arg("key"), "Sets image from the texture cache. Returns the image, or None if there is no image with such key")
+		.def("set_without_recenter", [](Context& self, const std::string& key)
+			{
+				return self.SetImage(key, false);
+			}, py::arg("key"))
+		.def("set", [](Context& self, const std::string& key, ImagePtr im)
+			{
+				self.m_cache.Put(key, im);
+				self.SetImage(im, true);
+			}, py::arg("key"), py::arg("image"), "Puts image to the texture cache under the given key and sets it")
+		.def("set_without_recenter", [](Context& self, const std::string& key, ImagePtr im)
+			{
+				self.m_cache.Put(key, im);
+				self.SetImage(im, false);
+			}, py::arg("key"), py::arg("image"))
+		.def_property_readonly("cache", [](Context& self) -> TextureCache&
+			{
+				return self.m_cache;
+			}, py::return_value_policy::reference_internal)
+		.def_property_readonly("annotations", [](Context& self) -> AnnotationLayer&
+			{
+				return self.m_view->annotations;
+			}, py::return_value_policy::reference_internal, "Retained annotations of the current view")
+		.def("set_views", &Context::SetViewCount, py::arg("count"), py::arg("columns") = 0,
+			"Splits the window into a grid of `count` views with their own images and annotations, e.g. to compare results "
+			"of several models. All views are driven by one camera. If `columns` is zero, the grid is about square")
+		.def_property("view", [](const Context& self)
+			{
+				return self.m_currentView;
+			}, &Context::SetCurrentView, "Index of the view that set_image, drawing calls and annotations apply to")
+		.def_property_readonly("view_count", [](const Context& self)
+			{
+				return (int)self.m_views.size();
+			})
+		.def("max_texture_size", [](Context& self)
+			{
+				GLint size = 0;
+				glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+				return size;
+			})
+		.def("set_window_level", [](Context& self, float window, float level)
+			{
+				self.m_windowWidth = window;
+				self.m_level = level;
+				self.m_redraw = true;
+			}, py::arg("window"), py::arg("level"),
+			"Maps range [level - window / 2, level + window / 2] of image values to the display range. "
+			"Values are in units of image data, e.g. 0..65535 for uint16. Window of zero resets to the full range")
+		.def_property("window", [](const Context& self)
+			{
+				return self.m_windowWidth;
+			}, [](Context& self, float value)
+			{
+				self.m_windowWidth = value;
+				self.RequestRedraw();
+			})
+		.def_property("level", [](const Context& self)
+			{
+				return self.m_level;
+			}, [](Context& self, float value)
+			{
+				self.m_level = value;
+				self.RequestRedraw();
 			})
+		.def_property("gamma", [](const Context& self)
+			{
+				return self.m_gamma;
+			}, [](Context& self, float value)
+			{
+				self.m_gamma = value;
+				self.RequestRedraw();
+			}, "Display gamma, applied after window/level")
+		.def_property("exposure", [](const Context& self)
+			{
+				return self.m_exposure;
+			}, [](Context& self, float value)
+			{
+				self.m_exposure = value;
+				self.RequestRedraw();
+			}, "Exposure in stops, image values are multiplied by 2^exposure")
 		.def("recenter", [](Context& self)
 			{
 				self.Recenter(Context::FIT_DOCUMENT);
@@ -702,15 +1957,38 @@ PYBIND11_MODULE(_anntoolkit, m) {
 			self.mouse_position_callback = f;
 		})
 		.def("get_mouse_position", [](Context& self){
-				double x, y;
-				glfwGetCursorPos(self.m_window, &x, &y);
+				double x = 0.0, y = 0.0;
+				if (self.m_window)
+				{
+					glfwGetCursorPos(self.m_window, &x, &y);
+				}
 				glm::vec2 cursorposition = glm::vec2(x, y) * glm::vec2(self.m_display_w, self.m_display_h) / glm::vec2(self.m_width, self.m_height);
-				auto local = glm::vec2(self.m_camera.GetWorldToCanvas() * glm::vec3(cursorposition, 1.0f));
+				auto local = self.WindowToImage(cursorposition);
 				return std::make_tuple(cursorposition.x, cursorposition.y, local.x, local.y);
 		})
 		.def("set_keyboard_callback", [](Context& self, py::function f){
 			self.keyboard_callback = f;
 		})
+		.def_property("input_queue", [](const Context& self)
+			{
+				return self.m_queueInput;
+			}, [](Context& self, bool value)
+			{
+				self.m_queueInput = value;
+				self.m_input.Drain();
+			}, "If True, input events are buffered and returned by drain_input, instead of calling the callbacks for each event. "
+			"Consecutive mouse moves, scrolls and key repeats are merged into one event")
+		.def("drain_input", [](Context& self)
+			{
+				auto events = self.m_input.Drain();
+				return py::array_t<InputQueue::Event>((ssize_t)events.size(), events.data());
+			}, "Returns input events since the last call as a structured array, oldest first, with fields: time (seconds, "
+			"as of glfwGetTime), type (InputEvent), button (mouse button or key), action (1 press, 0 release, 2 repeat), "
+			"mods, count (number of merged events), x, y (framebuffer pixels), lx, ly (image space) and value (scroll offset)")
+		.def_property_readonly("input_dropped", [](const Context& self)
+			{
+				return self.m_input.GetDropped();
+			}, "Number of input events dropped because the queue was not drained")
 		.def("text", [](Context& self, const char* str, int x, int y, SimpleText::Alignment align)
 		{
 			self.m_text->Label(str, x, y, align);
@@ -725,7 +2003,11 @@ PYBIND11_MODULE(_anntoolkit, m) {
 		})
 		.def("text_loc", [](Context& self, const char* str, float x, float y, SimpleText::Alignment align)
 		{
-			auto transform = self.m_camera.GetCanvasToWorld();
+			if (!self.Submit(glm::aabb2(glm::vec2(x, y)), Context::LabelCullMargin))
+			{
+				return;
+			}
+			auto transform = self.GetViewTransform(self.m_currentView);
 
 			glm::vec2 pos_local = glm::vec2(x, y);
 			glm::vec2 pos = transform * glm::vec3(pos_local, 1);
@@ -734,22 +2016,24 @@ PYBIND11_MODULE(_anntoolkit, m) {
 		})
 		.def("loc_2_win", [](Context& self, float x, float y)
 		{
-			auto transform = self.m_camera.GetCanvasToWorld();
+			auto transform = self.GetViewTransform(self.m_currentView);
 			glm::vec2 pos_local = glm::vec2(x, y);
 			glm::vec2 pos = transform * glm::vec3(pos_local, 1);
 			return std::tuple<float, float>(pos.x, pos.y);
 		})
 		.def("win_2_loc", [](Context& self, float x, float y)
 		{
-			auto transform = self.m_camera.GetWorldToCanvas();
-			glm::vec2 pos_local = glm::vec2(x, y);
-			glm::vec2 pos = transform * glm::vec3(pos_local, 1);
+			glm::vec2 pos = self.WindowToImage(glm::vec2(x, y));
 			return std::tuple<float, float>(pos.x, pos.y);
 		})
 		.def("get_scale", [] (Context& self) { return 1.0 / self.m_camera.GetFOV(); })
 		.def("text_loc", [](Context& self, const char* str, float x, float y, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> color, std::tuple<uint8_t, uint8_t, uint8_t, uint8_t> bg_color, SimpleText::Alignment align)
 		{
-			auto transform = self.m_camera.GetCanvasToWorld();
+			if (!self.Submit(glm::aabb2(glm::vec2(x, y)), Context::LabelCullMargin))
+			{
+				return;
+			}
+			auto transform = self.GetViewTransform(self.m_currentView);
 
 			glm::vec2 pos_local = glm::vec2(x, y);
 			glm::vec2 pos = transform * glm::vec3(pos_local, 1);
@@ -762,7 +2046,18 @@ PYBIND11_MODULE(_anntoolkit, m) {
 			self.m_text->ResetFont();
 		})
 		.def("point",  &Context::Point, py::arg("x"), py::arg("y"), py::arg("color"), py::arg("radius") = 5)
-		.def("box",  &Context::Box);
+		.def("cursor_point",  &Context::CursorPoint, py::arg("color"), py::arg("radius") = 5,
+			"Draws point under the mouse cursor, which is sampled right before the frame is submitted")
+		.def("box",  &Context::Box)
+		.def("points", &Context::Points, py::arg("xy"), py::arg("colors"), py::arg("radii") = 5.0f,
+			"Draws N points given by float32 array of shape (N, 2) in image space. Colors are uint8 array of shape (N, 4) "
+			"or a single RGBA color, radii are float32 array of shape (N,) or a single radius in window pixels")
+		.def("boxes", &Context::Boxes, py::arg("boxes"), py::arg("colors_stroke"), py::arg("colors_fill"),
+			"Draws N boxes given by array of shape (N, 4) with minx, miny, maxx, maxy in image space. "
+			"Colors are arrays of shape (N, 4) or single RGBA colors")
+		.def("lines", &Context::Lines, py::arg("segments"), py::arg("colors"), py::arg("width") = 1.0f,
+			"Draws N line segments given by array of shape (N, 4) with x0, y0, x1, y1 in image space. "
+			"Colors are array of shape (N, 4) or a single RGBA color, width is in window pixels");
 
 		py::enum_<SpecialKeys>(m, "SpecialKeys")
 			.value("KeyEscape", KeyEscape)
@@ -777,15 +2072,279 @@ PYBIND11_MODULE(_anntoolkit, m) {
 			.value("KeyUp", KeyUp)
 			.export_values();
 
+		py::enum_<InputQueue::Type>(m, "InputEvent", py::arithmetic())
+			.value("MouseMove", InputQueue::MouseMove)
+			.value("MouseButton", InputQueue::MouseButton)
+			.value("Key", InputQueue::Key)
+			.value("Scroll", InputQueue::Scroll);
+
 		py::enum_<SimpleText::Alignment>(m, "Alignment")
 			.value("Left", SimpleText::LEFT)
 			.value("Center", SimpleText::CENTER)
 			.value("Right", SimpleText::RIGHT)
 			.export_values();
 
+		py::enum_<MipmapKernel>(m, "MipmapKernel")
+			.value("Box", MipmapKernel::Box)
+			.value("BSpline", MipmapKernel::BSpline)
+			.export_values();
+
+	m.def("generate_mipmaps", [](ndarray_uint8 image, float gamma, MipmapKernel kernel)
+		{
+			const py::buffer_info& info = image.request();
+			if (info.ndim != 2 && info.ndim != 3)
+			{
+				throw runtime_error("Wrong number of dimensions. Should be either 2 or 3, but got %d", (int)info.ndim);
+			}
+			int channels = info.ndim == 3 ? (int)info.shape[2] : 1;
+			if (channels < 1 || channels > 4)
+			{
+				throw runtime_error("Wrong number of channels. Should be either 1, 2, 3, or 4, but got %d", channels);
+			}
+			auto width = (int)info.shape[1];
+			auto height = (int)info.shape[0];
+
+			std::vector<ndarray_uint8> mipmaps = { image };
+			std::vector<uint8_t*> levels;
+			for (auto size: GetMipmapChainSizes(width, height))
+			{
+				std::vector<ssize_t> shape = { size.y, size.x };
+				if (info.ndim == 3)
+				{
+					shape.push_back(channels);
+				}
+				mipmaps.emplace_back(shape);
+				levels.push_back(mipmaps.back().mutable_data());
+			}
+			{
+				py::gil_scoped_release release;
+				GenerateMipmaps((const uint8_t*)info.ptr, width, height, channels, channels, info.strides[0], levels, kernel, gamma);
+			}
+			return mipmaps;
+		}, py::arg("image"), py::arg("gamma") = 2.2f, py::arg("kernel") = MipmapKernel::BSpline,
+		"Generates the full mipmap chain for the image. Filtering is done in linear space, using the given gamma. "
+		"Returns a list of levels, starting with the image itself");
+
 	py::class_<Image, std::shared_ptr<Image> >(m, "Image")
-			.def(py::init<std::vector<ndarray_uint8>>(), "")
+			.def(py::init<std::vector<py::array>, bool, bool, bool>(), py::arg("mipmaps"), py::arg("async_upload") = false,
+				py::arg("generate_mipmaps") = true, py::arg("compress") = false,
+				"Creates image from a list of mipmap levels of uint8, uint16 or float32 dtype. Float data is stored as half floats. "
+				"Strided arrays are uploaded without a copy "
+				"whenever possible. If only one level is given and generate_mipmaps is True, "
+				"the rest of the chain is generated. If async_upload is True, data is streamed through a pixel unpack buffer "
+				"and the image becomes visible once the driver has finished the transfer. If compress is True, uint8 images are "
+				"block compressed on the CPU before upload: BC4 for grayscale, BC5 for two channels, BC7 or BC1 for color, "
+				"depending on what the driver supports. Compressed images take 4 to 8 times less video memory, but can not be updated")
 			.def("grayscale_to_alpha", &Image::GrayScaleToAlpha, "For grayscale images, uses values as alpha")
+			.def("update_region", &Image::UpdateRegion, py::arg("x"), py::arg("y"), py::arg("image"),
+				"Replaces part of the image with the given array, which should have the same dtype and number of channels. "
+				"Only the affected part of mipmaps is updated")
+			.def_property_readonly("ready", &Image::IsReady, "False while asynchronous upload is in progress")
+			.def_property_readonly("bytes", &Image::GetBytes, "Approximate size in video memory")
+			.def_property_readonly("compressed", &Image::IsCompressed)
+			.def_property_readonly("bytes_saved", &Image::GetBytesSaved, "Video memory saved by block compression, in bytes")
+			.def_readonly("encode_time", &Image::m_encodeTime, "Time in milliseconds spent on block compression")
+			.def_readonly("encode_throughput", &Image::m_encodeThroughput, "Block compression speed in megapixels per second")
+			.def_readonly("upload_time", &Image::m_uploadTime, "CPU time in milliseconds spent on the last upload")
+			.def_readonly("upload_latency", &Image::m_uploadLatency, "Time in milliseconds from the last upload call until the texture was ready")
 			.def_readonly("width", &Image::m_width)
 			.def_readonly("height", &Image::m_height);
+
+	py::class_<Render::Texture, Render::TexturePtr>(m, "Texture")
+			.def(py::init([](const std::string& path)
+				{
+					return Render::Texture::LoadTexture(path);
+				}), py::arg("path"),
+				"Loads GPU-compressed texture from DDS or KTX file. Blocks are uploaded as is, without decompression, "
+				"so the texture takes as much video memory as the file")
+			.def_property_readonly("width", [](const Render::Texture& self) { return self.GetSize().x; })
+			.def_property_readonly("height", [](const Render::Texture& self) { return self.GetSize().y; })
+			.def_property_readonly("mipmaps", &Render::Texture::GetMipmapCount)
+			.def_property_readonly("compressed", &Render::Texture::IsCompressed)
+			.def_property_readonly("bytes", &Render::Texture::GetBytes, "Size in video memory");
+
+	py::class_<AnnotationLayer>(m, "AnnotationLayer")
+			.def("add_point", [](AnnotationLayer& self, float x, float y, AnnotationLayer::Color color, float radius)
+				{
+					return self.AddPoint(glm::vec2(x, y), color, radius);
+				}, py::arg("x"), py::arg("y"), py::arg("color"), py::arg("radius") = 5.0f, "Adds point in image space, returns its id")
+			.def("add_box", [](AnnotationLayer& self, float minx, float miny, float maxx, float maxy, AnnotationLayer::Color color_stroke, AnnotationLayer::Color color_fill)
+				{
+					return self.AddBox(glm::vec2(minx, miny), glm::vec2(maxx, maxy), color_stroke, color_fill);
+				}, py::arg("minx"), py::arg("miny"), py::arg("maxx"), py::arg("maxy"), py::arg("color_stroke"), py::arg("color_fill"),
+				"Adds box in image space, returns its id")
+			.def("add_label", [](AnnotationLayer& self, const std::string& text, float x, float y, SimpleText::Alignment align)
+				{
+					return self.AddLabel(text, glm::vec2(x, y), (int)align);
+				}, py::arg("text"), py::arg("x"), py::arg("y"), py::arg("alignment") = SimpleText::LEFT, "Adds text label in image space, returns its id")
+			.def("add_label", [](AnnotationLayer& self, const std::string& text, float x, float y, AnnotationLayer::Color color, AnnotationLayer::Color color_bg, SimpleText::Alignment align)
+				{
+					return self.AddLabel(text, glm::vec2(x, y), color, color_bg, (int)align);
+				}, py::arg("text"), py::arg("x"), py::arg("y"), py::arg("color"), py::arg("color_bg"), py::arg("alignment") = SimpleText::LEFT)
+			.def("set_position", [](AnnotationLayer& self, uint32_t id, float x, float y)
+				{
+					self.SetPosition(id, glm::vec2(x, y));
+				}, py::arg("id"), py::arg("x"), py::arg("y"), "Moves point or label")
+			.def("set_box", [](AnnotationLayer& self, uint32_t id, float minx, float miny, float maxx, float maxy)
+				{
+					self.SetBox(id, glm::vec2(minx, miny), glm::vec2(maxx, maxy));
+				}, py::arg("id"), py::arg("minx"), py::arg("miny"), py::arg("maxx"), py::arg("maxy"))
+			.def("set_color", &AnnotationLayer::SetColor, py::arg("id"), py::arg("color"),
+				"Sets color of a point, stroke color of a box or text color of a label")
+			.def("set_radius", &AnnotationLayer::SetRadius, py::arg("id"), py::arg("radius"))
+			.def("set_text", &AnnotationLayer::SetText, py::arg("id"), py::arg("text"))
+			.def("remove", &AnnotationLayer::Remove, py::arg("id"), "Returns False if there is no annotation with such id")
+			.def("clear", &AnnotationLayer::Clear)
+			.def("__contains__", &AnnotationLayer::Contains)
+			.def("__len__", &AnnotationLayer::GetCount)
+			.def_property("visible", &AnnotationLayer::GetVisible, &AnnotationLayer::SetVisible)
+			.def_property("lod", &AnnotationLayer::GetLOD, &AnnotationLayer::SetLOD,
+				"If True, points that are closer on screen than lod_spacing are drawn as clusters with count badges. "
+				"Cost of clustering depends on the window size, not on the number of points")
+			.def_property("lod_spacing", &AnnotationLayer::GetLODSpacing, &AnnotationLayer::SetLODSpacing,
+				"Distance in window pixels, below which points are clustered")
+			.def_readonly("clusters", &AnnotationLayer::m_clusters, "Number of clusters drawn in the last frame")
+			.def_readonly("tessellations", &AnnotationLayer::m_tessellations, "Number of times primitives were tessellated")
+			.def_readonly("full_uploads", &AnnotationLayer::m_fullUploads, "Number of times the whole vertex buffer was uploaded")
+			.def_readonly("partial_uploads", &AnnotationLayer::m_partialUploads, "Number of primitives uploaded individually");
+
+	py::class_<TextureCache>(m, "TextureCache")
+			.def("get", &TextureCache::Get, py::arg("key"), "Returns cached image, or None")
+			.def("put", &TextureCache::Put, py::arg("key"), py::arg("image"))
+			.def("remove", &TextureCache::Remove, py::arg("key"))
+			.def("clear", &TextureCache::Clear)
+			.def("__contains__", &TextureCache::Contains)
+			.def("__len__", &TextureCache::GetCount)
+			.def_property("budget", &TextureCache::GetBudget, &TextureCache::SetBudget, "Budget in bytes")
+			.def_readonly("bytes", &TextureCache::m_bytes, "Total size of cached images in bytes")
+			.def_readonly("hits", &TextureCache::m_hits)
+			.def_readonly("misses", &TextureCache::m_misses)
+			.def_readonly("evictions", &TextureCache::m_evictions);
+
+	py::class_<ImageLoader, std::shared_ptr<ImageLoader> >(m, "ImageLoader")
+			.def(py::init<std::vector<std::string>, int, int>(), py::arg("paths"), py::arg("radius") = 2, py::arg("threads") = 2,
+				"Decodes images from the list of paths in background. Images around the current one are prefetched, "
+				"`radius` in each direction")
+			.def("prefetch", &ImageLoader::Prefetch, py::arg("index"),
+				"Makes image current and schedules decoding of its neighbours. Everything else is cancelled")
+			.def("get", [](ImageLoader& self, int index)
+				{
+					DecodedImagePtr image;
+					{
+						py::gil_scoped_release release;
+						image = self.Get(index);
+					}
+					return ImageLoader::ToArray(image);
+				}, py::arg("index"), "Returns decoded image as numpy array, waits if it is not ready yet")
+			.def("get_image", &ImageLoader::GetImage, py::arg("index"),
+				"Returns image ready to be passed to `Context.set`. If it was already uploaded, no work is done")
+			.def("upload", &ImageLoader::Upload, py::arg("max_uploads") = 1,
+				"Uploads decoded images from the prefetch window, call it once per frame")
+			.def("ready", &ImageLoader::IsReady, py::arg("index"))
+			.def("__len__", &ImageLoader::GetCount)
+			.def_readwrite("radius", &ImageLoader::m_radius)
+			.def_readonly("hits", &ImageLoader::m_hits)
+			.def_readonly("misses", &ImageLoader::m_misses);
+
+	py::class_<TiledImage, std::shared_ptr<TiledImage> >(m, "TiledImage")
+			.def(py::init([](ndarray_uint8 im, int tile_size, float budget_mb)
+				{
+					const py::buffer_info& info = im.request();
+					if (info.ndim != 2 && info.ndim != 3)
+					{
+						throw runtime_error("Wrong number of dimensions. Should be either 2 or 3, but got %d", (int)info.ndim);
+					}
+					int channels = info.ndim == 3 ? (int)info.shape[2] : 1;
+					// Keeps the array alive while tiles are streamed from it
+					std::shared_ptr<void> owner(new ndarray_uint8(im), [](void* p)
+						{
+							py::gil_scoped_acquire acquire;
+							delete (ndarray_uint8*)p;
+						});
+					auto* data = (const uint8_t*)info.ptr;
+					auto width = (int)info.shape[1];
+					auto height = (int)info.shape[0];
+					py::gil_scoped_release release;
+					return std::make_shared<TiledImage>(data, width, height, channels, owner, tile_size, size_t(budget_mb * 1024 * 1024));
+				}), py::arg("image"), py::arg("tile_size") = 512, py::arg("budget_mb") = 256.0f,
+				"Creates a tiled image for images that exceed maximum texture size. Only visible tiles are kept in video memory, "
+				"within the budget given in megabytes")
+			.def_readonly("width", &TiledImage::m_width)
+			.def_readonly("height", &TiledImage::m_height)
+			.def_readonly("tile_size", &TiledImage::m_tileSize)
+			.def_property_readonly("levels", &TiledImage::GetLevelCount)
+			.def_readwrite("budget", &TiledImage::m_budget, "Residency budget in bytes")
+			.def_readonly("resident_tiles", &TiledImage::m_residentTiles)
+			.def_readonly("resident_bytes", &TiledImage::m_residentBytes)
+			.def_readonly("uploads", &TiledImage::m_uploads)
+			.def_readonly("evictions", &TiledImage::m_evictions);
+}
+
+
+TEST_CASE("[Context] Window and level of uint8 color and uint16 images")
+{
+	// Images are made of numpy arrays, so the test runs only from within the python module
+	if (!Py_IsInitialized())
+	{
+		spdlog::warn("Python is not initialized, skipping");
+		return;
+	}
+	Context ctx;
+	try
+	{
+		ctx.Init(100, 100, "test", true, nullptr);
+	}
+	catch (const std::exception& e)
+	{
+		spdlog::warn("{}, skipping", e.what());
+		return;
+	}
+
+	// Below, at the low end, in the middle, at the high end and above the window
+	const int values[] = { 32, 64, 128, 192, 224 };
+	const int count = 5;
+	py::array_t<uint8_t> rgb8(std::vector<ssize_t>{ count, count, 3 });
+	py::array_t<uint16_t> rgb16(std::vector<ssize_t>{ count, count, 3 });
+	for (int i = 0; i < count * count * 3; ++i)
+	{
+		rgb8.mutable_data()[i] = uint8_t(values[i / 3 % count]);
+		rgb16.mutable_data()[i] = uint16_t(values[i / 3 % count] * 257);
+	}
+
+	auto render = [&](ImagePtr image, float scale)
+	{
+		ctx.SetImage(image, true);
+		ctx.m_windowWidth = 128.0f * scale;
+		ctx.m_level = 128.0f * scale;
+		ctx.NewFrame();
+		ctx.Render();
+		std::vector<uint8_t> pixels(100 * 100 * 4);
+		ctx.m_framebuffer.ReadPixels(pixels.data());
+		std::vector<int> result;
+		for (int i = 0; i < count; ++i)
+		{
+			// Quad of the image spans [-0.5, size + 0.5], see DrawImage
+			glm::vec2 center = -0.5f + (glm::vec2(i, count / 2) + 0.5f) * float(count + 1) / float(count);
+			glm::ivec2 p = glm::ivec2(ctx.GetViewTransform(0) * glm::vec3(center, 1.0f));
+			result.push_back(pixels[(p.y * 100 + p.x) * 4]);
+		}
+		return result;
+	};
+
+	ctx.MakeCurrent();
+	auto result8 = render(std::make_shared<Image>(std::vector<py::array>{ rgb8 }), 1.0f);
+	auto result16 = render(std::make_shared<Image>(std::vector<py::array>{ rgb16 }), 257.0f);
+
+	// Ends of the window are black and white for both, values outside are clamped
+	for (auto& result: { result8, result16 })
+	{
+		CHECK_EQ(result[0], 0);
+		CHECK_EQ(result[1], 0);
+		CHECK_EQ(result[3], 255);
+		CHECK_EQ(result[4], 255);
+	}
+	// uint8 color data is sRGB encoded, so the middle of the window is the middle of the display range.
+	// uint16 data is linear, and the framebuffer encodes it
+	CHECK_LE(abs(result8[2] - 128), 2);
+	CHECK_LE(abs(result16[2] - 188), 2);
 }
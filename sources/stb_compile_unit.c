@@ -4,9 +4,11 @@
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #define STB_RECT_PACK_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image.h>
+#include <stb_image_write.h>
 /*
 #include <stb_rect_pack.h>
 // #include <stb/stb_truetype.h>
-#include <stb_image.h>
 #include <stb_image_resize.h>
 */
\ No newline at end of file
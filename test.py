@@ -1,5 +1,4 @@
 import anntoolkit
-import imageio
 import os
 import pickle
 import numpy as np
@@ -19,6 +18,7 @@ class App(anntoolkit.App):
             self.paths += [os.path.relpath(os.path.join(dirName, x), self.path) for x in fileList if x.endswith('.jpg') or x.endswith('.jpeg') or x.endswith('.png')]
 
         self.paths.sort()
+        self.loader = anntoolkit.ImageLoader([os.path.join(self.path, x) for x in self.paths], radius=2)
         self.iter = -1
         self.annotation = {}
         if os.path.exists(SAVE_PATH):
@@ -31,17 +31,19 @@ class App(anntoolkit.App):
 
         print("Data size: %d" % len(self.annotation.items()))
 
+    def load(self):
+        self.loader.prefetch(self.iter)
+        self.set_image(self.loader.get_image(self.iter))
+
     def load_next(self):
         self.iter += 1
         self.iter = self.iter % len(self.paths)
-        im = imageio.imread(os.path.join(self.path, self.paths[self.iter]))
-        self.set_image(im)
+        self.load()
 
     def load_prev(self):
         self.iter -= 1
         self.iter = (self.iter + len(self.paths)) % len(self.paths)
-        im = imageio.imread(os.path.join(self.path, self.paths[self.iter]))
-        self.set_image(im)
+        self.load()
 
     def load_next_not_annotated(self):
         while True:
@@ -53,9 +55,8 @@ class App(anntoolkit.App):
             if self.iter == 0:
                 break
         try:
-            im = imageio.imread(os.path.join(self.path, self.paths[self.iter]))
-            self.set_image(im)
-        except ValueError:
+            self.load()
+        except RuntimeError:
             self.load_next_not_annotated()
 
     def load_prev_not_annotated(self):
@@ -68,12 +69,12 @@ class App(anntoolkit.App):
             if self.iter == 0:
                 break
         try:
-            im = imageio.imread(os.path.join(self.path, self.paths[self.iter]))
-            self.set_image(im)
-        except ValueError:
+            self.load()
+        except RuntimeError:
             self.load_prev_not_annotated()
 
     def on_update(self):
+        self.loader.upload()
         k = self.paths[self.iter]
         self.text(k, 10, 30)
         self.text('\033[32mGreen \033[1;31mBold red \033[22mNormal red \033[1;34;47m Bold blue on white \033[0mReset', 10, 70)